@@ -119,6 +119,79 @@ class LocklessQueue
   private:
     std::atomic<LocklessNode *> m_back;
 };
+
+/// Passes the latest value of T from one writer thread to one reader
+/// thread without locks, waits or allocation.
+///
+/// The writer fills back() and calls publish(). The reader calls
+/// update() and, when it returns true, reads the newest published
+/// value at front(). Each side owns one of the three buffers and the
+/// third is swapped between them atomically, so neither side ever sees
+/// a value while the other is writing it. Values published between
+/// two updates are skipped, only the newest one is read.
+template <typename T>
+class TripleBuffer
+{
+  public:
+    TripleBuffer( T const &initial = T() )
+        : m_front( 0 ), m_back( 1 ), m_middle( 2 )
+    {
+        m_buffers[0] = initial;
+        m_buffers[1] = initial;
+        m_buffers[2] = initial;
+    }
+
+    TripleBuffer( TripleBuffer const & ) = delete;
+    TripleBuffer &operator=( TripleBuffer const & ) = delete;
+
+    /// The writer's buffer. It holds an older value, so fill in all of
+    /// it before publishing.
+    T &back() { return m_buffers[m_back]; }
+
+    /// Make the writer's buffer the newest value
+    void publish()
+    {
+        unsigned old = m_middle.exchange( m_back | fresh,
+                                          std::memory_order_acq_rel );
+        m_back = old & index_mask;
+    }
+
+    /// Copy v to the writer's buffer and publish it
+    void write( T const &v )
+    {
+        back() = v;
+        publish();
+    }
+
+    /// Move the newest published value to front(). Returns false when
+    /// nothing was published since the last update.
+    bool update()
+    {
+        if ( !( m_middle.load( std::memory_order_relaxed ) & fresh ) )
+        {
+            return false;
+        }
+        unsigned old
+            = m_middle.exchange( m_front, std::memory_order_acq_rel );
+        m_front = old & index_mask;
+        return true;
+    }
+
+    /// The reader's buffer
+    T const &front() const { return m_buffers[m_front]; }
+
+  private:
+    enum
+    {
+        index_mask = 3,
+        fresh = 4
+    };
+
+    T m_buffers[3];
+    unsigned m_front;
+    unsigned m_back;
+    std::atomic<unsigned> m_middle;
+};
 }
 }
 
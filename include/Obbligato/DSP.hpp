@@ -21,10 +21,28 @@
  */
 
 #include "Obbligato/World.hpp"
+#include "Obbligato/DSP_DenormalGuard.hpp"
+#include "Obbligato/DSP_Response.hpp"
 #include "Obbligato/DSP_Gain.hpp"
+#include "Obbligato/DSP_BiquadDesign.hpp"
 #include "Obbligato/DSP_Biquad.hpp"
+#include "Obbligato/DSP_BiquadBank.hpp"
+#include "Obbligato/DSP_BiquadLookahead.hpp"
+#include "Obbligato/DSP_FFT.hpp"
+#include "Obbligato/DSP_Fir.hpp"
+#include "Obbligato/DSP_SpectrumAnalyzer.hpp"
+#include "Obbligato/DSP_Convolver.hpp"
+#include "Obbligato/DSP_Resampler.hpp"
+#include "Obbligato/DSP_DelayLine.hpp"
+#include "Obbligato/DSP_Noise.hpp"
 #include "Obbligato/DSP_PluginChain.hpp"
+#include "Obbligato/DSP_StaticChain.hpp"
+#include "Obbligato/DSP_DynamicChain.hpp"
+#include "Obbligato/DSP_GraphScheduler.hpp"
+#include "Obbligato/DSP_Automated.hpp"
 #include "Obbligato/DSP_Oscillator.hpp"
+#include "Obbligato/DSP_OscillatorBank.hpp"
+#include "Obbligato/DSP_GoertzelBank.hpp"
 
 namespace Obbligato
 {
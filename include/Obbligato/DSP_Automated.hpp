@@ -0,0 +1,98 @@
+#pragma once
+/*
+ Copyright (c) 2013, J.D. Koftinoff Software, Ltd.
+ <jeffk@jdkoftinoff.com>
+ http://www.jdkoftinoff.com/
+ All rights reserved.
+
+ Permission to use, copy, modify, and/or distribute this software for
+ any
+ purpose with or without fee is hereby granted, provided that the above
+ copyright notice and this permission notice appear in all copies.
+
+ THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ WARRANTIES
+ WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "Obbligato/World.hpp"
+#include "Obbligato/Atomic.hpp"
+#include "Obbligato/IOStream.hpp"
+
+#if __cplusplus >= 201103L
+
+namespace Obbligato
+{
+namespace DSP
+{
+
+/// A plugin whose coefficients are changed by another thread.
+///
+/// A control thread, such as a user interface or network thread, calls
+/// setCoeffs() with a complete set of coefficients. The audio thread
+/// picks up the newest set at the start of the next process() call and
+/// moves to it with the plugin's processRamped(), interpolating the
+/// coefficients linearly across the block. Neither thread locks, waits
+/// or allocates. Works with Biquad and Gain.
+template <typename PluginType>
+class Automated
+{
+  public:
+    typedef typename PluginType::value_type value_type;
+    typedef typename PluginType::Coeffs coeffs_type;
+    typedef value_type T;
+
+    PluginType m_plugin;
+
+    Automated( PluginType const &plugin = PluginType() )
+        : m_plugin( plugin ), m_coeffs( plugin.m_coeffs )
+    {
+    }
+
+    /// Publish a new set of coefficients. Called from one control
+    /// thread at a time.
+    void setCoeffs( coeffs_type const &coeffs )
+    {
+        m_coeffs.write( coeffs );
+    }
+
+    /// Process frames samples from in to out, ramping to the newest
+    /// published coefficients if there are any. Called from the audio
+    /// thread.
+    void process( T const *in, T *out, size_t frames )
+    {
+        if ( m_coeffs.update() )
+        {
+            m_plugin.processRamped( in, out, frames, m_coeffs.front() );
+        }
+        else
+        {
+            m_plugin.process( in, out, frames );
+        }
+    }
+
+    /// Process frames samples of buf in place
+    void processInPlace( T *buf, size_t frames )
+    {
+        process( buf, buf, frames );
+    }
+
+    friend std::ostream &operator<<( std::ostream &o,
+                                     Automated const &v )
+    {
+        o << v.m_plugin;
+        return o;
+    }
+
+  private:
+    Atomic::TripleBuffer<coeffs_type> m_coeffs;
+};
+}
+}
+
+#endif
@@ -24,6 +24,9 @@
 #include "Obbligato/SIMD.hpp"
 #include "Obbligato/IOStream.hpp"
 #include "Obbligato/Constants.hpp"
+#include "Obbligato/DSP_DenormalGuard.hpp"
+#include "Obbligato/DSP_BiquadDesign.hpp"
+#include "Obbligato/DSP_Response.hpp"
 
 #if __cplusplus >= 201103L
 
@@ -66,6 +69,25 @@ struct Biquad
             return numerator / denominator;
         }
 
+        /// Multiply the response of channel at every point of grid into
+        /// the split complex arrays re and im
+        template <typename G>
+        void responseZDomain( size_t channel,
+                              FrequencyGrid<G> const &grid,
+                              G *re,
+                              G *im ) const
+        {
+            response_multiply_biquad(
+                grid,
+                double( get_flattened_item( m_a0, channel ) ),
+                double( get_flattened_item( m_a1, channel ) ),
+                double( get_flattened_item( m_a2, channel ) ),
+                double( get_flattened_item( m_b1, channel ) ),
+                double( get_flattened_item( m_b2, channel ) ),
+                re,
+                im );
+        }
+
         void set( size_t channel,
                   double na0,
                   double na1,
@@ -85,20 +107,44 @@ struct Biquad
                 m_b2, static_cast<item_type>( nb2 ), channel );
         }
 
+        /// Copy the coefficients of all channels to p member by member,
+        /// returning the pointer just past the last item written
+        item_type *flattenTo( item_type *p ) const
+        {
+            p = flatten_to( m_a0, p );
+            p = flatten_to( m_a1, p );
+            p = flatten_to( m_a2, p );
+            p = flatten_to( m_b1, p );
+            p = flatten_to( m_b2, p );
+            return p;
+        }
+
+        /// Load the coefficients of all channels from p, in the layout
+        /// written by flattenTo()
+        item_type const *unflattenFrom( item_type const *p )
+        {
+            p = unflatten_from( m_a0, p );
+            p = unflatten_from( m_a1, p );
+            p = unflatten_from( m_a2, p );
+            p = unflatten_from( m_b1, p );
+            p = unflatten_from( m_b2, p );
+            return p;
+        }
+
+        /// Set the coefficients of one channel to a design
+        void set( size_t channel, BiquadDesign const &d )
+        {
+            set( channel, d.m_a0, d.m_a1, d.m_a2, d.m_b1, d.m_b2 );
+        }
+
         void calculateLowpass( size_t channel,
                                double sample_rate,
                                double freq,
                                double q )
         {
-            double k = std::tan( OBBLIGATO_PI * freq / sample_rate );
-            double norm = 1.0 / ( 1.0 + k / q + k * k );
-            double na0 = k * k * norm;
-            double na1 = 2.0 * na0;
-            double na2 = na0;
-            double nb1 = 2.0 * ( k * k - 1.0 ) * norm;
-            double nb2 = ( 1.0 - k / q + k * k ) * norm;
-
-            set( channel, na0, na1, na2, nb1, nb2 );
+            set( channel,
+                 biquad_design(
+                     biquad_lowpass, sample_rate, freq, q, 0.0 ) );
         }
 
         void calculateHighpass( size_t channel,
@@ -106,14 +152,9 @@ struct Biquad
                                 double freq,
                                 double q )
         {
-            double k = std::tan( OBBLIGATO_PI * freq / sample_rate );
-            double norm = 1.0 / ( 1.0 + k / q + k * k );
-            double na0 = 1.0 * norm;
-            double na1 = -2.0 * na0;
-            double na2 = na0;
-            double nb1 = 2.0 * ( k * k - 1.0 ) * norm;
-            double nb2 = ( 1.0 - k / q + k * k ) * norm;
-            set( channel, na0, na1, na2, nb1, nb2 );
+            set( channel,
+                 biquad_design(
+                     biquad_highpass, sample_rate, freq, q, 0.0 ) );
         }
 
         void calculateBandpass( size_t channel,
@@ -121,14 +162,9 @@ struct Biquad
                                 double freq,
                                 double q )
         {
-            double k = std::tan( OBBLIGATO_PI * freq / sample_rate );
-            double norm = 1.0 / ( 1.0 + k / q + k * k );
-            double na0 = k / q * norm;
-            double na1 = 0.0;
-            double na2 = -na0;
-            double nb1 = 2.0 * ( k * k - 1.0 ) * norm;
-            double nb2 = ( 1.0 - k / q + k * k ) * norm;
-            set( channel, na0, na1, na2, nb1, nb2 );
+            set( channel,
+                 biquad_design(
+                     biquad_bandpass, sample_rate, freq, q, 0.0 ) );
         }
 
         void calculateNotch( size_t channel,
@@ -136,14 +172,9 @@ struct Biquad
                              double freq,
                              double q )
         {
-            double k = std::tan( OBBLIGATO_PI * freq / sample_rate );
-            double norm = 1.0 / ( 1.0 + k / 1.0 + k * k );
-            double na0 = ( 1.0 + k * k ) * norm;
-            double na1 = 2.0 * ( k * k - 1.0 ) * norm;
-            double na2 = na0;
-            double nb1 = na1;
-            double nb2 = ( 1.0 - k / q + k * k ) * norm;
-            set( channel, na0, na1, na2, nb1, nb2 );
+            set( channel,
+                 biquad_design(
+                     biquad_notch, sample_rate, freq, q, 0.0 ) );
         }
 
         void calculatePeak( size_t channel,
@@ -152,31 +183,9 @@ struct Biquad
                             double q,
                             double gain )
         {
-            double k = std::tan( OBBLIGATO_PI * freq / sample_rate );
-            double v = pow( 10.0, std::abs( gain ) / 20.0 );
-
-            if ( gain >= 0 )
-            {
-                double norm = 1.0 / ( 1.0 + 1.0 / q * k + k * k );
-                double na0 = ( 1.0 + v / q * k + k * k ) * norm;
-                double na1 = 2.0 * ( k * k - 1.0 ) * norm;
-                double na2 = ( 1.0 - v / q * k + k * k ) * norm;
-                double nb1 = na1;
-                double nb2 = ( 1.0 - 1.0 / q * k + k * k ) * norm;
-
-                set( channel, na0, na1, na2, nb1, nb2 );
-            }
-            else
-            {
-                double norm = 1.0 / ( 1.0 + v / q * k + k * k );
-                double na0 = ( 1.0 + 1.0 / q * k + k * k ) * norm;
-                double na1 = 2.0 * ( k * k - 1.0 ) * norm;
-                double na2 = ( 1.0 - 1.0 / q * k + k * k ) * norm;
-                double nb1 = na1;
-                double nb2 = ( 1.0 - v / q * k + k * k ) * norm;
-
-                set( channel, na0, na1, na2, nb1, nb2 );
-            }
+            set( channel,
+                 biquad_design(
+                     biquad_peak, sample_rate, freq, q, gain ) );
         }
 
         void calculateLowshelf( size_t channel,
@@ -184,31 +193,9 @@ struct Biquad
                                 double freq,
                                 double gain )
         {
-            double k = std::tan( OBBLIGATO_PI * freq / sample_rate );
-            double v = pow( 10.0, std::abs( gain ) / 20.0 );
-            double sqrt2 = OBBLIGATO_SQRT2;
-
-            if ( gain >= 0 )
-            {
-                double norm = 1.0 / ( 1.0 + sqrt2 * k + k * k );
-                double na0 = ( 1.0 + sqrt2 * v * k + v * k * k ) * norm;
-                double na1 = 2.0 * ( v * k * k - 1.0 ) * norm;
-                double na2 = ( 1.0 - sqrt2 * v * k + v * k * k ) * norm;
-                double nb1 = 2.0 * ( k * k - 1.0 ) * norm;
-                double nb2 = ( 1.0 - sqrt2 * k + k * k ) * norm;
-
-                set( channel, na0, na1, na2, nb1, nb2 );
-            }
-            else
-            {
-                double norm = 1.0 / ( 1.0 + sqrt2 * v * k + v * k * k );
-                double na0 = ( 1.0 + sqrt2 * k + k * k ) * norm;
-                double na1 = 2.0 * ( k * k - 1.0 ) * norm;
-                double na2 = ( 1.0 - sqrt2 * k + k * k ) * norm;
-                double nb1 = 2.0 * ( v * k * k - 1.0 ) * norm;
-                double nb2 = ( 1.0 - sqrt2 * v * k + v * k * k ) * norm;
-                set( channel, na0, na1, na2, nb1, nb2 );
-            }
+            set( channel,
+                 biquad_design(
+                     biquad_lowshelf, sample_rate, freq, 1.0, gain ) );
         }
 
         void calculateHighshelf( size_t channel,
@@ -216,30 +203,9 @@ struct Biquad
                                  double freq,
                                  double gain )
         {
-            double k = std::tan( OBBLIGATO_PI * freq / sample_rate );
-            double v = pow( 10.0, std::abs( gain ) / 20.0 );
-            double sqrt2 = OBBLIGATO_SQRT2;
-
-            if ( gain >= 0 )
-            {
-                double norm = 1.0 / ( 1.0 + sqrt2 * k + k * k );
-                double na0 = ( v + sqrt2 * v * k + k * k ) * norm;
-                double na1 = 2.0 * ( k * k - v ) * norm;
-                double na2 = ( v - sqrt2 * v * k + k * k ) * norm;
-                double nb1 = 2.0 * ( k * k - 1 ) * norm;
-                double nb2 = ( 1.0 - sqrt2 * k + k * k ) * norm;
-                set( channel, na0, na1, na2, nb1, nb2 );
-            }
-            else
-            {
-                double norm = 1.0 / ( v + sqrt2 * v * k + k * k );
-                double na0 = ( 1.0 + sqrt2 * k + k * k ) * norm;
-                double na1 = 2.0 * ( k * k - 1 ) * norm;
-                double na2 = ( 1.0 - sqrt2 * k + k * k ) * norm;
-                double nb1 = 2.0 * ( k * k - v ) * norm;
-                double nb2 = ( v - sqrt2 * v * k + k * k ) * norm;
-                set( channel, na0, na1, na2, nb1, nb2 );
-            }
+            set( channel,
+                 biquad_design(
+                     biquad_highshelf, sample_rate, freq, 1.0, gain ) );
         }
 
         friend std::ostream &operator<<( std::ostream &o,
@@ -269,6 +235,24 @@ struct Biquad
 
         State &operator=( State const &other ) = default;
 #endif
+        /// Copy the state of all channels to p member by member,
+        /// returning the pointer just past the last item written
+        item_type *flattenTo( item_type *p ) const
+        {
+            p = flatten_to( m_z1, p );
+            p = flatten_to( m_z2, p );
+            return p;
+        }
+
+        /// Load the state of all channels from p, in the layout
+        /// written by flattenTo()
+        item_type const *unflattenFrom( item_type const *p )
+        {
+            p = unflatten_from( m_z1, p );
+            p = unflatten_from( m_z2, p );
+            return p;
+        }
+
         friend std::ostream &operator<<( std::ostream &o,
                                          State const &v )
         {
@@ -293,6 +277,7 @@ struct Biquad
     {
         m_coeffs = other.m_coeffs;
         m_state = other.m_state;
+        return *this;
     }
 
     T operator()( T input_value )
@@ -303,11 +288,88 @@ struct Biquad
         m_state.m_z1 = input_value * m_coeffs.m_a1 + m_state.m_z2
                        - m_coeffs.m_b1 * output_value;
         m_state.m_z2 = input_value * m_coeffs.m_a2
-                       + m_coeffs.m_b2 * output_value;
+                       - m_coeffs.m_b2 * output_value;
 
         return output_value;
     }
 
+    /// Process frames samples from in to out with denormals flushed to
+    /// zero. The coefficients and state are held in locals for the
+    /// whole block. in and out may be the same buffer.
+    void process( T const *in, T *out, size_t frames )
+    {
+        DenormalGuard guard;
+        T const a0 = m_coeffs.m_a0;
+        T const a1 = m_coeffs.m_a1;
+        T const a2 = m_coeffs.m_a2;
+        T const b1 = m_coeffs.m_b1;
+        T const b2 = m_coeffs.m_b2;
+        T z1 = m_state.m_z1;
+        T z2 = m_state.m_z2;
+
+        for ( size_t i = 0; i < frames; ++i )
+        {
+            T input_value = in[i];
+            T output_value = input_value * a0 + z1;
+            z1 = input_value * a1 + z2 - b1 * output_value;
+            z2 = input_value * a2 - b2 * output_value;
+            out[i] = output_value;
+        }
+
+        m_state.m_z1 = z1;
+        m_state.m_z2 = z2;
+    }
+
+    /// Process frames samples of buf in place
+    void processInPlace( T *buf, size_t frames )
+    {
+        process( buf, buf, frames );
+    }
+
+    /// Process frames samples like process() while moving every
+    /// coefficient linearly from m_coeffs to target across the block,
+    /// so that a new set of coefficients does not cause zipper noise.
+    /// m_coeffs is target afterwards.
+    void processRamped( T const *in,
+                        T *out,
+                        size_t frames,
+                        Coeffs const &target )
+    {
+        DenormalGuard guard;
+        item_type const step
+            = frames ? item_type( 1 ) / item_type( frames ) : 0;
+        T const da0 = ( target.m_a0 - m_coeffs.m_a0 ) * step;
+        T const da1 = ( target.m_a1 - m_coeffs.m_a1 ) * step;
+        T const da2 = ( target.m_a2 - m_coeffs.m_a2 ) * step;
+        T const db1 = ( target.m_b1 - m_coeffs.m_b1 ) * step;
+        T const db2 = ( target.m_b2 - m_coeffs.m_b2 ) * step;
+        T a0 = m_coeffs.m_a0;
+        T a1 = m_coeffs.m_a1;
+        T a2 = m_coeffs.m_a2;
+        T b1 = m_coeffs.m_b1;
+        T b2 = m_coeffs.m_b2;
+        T z1 = m_state.m_z1;
+        T z2 = m_state.m_z2;
+
+        for ( size_t i = 0; i < frames; ++i )
+        {
+            a0 += da0;
+            a1 += da1;
+            a2 += da2;
+            b1 += db1;
+            b2 += db2;
+            T input_value = in[i];
+            T output_value = input_value * a0 + z1;
+            z1 = input_value * a1 + z2 - b1 * output_value;
+            z2 = input_value * a2 - b2 * output_value;
+            out[i] = output_value;
+        }
+
+        m_coeffs = target;
+        m_state.m_z1 = z1;
+        m_state.m_z2 = z2;
+    }
+
     friend std::ostream &operator<<( std::ostream &o, Biquad const &v )
     {
         using namespace IOStream;
@@ -0,0 +1,294 @@
+#pragma once
+/*
+ Copyright (c) 2013, J.D. Koftinoff Software, Ltd.
+ <jeffk@jdkoftinoff.com>
+ http://www.jdkoftinoff.com/
+ All rights reserved.
+
+ Permission to use, copy, modify, and/or distribute this software for
+ any
+ purpose with or without fee is hereby granted, provided that the above
+ copyright notice and this permission notice appear in all copies.
+
+ THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ WARRANTIES
+ WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "Obbligato/World.hpp"
+#include "Obbligato/SIMD.hpp"
+#include "Obbligato/IOStream.hpp"
+#include "Obbligato/Form.hpp"
+#include "Obbligato/DSP_Biquad.hpp"
+#include "Obbligato/DSP_DenormalGuard.hpp"
+
+#if __cplusplus >= 201103L
+
+namespace Obbligato
+{
+namespace DSP
+{
+
+using namespace SIMD;
+
+/// A cascade of stages biquads on each of any number of channels.
+///
+/// The channels are processed in groups of Width, one channel per lane
+/// of a SIMD_Vector<T,Width>, which by default is the width of the
+/// native registers: 4 floats with SSE or NEON, 8 with AVX. Wider
+/// groups such as 16 are processed as several registers per vector.
+///
+/// Coefficients and state are held structure of arrays, one array of
+/// Width lanes per coefficient per stage per group, and are designed
+/// per channel with the Biquad<T>::Coeffs calculate functions.
+template <typename T = float, size_t Width = simd_native_size<T>::value>
+class BiquadBank
+{
+  public:
+    typedef T value_type;
+    typedef SIMD_Vector<T, Width> vector_type;
+    typedef typename Biquad<T>::Coeffs coeffs_type;
+
+    enum
+    {
+        width = Width,
+        /// The number of frames transposed into registers at a time
+        chunk_frames = 64
+    };
+
+    BiquadBank( size_t channels, size_t stages )
+        : m_channels( channels )
+        , m_stages( stages )
+        , m_groups( ( channels + Width - 1 ) / Width )
+        , m_coeffs( m_groups * stages * 5 * Width, T( 0 ) )
+        , m_state( m_groups * stages * 2 * Width, T( 0 ) )
+    {
+        // every stage starts as a wire
+        for ( size_t c = 0; c < m_channels; ++c )
+        {
+            for ( size_t s = 0; s < m_stages; ++s )
+            {
+                coeffAt( c, s, 0 ) = T( 1 );
+            }
+        }
+    }
+
+    size_t channels() const { return m_channels; }
+
+    size_t stages() const { return m_stages; }
+
+    /// Set the coefficients of one stage of one channel, for example
+    /// from Biquad<T>::Coeffs::calculatePeak()
+    void setCoeffs( size_t channel, size_t stage, coeffs_type const &c )
+    {
+        coeffAt( channel, stage, 0 ) = c.m_a0;
+        coeffAt( channel, stage, 1 ) = c.m_a1;
+        coeffAt( channel, stage, 2 ) = c.m_a2;
+        coeffAt( channel, stage, 3 ) = c.m_b1;
+        coeffAt( channel, stage, 4 ) = c.m_b2;
+    }
+
+    /// Set one stage of every channel from arrays holding one
+    /// coefficient per channel, as written by biquad_design_batch()
+    void setStageCoeffs( size_t stage,
+                         T const *a0,
+                         T const *a1,
+                         T const *a2,
+                         T const *b1,
+                         T const *b2 )
+    {
+        for ( size_t c = 0; c < m_channels; ++c )
+        {
+            coeffAt( c, stage, 0 ) = a0[c];
+            coeffAt( c, stage, 1 ) = a1[c];
+            coeffAt( c, stage, 2 ) = a2[c];
+            coeffAt( c, stage, 3 ) = b1[c];
+            coeffAt( c, stage, 4 ) = b2[c];
+        }
+    }
+
+    /// Get the coefficients of one stage of one channel
+    coeffs_type getCoeffs( size_t channel, size_t stage ) const
+    {
+        coeffs_type c;
+        c.m_a0 = coeffAt( channel, stage, 0 );
+        c.m_a1 = coeffAt( channel, stage, 1 );
+        c.m_a2 = coeffAt( channel, stage, 2 );
+        c.m_b1 = coeffAt( channel, stage, 3 );
+        c.m_b2 = coeffAt( channel, stage, 4 );
+        return c;
+    }
+
+    /// Multiply the response of every stage of channel at every point
+    /// of grid into the split complex arrays re and im
+    template <typename G>
+    void responseZDomain( size_t channel,
+                          FrequencyGrid<G> const &grid,
+                          G *re,
+                          G *im ) const
+    {
+        for ( size_t s = 0; s < m_stages; ++s )
+        {
+            getCoeffs( channel, s ).responseZDomain( 0, grid, re, im );
+        }
+    }
+
+    /// Clear the state of every stage of every channel
+    void reset()
+    {
+        std::fill( m_state.begin(), m_state.end(), T( 0 ) );
+    }
+
+    /// Process frames samples of each planar channel from in[channel]
+    /// to out[channel] with denormals flushed to zero. in and out may
+    /// point to the same buffers.
+    void process( T const *const *in, T *const *out, size_t frames )
+    {
+        DenormalGuard guard;
+        for ( size_t g = 0; g < m_groups; ++g )
+        {
+            for ( size_t pos = 0; pos < frames; pos += chunk_frames )
+            {
+                size_t n = frames - pos < size_t( chunk_frames )
+                               ? frames - pos
+                               : size_t( chunk_frames );
+                processChunk( g, in, out, pos, n );
+            }
+        }
+    }
+
+    /// Process frames samples of each planar buffer in place
+    void processInPlace( T *const *buf, size_t frames )
+    {
+        process( buf, buf, frames );
+    }
+
+    friend std::ostream &operator<<( std::ostream &o,
+                                     BiquadBank const &v )
+    {
+        using namespace IOStream;
+        for ( size_t c = 0; c < v.m_channels; ++c )
+        {
+            for ( size_t s = 0; s < v.m_stages; ++s )
+            {
+                o << label_fmt( form<128>(
+                         "ch %d stage %d", int( c ), int( s ) ) )
+                  << v.getCoeffs( c, s ) << std::endl;
+            }
+        }
+        return o;
+    }
+
+  private:
+    T &coeffAt( size_t channel, size_t stage, size_t which )
+    {
+        return m_coeffs[( ( channel / Width * m_stages + stage ) * 5
+                          + which ) * Width + channel % Width];
+    }
+
+    T const &coeffAt( size_t channel, size_t stage, size_t which ) const
+    {
+        return m_coeffs[( ( channel / Width * m_stages + stage ) * 5
+                          + which ) * Width + channel % Width];
+    }
+
+    /// Transpose up to chunk_frames frames of the channels of group g
+    /// into vectors, run every stage over them and transpose them back
+    void processChunk( size_t g,
+                       T const *const *in,
+                       T *const *out,
+                       size_t pos,
+                       size_t frames )
+    {
+        vector_type buf[chunk_frames];
+        size_t const first = g * Width;
+        size_t const lanes
+            = m_channels - first < Width ? m_channels - first : Width;
+        size_t const full_frames
+            = lanes == Width ? frames - frames % Width : 0;
+
+        for ( size_t i = 0; i < full_frames; i += Width )
+        {
+            SIMD_Vector<vector_type, Width> m;
+            for ( size_t lane = 0; lane < Width; ++lane )
+            {
+                loadu( m[lane], in[first + lane] + pos + i );
+            }
+            transpose( m );
+            for ( size_t j = 0; j < Width; ++j )
+            {
+                buf[i + j] = m[j];
+            }
+        }
+        for ( size_t i = full_frames; i < frames; ++i )
+        {
+            zero( buf[i] );
+            for ( size_t lane = 0; lane < lanes; ++lane )
+            {
+                buf[i][lane] = in[first + lane][pos + i];
+            }
+        }
+
+        for ( size_t s = 0; s < m_stages; ++s )
+        {
+            T const *c = &m_coeffs[( g * m_stages + s ) * 5 * Width];
+            T *z = &m_state[( g * m_stages + s ) * 2 * Width];
+            vector_type a0, a1, a2, b1, b2, z1, z2;
+            loadu( a0, c );
+            loadu( a1, c + Width );
+            loadu( a2, c + Width * 2 );
+            loadu( b1, c + Width * 3 );
+            loadu( b2, c + Width * 4 );
+            loadu( z1, z );
+            loadu( z2, z + Width );
+
+            for ( size_t i = 0; i < frames; ++i )
+            {
+                vector_type input_value = buf[i];
+                vector_type output_value = input_value * a0 + z1;
+                z1 = input_value * a1 + z2 - b1 * output_value;
+                z2 = input_value * a2 - b2 * output_value;
+                buf[i] = output_value;
+            }
+
+            storeu( z1, z );
+            storeu( z2, z + Width );
+        }
+
+        for ( size_t i = 0; i < full_frames; i += Width )
+        {
+            SIMD_Vector<vector_type, Width> m;
+            for ( size_t j = 0; j < Width; ++j )
+            {
+                m[j] = buf[i + j];
+            }
+            transpose( m );
+            for ( size_t lane = 0; lane < Width; ++lane )
+            {
+                storeu( m[lane], out[first + lane] + pos + i );
+            }
+        }
+        for ( size_t i = full_frames; i < frames; ++i )
+        {
+            for ( size_t lane = 0; lane < lanes; ++lane )
+            {
+                out[first + lane][pos + i] = buf[i][lane];
+            }
+        }
+    }
+
+    size_t m_channels;
+    size_t m_stages;
+    size_t m_groups;
+    std::vector<T> m_coeffs;
+    std::vector<T> m_state;
+};
+}
+}
+
+#endif
@@ -0,0 +1,379 @@
+#pragma once
+/*
+ Copyright (c) 2013, J.D. Koftinoff Software, Ltd.
+ <jeffk@jdkoftinoff.com>
+ http://www.jdkoftinoff.com/
+ All rights reserved.
+
+ Permission to use, copy, modify, and/or distribute this software for
+ any
+ purpose with or without fee is hereby granted, provided that the above
+ copyright notice and this permission notice appear in all copies.
+
+ THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ WARRANTIES
+ WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "Obbligato/World.hpp"
+#include "Obbligato/Constants.hpp"
+
+#if __cplusplus >= 201103L
+
+namespace Obbligato
+{
+namespace DSP
+{
+
+/** \addtogroup biquad_design Biquad coefficient design
+ *
+ * The designs behind Biquad::Coeffs::calculateLowpass() and friends,
+ * as free functions of double precision parameters, with a memoizing
+ * cache and a batch designer for many channels at once.
+ */
+/**@{*/
+
+/// The filter shapes that Biquad can be designed as
+enum BiquadType
+{
+    biquad_lowpass,
+    biquad_highpass,
+    biquad_bandpass,
+    biquad_notch,
+    biquad_peak,
+    biquad_lowshelf,
+    biquad_highshelf
+};
+
+/// One set of normalized biquad coefficients
+struct BiquadDesign
+{
+    double m_a0, m_a1, m_a2, m_b1, m_b2;
+
+    BiquadDesign(
+        double a0, double a1, double a2, double b1, double b2 )
+        : m_a0( a0 ), m_a1( a1 ), m_a2( a2 ), m_b1( b1 ), m_b2( b2 )
+    {
+    }
+
+    BiquadDesign()
+        : m_a0( 1 ), m_a1( 0 ), m_a2( 0 ), m_b1( 0 ), m_b2( 0 )
+    {
+    }
+};
+
+/// Design a biquad from k = tan( pi * freq / sample_rate ) and
+/// v = 10 ^ ( abs( gain ) / 20 ), which are the only transcendental
+/// parts of every design. q is unused by the shelves, gain and v only
+/// by the peak and the shelves.
+inline BiquadDesign biquad_design_kv(
+    BiquadType type, double k, double v, double q, double gain )
+{
+    double const sqrt2 = OBBLIGATO_SQRT2;
+    switch ( type )
+    {
+    case biquad_lowpass:
+    {
+        double norm = 1.0 / ( 1.0 + k / q + k * k );
+        double na0 = k * k * norm;
+        return BiquadDesign( na0,
+                             2.0 * na0,
+                             na0,
+                             2.0 * ( k * k - 1.0 ) * norm,
+                             ( 1.0 - k / q + k * k ) * norm );
+    }
+    case biquad_highpass:
+    {
+        double norm = 1.0 / ( 1.0 + k / q + k * k );
+        double na0 = 1.0 * norm;
+        return BiquadDesign( na0,
+                             -2.0 * na0,
+                             na0,
+                             2.0 * ( k * k - 1.0 ) * norm,
+                             ( 1.0 - k / q + k * k ) * norm );
+    }
+    case biquad_bandpass:
+    {
+        double norm = 1.0 / ( 1.0 + k / q + k * k );
+        double na0 = k / q * norm;
+        return BiquadDesign( na0,
+                             0.0,
+                             -na0,
+                             2.0 * ( k * k - 1.0 ) * norm,
+                             ( 1.0 - k / q + k * k ) * norm );
+    }
+    case biquad_notch:
+    {
+        double norm = 1.0 / ( 1.0 + k / 1.0 + k * k );
+        double na0 = ( 1.0 + k * k ) * norm;
+        double na1 = 2.0 * ( k * k - 1.0 ) * norm;
+        return BiquadDesign(
+            na0, na1, na0, na1, ( 1.0 - k / q + k * k ) * norm );
+    }
+    case biquad_peak:
+        if ( gain >= 0 )
+        {
+            double norm = 1.0 / ( 1.0 + 1.0 / q * k + k * k );
+            double na1 = 2.0 * ( k * k - 1.0 ) * norm;
+            return BiquadDesign( ( 1.0 + v / q * k + k * k ) * norm,
+                                 na1,
+                                 ( 1.0 - v / q * k + k * k ) * norm,
+                                 na1,
+                                 ( 1.0 - 1.0 / q * k + k * k ) * norm );
+        }
+        else
+        {
+            double norm = 1.0 / ( 1.0 + v / q * k + k * k );
+            double na1 = 2.0 * ( k * k - 1.0 ) * norm;
+            return BiquadDesign( ( 1.0 + 1.0 / q * k + k * k ) * norm,
+                                 na1,
+                                 ( 1.0 - 1.0 / q * k + k * k ) * norm,
+                                 na1,
+                                 ( 1.0 - v / q * k + k * k ) * norm );
+        }
+    case biquad_lowshelf:
+        if ( gain >= 0 )
+        {
+            double norm = 1.0 / ( 1.0 + sqrt2 * k + k * k );
+            return BiquadDesign(
+                ( 1.0 + sqrt2 * v * k + v * k * k ) * norm,
+                2.0 * ( v * k * k - 1.0 ) * norm,
+                ( 1.0 - sqrt2 * v * k + v * k * k ) * norm,
+                2.0 * ( k * k - 1.0 ) * norm,
+                ( 1.0 - sqrt2 * k + k * k ) * norm );
+        }
+        else
+        {
+            double norm = 1.0 / ( 1.0 + sqrt2 * v * k + v * k * k );
+            return BiquadDesign(
+                ( 1.0 + sqrt2 * k + k * k ) * norm,
+                2.0 * ( k * k - 1.0 ) * norm,
+                ( 1.0 - sqrt2 * k + k * k ) * norm,
+                2.0 * ( v * k * k - 1.0 ) * norm,
+                ( 1.0 - sqrt2 * v * k + v * k * k ) * norm );
+        }
+    case biquad_highshelf:
+        if ( gain >= 0 )
+        {
+            double norm = 1.0 / ( 1.0 + sqrt2 * k + k * k );
+            return BiquadDesign( ( v + sqrt2 * v * k + k * k ) * norm,
+                                 2.0 * ( k * k - v ) * norm,
+                                 ( v - sqrt2 * v * k + k * k ) * norm,
+                                 2.0 * ( k * k - 1 ) * norm,
+                                 ( 1.0 - sqrt2 * k + k * k ) * norm );
+        }
+        else
+        {
+            double norm = 1.0 / ( v + sqrt2 * v * k + k * k );
+            return BiquadDesign( ( 1.0 + sqrt2 * k + k * k ) * norm,
+                                 2.0 * ( k * k - 1 ) * norm,
+                                 ( 1.0 - sqrt2 * k + k * k ) * norm,
+                                 2.0 * ( k * k - v ) * norm,
+                                 ( v - sqrt2 * v * k + k * k ) * norm );
+        }
+    }
+    return BiquadDesign();
+}
+
+/// Design a biquad of type at freq Hz
+inline BiquadDesign biquad_design( BiquadType type,
+                                   double sample_rate,
+                                   double freq,
+                                   double q,
+                                   double gain )
+{
+    double k = std::tan( OBBLIGATO_PI * freq / sample_rate );
+    double v = pow( 10.0, std::abs( gain ) / 20.0 );
+    return biquad_design_kv( type, k, v, q, gain );
+}
+
+/// tan( x ) for 0 <= x < pi / 2 with no branches or library calls, so
+/// that loops over arrays of x vectorize. The rational approximation
+/// on [ 0, pi / 4 ] is from Cephes, and tan( x ) = 1 / tan( pi/2 - x )
+/// above it. The relative error is below 1e-13.
+inline double biquad_fast_tan( double x )
+{
+    bool upper = x > OBBLIGATO_PI / 4.0;
+    double y = upper ? OBBLIGATO_PI_OVER_TWO - x : x;
+    double z = y * y;
+    double p = ( -1.30936939181383777646e4 * z
+                 + 1.15351664838587416140e6 ) * z
+               - 1.79565251976484877988e7;
+    double q = ( ( ( z + 1.36812963470692954678e4 ) * z
+                   - 1.32089234440210967447e6 ) * z
+                 + 2.50083801823357915839e7 ) * z
+               - 5.38695755929454629881e7;
+    double t = y + y * z * p / q;
+    return upper ? 1.0 / t : t;
+}
+
+/// 10 ^ ( db / 20 ) for 0 <= db <= 96 with no branches or library
+/// calls. exp( u / 16 ) by its Taylor series, squared four times.
+inline double biquad_fast_db_to_amplitude( double db )
+{
+    double u = db * ( OBBLIGATO_LN10 / 20.0 / 16.0 );
+    double e = 1.0;
+    e = 1.0 + u * e * ( 1.0 / 14.0 );
+    e = 1.0 + u * e * ( 1.0 / 13.0 );
+    e = 1.0 + u * e * ( 1.0 / 12.0 );
+    e = 1.0 + u * e * ( 1.0 / 11.0 );
+    e = 1.0 + u * e * ( 1.0 / 10.0 );
+    e = 1.0 + u * e * ( 1.0 / 9.0 );
+    e = 1.0 + u * e * ( 1.0 / 8.0 );
+    e = 1.0 + u * e * ( 1.0 / 7.0 );
+    e = 1.0 + u * e * ( 1.0 / 6.0 );
+    e = 1.0 + u * e * ( 1.0 / 5.0 );
+    e = 1.0 + u * e * ( 1.0 / 4.0 );
+    e = 1.0 + u * e * ( 1.0 / 3.0 );
+    e = 1.0 + u * e * ( 1.0 / 2.0 );
+    e = 1.0 + u * e;
+    e *= e;
+    e *= e;
+    e *= e;
+    e *= e;
+    return e;
+}
+
+/// Design count biquads of one type from arrays of parameters, writing
+/// arrays of coefficients, such as one stage of a BiquadBank. The
+/// transcendental parts are computed a whole array at a time with
+/// biquad_fast_tan() and biquad_fast_db_to_amplitude(), so that the
+/// compiler can vectorize them. gain must be within +/- 96 dB.
+template <typename T>
+void biquad_design_batch( BiquadType type,
+                          double sample_rate,
+                          double const *freq,
+                          double const *q,
+                          double const *gain,
+                          size_t count,
+                          T *a0,
+                          T *a1,
+                          T *a2,
+                          T *b1,
+                          T *b2 )
+{
+    size_t const chunk = 64;
+    double k[chunk];
+    double v[chunk];
+    double const w = OBBLIGATO_PI / sample_rate;
+
+    for ( size_t pos = 0; pos < count; pos += chunk )
+    {
+        size_t n = count - pos < chunk ? count - pos : chunk;
+        for ( size_t i = 0; i < n; ++i )
+        {
+            k[i] = biquad_fast_tan( w * freq[pos + i] );
+            v[i] = biquad_fast_db_to_amplitude(
+                std::abs( gain[pos + i] ) );
+        }
+        for ( size_t i = 0; i < n; ++i )
+        {
+            BiquadDesign d = biquad_design_kv(
+                type, k[i], v[i], q[pos + i], gain[pos + i] );
+            a0[pos + i] = T( d.m_a0 );
+            a1[pos + i] = T( d.m_a1 );
+            a2[pos + i] = T( d.m_a2 );
+            b1[pos + i] = T( d.m_b1 );
+            b2[pos + i] = T( d.m_b2 );
+        }
+    }
+}
+
+/// A bounded cache of biquad designs with least recently used
+/// eviction.
+///
+/// Parameters are quantized before lookup: the frequency and q to
+/// 2 ^ octave_bits steps per octave, by keeping only that many bits of
+/// their mantissas, and the gain to gain_steps per dB. The design is
+/// made from the middle of each step, so every parameter set that
+/// falls in a step gets exactly the same coefficients. An automation
+/// sweep that revisits values then costs a hash lookup instead of tan,
+/// pow and divisions.
+class BiquadDesignCache
+{
+  public:
+    explicit BiquadDesignCache( size_t capacity = 4096,
+                                int octave_bits = 10,
+                                double gain_steps = 100.0 );
+
+    /// The design for the quantized parameters. It is returned by
+    /// value because a later miss may reuse its entry.
+    BiquadDesign design( BiquadType type,
+                         double sample_rate,
+                         double freq,
+                         double q,
+                         double gain );
+
+    size_t size() const { return m_size; }
+
+    size_t capacity() const { return m_entries.size(); }
+
+    size_t hits() const { return m_hits; }
+
+    size_t misses() const { return m_misses; }
+
+    void clear();
+
+  private:
+    struct Key
+    {
+        int m_type;
+        double m_sample_rate;
+        uint64_t m_freq;
+        uint64_t m_q;
+        long m_gain;
+
+        bool operator==( Key const &other ) const
+        {
+            return m_type == other.m_type
+                   && m_sample_rate == other.m_sample_rate
+                   && m_freq == other.m_freq && m_q == other.m_q
+                   && m_gain == other.m_gain;
+        }
+    };
+
+    /// An entry, linked into the recently used list by index
+    struct Entry
+    {
+        Key m_key;
+        BiquadDesign m_design;
+        uint32_t m_newer;
+        uint32_t m_older;
+    };
+
+    static uint32_t const none = 0xffffffff;
+
+    uint64_t quantize( double v ) const;
+    double unquantize( uint64_t key ) const;
+    size_t slotOf( Key const &key ) const;
+    void unlink( uint32_t i );
+    void linkNewest( uint32_t i );
+    void erase( Key const &key );
+
+    int m_shift;
+    double m_gain_steps;
+
+    /// Entries in a fixed array, so that a full cache never allocates
+    std::vector<Entry> m_entries;
+    size_t m_size;
+    uint32_t m_newest;
+    uint32_t m_oldest;
+
+    /// Open addressed hash table of entry indexes, at most half full
+    std::vector<uint32_t> m_table;
+    size_t m_mask;
+
+    size_t m_hits;
+    size_t m_misses;
+};
+
+/**@}*/
+}
+}
+
+#endif
@@ -0,0 +1,279 @@
+#pragma once
+/*
+ Copyright (c) 2013, J.D. Koftinoff Software, Ltd.
+ <jeffk@jdkoftinoff.com>
+ http://www.jdkoftinoff.com/
+ All rights reserved.
+
+ Permission to use, copy, modify, and/or distribute this software for
+ any
+ purpose with or without fee is hereby granted, provided that the above
+ copyright notice and this permission notice appear in all copies.
+
+ THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ WARRANTIES
+ WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "Obbligato/World.hpp"
+#include "Obbligato/SIMD.hpp"
+#include "Obbligato/IOStream.hpp"
+#include "Obbligato/Form.hpp"
+#include "Obbligato/DSP_Biquad.hpp"
+#include "Obbligato/DSP_DenormalGuard.hpp"
+
+#if __cplusplus >= 201103L
+
+namespace Obbligato
+{
+namespace DSP
+{
+
+using namespace SIMD;
+
+/// A cascade of biquads on one channel that computes K output samples
+/// per SIMD_Vector<T,K> instead of one at a time.
+///
+/// Biquad's transposed direct form II is the state space system
+///
+///     s[n+1] = A s[n] + B x[n],  y[n] = C s[n] + D x[n]
+///
+/// with s = (z1, z2). Unrolled K samples ahead, the K outputs of a
+/// block depend only on the state at its start and its K inputs:
+///
+///     y[n+k] = C A^k s[n] + sum over j <= k of h[k-j] x[n+j]
+///
+/// where h is the impulse response. Each stage precomputes the columns
+/// C A^k and the K shifted impulse responses as vectors, so a block
+/// costs K+2 vector multiply adds, and the state moves ahead K samples
+/// at once with A^K. The recursion runs once per block instead of once
+/// per sample. The matrices are calculated in double precision.
+///
+/// The results match Biquad<T> to within rounding, and the state is
+/// the same z1 and z2, so frames that do not fill a block are
+/// processed with the plain recursion.
+template <typename T = float, size_t K = simd_native_size<T>::value>
+class BiquadLookahead
+{
+  public:
+    typedef T value_type;
+    typedef SIMD_Vector<T, K> vector_type;
+    typedef typename Biquad<T>::Coeffs coeffs_type;
+
+    enum
+    {
+        block_size = K
+    };
+
+    explicit BiquadLookahead( size_t stages )
+        : m_stages( stages )
+        , m_coeffs( stages )
+        , m_state( stages * 2, T( 0 ) )
+        , m_columns( stages * ( K + 2 ) * K, T( 0 ) )
+        , m_advance( stages * ( 4 + 2 * K ), T( 0 ) )
+    {
+        coeffs_type wire;
+        wire.set( 0, 1.0, 0.0, 0.0, 0.0, 0.0 );
+        for ( size_t s = 0; s < m_stages; ++s )
+        {
+            setCoeffs( s, wire );
+        }
+    }
+
+    size_t stages() const { return m_stages; }
+
+    /// Set the coefficients of a stage, for example from
+    /// Biquad<T>::Coeffs::calculatePeak(), and precompute its block
+    /// matrices
+    void setCoeffs( size_t stage, coeffs_type const &c )
+    {
+        m_coeffs.at( stage ) = c;
+
+        double const a0 = c.m_a0, a1 = c.m_a1, a2 = c.m_a2;
+        double const b1 = c.m_b1, b2 = c.m_b2;
+
+        // powers of A = [ -b1 1 ; -b2 0 ], stored row major
+        double pow[K + 1][4];
+        pow[0][0] = 1;
+        pow[0][1] = 0;
+        pow[0][2] = 0;
+        pow[0][3] = 1;
+        for ( size_t k = 1; k <= K; ++k )
+        {
+            double const *p = pow[k - 1];
+            pow[k][0] = -b1 * p[0] + p[2];
+            pow[k][1] = -b1 * p[1] + p[3];
+            pow[k][2] = -b2 * p[0];
+            pow[k][3] = -b2 * p[1];
+        }
+
+        // B, the input's contribution to the next state
+        double const in1 = a1 - b1 * a0;
+        double const in2 = a2 - b2 * a0;
+
+        // impulse response h[0] = D, h[m] = C A^(m-1) B
+        double h[K];
+        h[0] = a0;
+        for ( size_t m = 1; m < K; ++m )
+        {
+            h[m] = pow[m - 1][0] * in1 + pow[m - 1][1] * in2;
+        }
+
+        // columns: C A^k for z1 and z2, then the response to each input
+        T *col = &m_columns[stage * ( K + 2 ) * K];
+        for ( size_t k = 0; k < K; ++k )
+        {
+            col[k] = T( pow[k][0] );
+            col[K + k] = T( pow[k][1] );
+            for ( size_t j = 0; j < K; ++j )
+            {
+                col[( 2 + j ) * K + k] = T( k >= j ? h[k - j] : 0.0 );
+            }
+        }
+
+        // A^K, then A^(K-1-j) B for each input j
+        T *adv = &m_advance[stage * ( 4 + 2 * K )];
+        for ( size_t i = 0; i < 4; ++i )
+        {
+            adv[i] = T( pow[K][i] );
+        }
+        for ( size_t j = 0; j < K; ++j )
+        {
+            double const *p = pow[K - 1 - j];
+            adv[4 + j] = T( p[0] * in1 + p[1] * in2 );
+            adv[4 + K + j] = T( p[2] * in1 + p[3] * in2 );
+        }
+    }
+
+    /// Get the coefficients of a stage
+    coeffs_type const &getCoeffs( size_t stage ) const
+    {
+        return m_coeffs.at( stage );
+    }
+
+    /// Multiply the response of every stage at every point of grid
+    /// into the split complex arrays re and im. channel is ignored.
+    template <typename G>
+    void responseZDomain( size_t channel,
+                          FrequencyGrid<G> const &grid,
+                          G *re,
+                          G *im ) const
+    {
+        (void)channel;
+        for ( size_t s = 0; s < m_stages; ++s )
+        {
+            m_coeffs[s].responseZDomain( 0, grid, re, im );
+        }
+    }
+
+    /// Clear the state of every stage
+    void reset()
+    {
+        std::fill( m_state.begin(), m_state.end(), T( 0 ) );
+    }
+
+    /// Process frames samples from in to out through every stage with
+    /// denormals flushed to zero. in and out may be the same buffer.
+    void process( T const *in, T *out, size_t frames )
+    {
+        DenormalGuard guard;
+        for ( size_t s = 0; s < m_stages; ++s )
+        {
+            processStage( s, s == 0 ? in : out, out, frames );
+        }
+        if ( m_stages == 0 && in != out )
+        {
+            std::copy( in, in + frames, out );
+        }
+    }
+
+    /// Process frames samples of buf in place
+    void processInPlace( T *buf, size_t frames )
+    {
+        process( buf, buf, frames );
+    }
+
+    friend std::ostream &operator<<( std::ostream &o,
+                                     BiquadLookahead const &v )
+    {
+        using namespace IOStream;
+        for ( size_t s = 0; s < v.m_stages; ++s )
+        {
+            o << label_fmt( form<128>( "stage %d", int( s ) ) )
+              << v.m_coeffs[s] << "{ z1=" << v.m_state[s * 2]
+              << " z2=" << v.m_state[s * 2 + 1] << " } " << std::endl;
+        }
+        return o;
+    }
+
+  private:
+    void processStage( size_t stage,
+                       T const *in,
+                       T *out,
+                       size_t frames )
+    {
+        T const *col = &m_columns[stage * ( K + 2 ) * K];
+        T const *adv = &m_advance[stage * ( 4 + 2 * K )];
+        T z1 = m_state[stage * 2];
+        T z2 = m_state[stage * 2 + 1];
+
+        vector_type c1, c2, h[K];
+        loadu( c1, col );
+        loadu( c2, col + K );
+        for ( size_t j = 0; j < K; ++j )
+        {
+            loadu( h[j], col + ( 2 + j ) * K );
+        }
+
+        size_t const full_frames = frames - frames % K;
+        for ( size_t i = 0; i < full_frames; i += K )
+        {
+            T const *x = in + i;
+            vector_type y = c1 * z1 + c2 * z2;
+            for ( size_t j = 0; j < K; ++j )
+            {
+                y += h[j] * x[j];
+            }
+
+            T n1 = adv[0] * z1 + adv[1] * z2;
+            T n2 = adv[2] * z1 + adv[3] * z2;
+            for ( size_t j = 0; j < K; ++j )
+            {
+                n1 += adv[4 + j] * x[j];
+                n2 += adv[4 + K + j] * x[j];
+            }
+            z1 = n1;
+            z2 = n2;
+
+            storeu( y, out + i );
+        }
+
+        coeffs_type const &c = m_coeffs[stage];
+        for ( size_t i = full_frames; i < frames; ++i )
+        {
+            T input_value = in[i];
+            T output_value = input_value * c.m_a0 + z1;
+            z1 = input_value * c.m_a1 + z2 - c.m_b1 * output_value;
+            z2 = input_value * c.m_a2 - c.m_b2 * output_value;
+            out[i] = output_value;
+        }
+
+        m_state[stage * 2] = z1;
+        m_state[stage * 2 + 1] = z2;
+    }
+
+    size_t m_stages;
+    std::vector<coeffs_type> m_coeffs;
+    std::vector<T> m_state;
+    std::vector<T> m_columns;
+    std::vector<T> m_advance;
+};
+}
+}
+
+#endif
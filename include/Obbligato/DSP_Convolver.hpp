@@ -0,0 +1,413 @@
+#pragma once
+/*
+ Copyright (c) 2013, J.D. Koftinoff Software, Ltd.
+ <jeffk@jdkoftinoff.com>
+ http://www.jdkoftinoff.com/
+ All rights reserved.
+
+ Permission to use, copy, modify, and/or distribute this software for
+ any
+ purpose with or without fee is hereby granted, provided that the above
+ copyright notice and this permission notice appear in all copies.
+
+ THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ WARRANTIES
+ WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "Obbligato/World.hpp"
+#include "Obbligato/SIMD.hpp"
+#include "Obbligato/SharedPtr.hpp"
+#include "Obbligato/DSP_DenormalGuard.hpp"
+#include "Obbligato/DSP_FFT.hpp"
+
+#if __cplusplus >= 201103L
+
+namespace Obbligato
+{
+namespace DSP
+{
+
+using namespace SIMD;
+
+/// The impulse response of a Convolver, split into partitions of
+/// block_size taps.
+///
+/// The first partition, the head, is kept in the time domain, reversed
+/// so that it is applied as a dot product with the newest input. Every
+/// later partition is zero padded to twice block_size and held as the
+/// bins of its real FFT, one array of real parts and one of imaginary
+/// parts per partition, padded to a whole number of SIMD registers.
+///
+/// A response is immutable once made, so one response may be shared
+/// by any number of Convolvers, for example every channel of a
+/// ConvolverBank that uses the same filter.
+template <typename T = float>
+class ConvolverResponse
+{
+  public:
+    typedef T value_type;
+
+    enum
+    {
+        width = simd_native_size<T>::value
+    };
+
+    /// Partition length taps of impulse. block_size must be a power of
+    /// 2 from 2 to 32768.
+    ConvolverResponse( T const *impulse,
+                       size_t length,
+                       size_t block_size = 64 )
+        : m_length( length ), m_block_size( block_size )
+    {
+        if ( block_size < 2
+             || block_size > size_t( FFTPlan<T>::max_size ) / 2
+             || ( block_size & ( block_size - 1 ) ) != 0 )
+        {
+            throw std::invalid_argument( "ConvolverResponse block size "
+                                         "must be a power of 2 from 2 "
+                                         "to 32768" );
+        }
+        if ( length == 0 )
+        {
+            throw std::invalid_argument(
+                "ConvolverResponse needs at least one tap" );
+        }
+
+        size_t const b = block_size;
+        m_plan = RealFFTPlan<T>::get( b * 2 );
+        m_stride = ( m_plan->bins() + width - 1 ) / width * width;
+        m_partitions = ( length + b - 1 ) / b - 1;
+
+        m_head.assign( b, T( 0 ) );
+        for ( size_t k = 0; k < b && k < length; ++k )
+        {
+            m_head[b - 1 - k] = impulse[k];
+        }
+
+        m_re.assign( m_partitions * m_stride, T( 0 ) );
+        m_im.assign( m_partitions * m_stride, T( 0 ) );
+        std::vector<T> padded( b * 2 );
+        for ( size_t p = 0; p < m_partitions; ++p )
+        {
+            size_t const first = ( p + 1 ) * b;
+            size_t const taps
+                = length - first < b ? length - first : b;
+            std::fill( padded.begin(), padded.end(), T( 0 ) );
+            std::copy( impulse + first, impulse + first + taps,
+                       padded.begin() );
+            m_plan->forward(
+                &padded[0], &m_re[p * m_stride], &m_im[p * m_stride] );
+        }
+    }
+
+    /// The number of taps
+    size_t length() const { return m_length; }
+
+    size_t blockSize() const { return m_block_size; }
+
+    /// The number of partitions after the head
+    size_t partitions() const { return m_partitions; }
+
+    /// The distance between the bins of consecutive partitions
+    size_t stride() const { return m_stride; }
+
+    /// The head taps, newest input last
+    T const *head() const { return &m_head[0]; }
+
+    /// The real parts of the bins of partition p after the head
+    T const *re( size_t p ) const { return &m_re[p * m_stride]; }
+
+    /// The imaginary parts of the bins of partition p after the head
+    T const *im( size_t p ) const { return &m_im[p * m_stride]; }
+
+    /// The shared real FFT plan of twice the block size
+    shared_ptr<RealFFTPlan<T> const> const &plan() const
+    {
+        return m_plan;
+    }
+
+  private:
+    size_t m_length;
+    size_t m_block_size;
+    size_t m_stride;
+    size_t m_partitions;
+    shared_ptr<RealFFTPlan<T> const> m_plan;
+    std::vector<T> m_head;
+    std::vector<T> m_re;
+    std::vector<T> m_im;
+};
+
+/// Convolves one channel with a long FIR response, such as a room
+/// correction filter, with no latency and a fixed cost per block.
+///
+/// The response is uniformly partitioned into ConvolverResponse blocks
+/// of B taps. The first partition is applied directly to each sample,
+/// costing B multiply adds, so the output does not wait for a block to
+/// fill. The rest use overlap save: each time B input samples have
+/// arrived, the last 2B are transformed and the spectrum is pushed
+/// into a frequency domain delay line holding the spectra of the last
+/// P blocks. The spectra are multiplied by the P partitions, summed,
+/// and transformed back once to give the contribution of the later
+/// taps to the next B outputs. Those taps are at least B samples old,
+/// so the result is ready by the time it is needed.
+///
+/// Every block costs one forward and one inverse FFT of 2B points and
+/// P complex multiply adds per bin, whatever the calls to process()
+/// look like. A smaller B lowers the cost of the head and raises the
+/// cost of the delay line: 64 to 256 suits responses of thousands to
+/// tens of thousands of taps.
+template <typename T = float>
+class Convolver
+{
+  public:
+    typedef T value_type;
+    typedef ConvolverResponse<T> response_type;
+    typedef SIMD_Vector<T, simd_native_size<T>::value> vector_type;
+
+    enum
+    {
+        width = simd_native_size<T>::value
+    };
+
+    /// Convolve with a response that may be shared with others
+    explicit Convolver(
+        shared_ptr<response_type const> const &response )
+    {
+        setResponse( response );
+    }
+
+    /// Convolve with length taps of impulse
+    Convolver( T const *impulse, size_t length, size_t block_size = 64 )
+    {
+        setResponse( shared_ptr<response_type const>(
+            new response_type( impulse, length, block_size ) ) );
+    }
+
+    /// Change the response. The history is cleared.
+    void setResponse( shared_ptr<response_type const> const &response )
+    {
+        m_response = response;
+        size_t const b = response->blockSize();
+        size_t const stride = response->stride();
+        size_t const slots
+            = response->partitions() > 0 ? response->partitions() : 1;
+        m_window.assign( b * 2, T( 0 ) );
+        m_tail.assign( b, T( 0 ) );
+        m_output.assign( b * 2, T( 0 ) );
+        m_acc_re.assign( stride, T( 0 ) );
+        m_acc_im.assign( stride, T( 0 ) );
+        m_fdl_re.assign( slots * stride, T( 0 ) );
+        m_fdl_im.assign( slots * stride, T( 0 ) );
+        m_newest = 0;
+        m_pos = 0;
+    }
+
+    shared_ptr<response_type const> const &getResponse() const
+    {
+        return m_response;
+    }
+
+    /// Clear the history
+    void reset() { setResponse( m_response ); }
+
+    /// Process frames samples from in to out with denormals flushed to
+    /// zero. in and out may be the same buffer.
+    void process( T const *in, T *out, size_t frames )
+    {
+        DenormalGuard guard;
+        size_t const b = m_response->blockSize();
+        T const *head = m_response->head();
+        for ( size_t i = 0; i < frames; ++i )
+        {
+            m_window[b + m_pos] = in[i];
+            out[i] = dot( head, &m_window[m_pos + 1], b )
+                     + m_tail[m_pos];
+            if ( ++m_pos == b )
+            {
+                advance();
+                m_pos = 0;
+            }
+        }
+    }
+
+    /// Process frames samples of buf in place
+    void processInPlace( T *buf, size_t frames )
+    {
+        process( buf, buf, frames );
+    }
+
+  private:
+    static T dot( T const *a, T const *b, size_t n )
+    {
+        size_t const full = n - n % width;
+        vector_type acc, va, vb;
+        zero( acc );
+        for ( size_t i = 0; i < full; i += width )
+        {
+            loadu( va, a + i );
+            loadu( vb, b + i );
+            acc += va * vb;
+        }
+        T r = T( 0 );
+        for ( size_t i = 0; i < size_t( width ); ++i )
+        {
+            r += acc[i];
+        }
+        for ( size_t i = full; i < n; ++i )
+        {
+            r += a[i] * b[i];
+        }
+        return r;
+    }
+
+    /// A block of input is complete: push its spectrum into the delay
+    /// line and compute the later taps' share of the next block
+    void advance()
+    {
+        response_type const &r = *m_response;
+        size_t const b = r.blockSize();
+        size_t const partitions = r.partitions();
+        if ( partitions > 0 )
+        {
+            size_t const stride = r.stride();
+            m_newest = m_newest + 1 < partitions ? m_newest + 1 : 0;
+            r.plan()->forward( &m_window[0],
+                               &m_fdl_re[m_newest * stride],
+                               &m_fdl_im[m_newest * stride] );
+
+            std::fill( m_acc_re.begin(), m_acc_re.end(), T( 0 ) );
+            std::fill( m_acc_im.begin(), m_acc_im.end(), T( 0 ) );
+            size_t slot = m_newest;
+            for ( size_t p = 0; p < partitions; ++p )
+            {
+                multiplyAdd( &m_fdl_re[slot * stride],
+                             &m_fdl_im[slot * stride],
+                             r.re( p ),
+                             r.im( p ),
+                             stride );
+                slot = slot > 0 ? slot - 1 : partitions - 1;
+            }
+
+            r.plan()->inverse(
+                &m_acc_re[0], &m_acc_im[0], &m_output[0] );
+            std::copy( &m_output[b], &m_output[b] + b, &m_tail[0] );
+        }
+        std::copy( &m_window[b], &m_window[b] + b, &m_window[0] );
+    }
+
+    /// Add the product of the spectra x and h to the accumulator
+    void multiplyAdd( T const *x_re,
+                      T const *x_im,
+                      T const *h_re,
+                      T const *h_im,
+                      size_t stride )
+    {
+        T *acc_re = &m_acc_re[0];
+        T *acc_im = &m_acc_im[0];
+        for ( size_t k = 0; k < stride; k += width )
+        {
+            vector_type xr, xi, hr, hi, ar, ai;
+            loadu( xr, x_re + k );
+            loadu( xi, x_im + k );
+            loadu( hr, h_re + k );
+            loadu( hi, h_im + k );
+            loadu( ar, acc_re + k );
+            loadu( ai, acc_im + k );
+            ar += xr * hr - xi * hi;
+            ai += xr * hi + xi * hr;
+            storeu( ar, acc_re + k );
+            storeu( ai, acc_im + k );
+        }
+    }
+
+    shared_ptr<response_type const> m_response;
+
+    /// The previous block of input and the current one so far
+    std::vector<T> m_window;
+
+    /// The later taps' share of the current block of output
+    std::vector<T> m_tail;
+
+    std::vector<T> m_output;
+    std::vector<T> m_acc_re;
+    std::vector<T> m_acc_im;
+
+    /// The spectra of the last partitions() blocks, newest at m_newest
+    std::vector<T> m_fdl_re;
+    std::vector<T> m_fdl_im;
+
+    size_t m_newest;
+    size_t m_pos;
+};
+
+/// A Convolver on each of any number of planar channels.
+///
+/// Every channel has its own response and history. Responses of the
+/// same block size share one FFT plan, and channels given the same
+/// response share its partitions.
+template <typename T = float>
+class ConvolverBank
+{
+  public:
+    typedef T value_type;
+    typedef ConvolverResponse<T> response_type;
+
+    /// channels channels all convolved with response
+    ConvolverBank( size_t channels,
+                   shared_ptr<response_type const> const &response )
+        : m_convolvers( channels, Convolver<T>( response ) )
+    {
+    }
+
+    size_t channels() const { return m_convolvers.size(); }
+
+    /// Change the response of one channel, clearing its history
+    void setResponse( size_t channel,
+                      shared_ptr<response_type const> const &response )
+    {
+        m_convolvers.at( channel ).setResponse( response );
+    }
+
+    Convolver<T> &channel( size_t channel )
+    {
+        return m_convolvers.at( channel );
+    }
+
+    /// Clear the history of every channel
+    void reset()
+    {
+        for ( size_t c = 0; c < m_convolvers.size(); ++c )
+        {
+            m_convolvers[c].reset();
+        }
+    }
+
+    /// Process frames samples of each planar channel from in[channel]
+    /// to out[channel]. in and out may point to the same buffers.
+    void process( T const *const *in, T *const *out, size_t frames )
+    {
+        for ( size_t c = 0; c < m_convolvers.size(); ++c )
+        {
+            m_convolvers[c].process( in[c], out[c], frames );
+        }
+    }
+
+    /// Process frames samples of each planar buffer in place
+    void processInPlace( T *const *buf, size_t frames )
+    {
+        process( buf, buf, frames );
+    }
+
+  private:
+    std::vector<Convolver<T> > m_convolvers;
+};
+}
+}
+
+#endif
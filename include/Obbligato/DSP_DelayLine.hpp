@@ -0,0 +1,353 @@
+#pragma once
+/*
+ Copyright (c) 2013, J.D. Koftinoff Software, Ltd.
+ <jeffk@jdkoftinoff.com>
+ http://www.jdkoftinoff.com/
+ All rights reserved.
+
+ Permission to use, copy, modify, and/or distribute this software for
+ any
+ purpose with or without fee is hereby granted, provided that the above
+ copyright notice and this permission notice appear in all copies.
+
+ THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ WARRANTIES
+ WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "Obbligato/World.hpp"
+#include "Obbligato/SIMD.hpp"
+#include "Obbligato/Pools.hpp"
+
+#if __cplusplus >= 201103L
+
+namespace Obbligato
+{
+namespace DSP
+{
+
+using namespace SIMD;
+
+/// How DelayLine reads between samples
+enum DelayInterpolation
+{
+    /// The nearest sample
+    delay_integer,
+    /// Linear between the two nearest samples
+    delay_linear,
+    /// Cubic Hermite through the four nearest samples. Delays must be
+    /// at least 1.
+    delay_cubic,
+    /// A first order allpass, flat in magnitude but with state, so the
+    /// delay should change smoothly between reads. Delays must be at
+    /// least 0.5.
+    delay_allpass
+};
+
+/// A multi channel delay line with fractional reads, for modulated
+/// effects such as chorus and doppler, and for latency alignment.
+///
+/// The buffer is a power of two number of frames, so positions wrap
+/// with a mask, and is allocated from a Pools like DynamicChain's
+/// nodes. Each frame holds every channel side by side, padded to a
+/// whole number of native SIMD registers, so a read at one delay
+/// interpolates all the channels a register at a time.
+///
+/// write() appends a block of frames. read() then reads the same block
+/// back at one delay, and readModulated() at a delay per frame; a
+/// delay of 0 gives the block that was written. writeFrame() and
+/// readFrame() do the same a frame at a time. Delays outside the range
+/// the interpolation can read are clamped to it.
+///
+/// Allpass reads keep state between calls, so each modulated stream of
+/// reads, such as one voice of a chorus, uses its own tap, numbered
+/// from 0 to taps() - 1. Reads of other kinds ignore the tap.
+template <typename T = float>
+class DelayLine
+{
+  public:
+    typedef T value_type;
+    typedef SIMD_Vector<T, simd_native_size<T>::value> vector_type;
+
+    enum
+    {
+        width = simd_native_size<T>::value
+    };
+
+    DelayLine( DelayLine const & ) = delete;
+    DelayLine &operator=( DelayLine const & ) = delete;
+
+    /// channels channels delayed by up to max_delay frames, written and
+    /// read up to max_frames frames at a time, with taps allpass taps
+    DelayLine( Pools &pools,
+               size_t channels,
+               size_t max_delay,
+               size_t max_frames = 256,
+               size_t taps = 1 )
+        : m_pools( pools )
+        , m_channels( channels )
+        , m_stride( ( channels + width - 1 ) / width * width )
+        , m_max_delay( max_delay )
+        , m_max_frames( max_frames )
+        , m_taps( taps )
+        , m_capacity( 1 )
+        , m_written( 0 )
+        , m_memory( 0 )
+    {
+        if ( channels == 0 )
+        {
+            throw std::invalid_argument(
+                "DelayLine needs at least one channel" );
+        }
+
+        // room for the longest delay of the oldest frame of a block,
+        // and the sample beyond it that cubic reads use
+        while ( m_capacity < max_delay + max_frames + 3 )
+        {
+            m_capacity *= 2;
+        }
+
+        // the buffer, then the allpass state of each tap and one frame
+        // of scratch
+        size_t const items = ( m_capacity + m_taps + 1 ) * m_stride;
+        size_t const alignment = alignof( vector_type );
+        m_memory = m_pools.allocateElement( items * sizeof( T )
+                                            + alignment - 1 );
+        if ( !m_memory )
+        {
+            throw std::bad_alloc();
+        }
+        uintptr_t p = reinterpret_cast<uintptr_t>( m_memory );
+        p = ( p + alignment - 1 ) & ~uintptr_t( alignment - 1 );
+        m_buffer = reinterpret_cast<T *>( p );
+        m_allpass = m_buffer + m_capacity * m_stride;
+        m_frame = m_allpass + m_taps * m_stride;
+        reset();
+    }
+
+    ~DelayLine() { m_pools.deallocateElement( m_memory ); }
+
+    size_t channels() const { return m_channels; }
+
+    size_t maxDelay() const { return m_max_delay; }
+
+    size_t maxFrames() const { return m_max_frames; }
+
+    size_t taps() const { return m_taps; }
+
+    /// The number of frames in the buffer, a power of two
+    size_t capacity() const { return m_capacity; }
+
+    /// Fill the buffer with silence and clear the allpass state
+    void reset()
+    {
+        std::fill( m_buffer,
+                   m_buffer + ( m_capacity + m_taps + 1 ) * m_stride,
+                   T( 0 ) );
+    }
+
+    /// Append frames frames of the planar channels in[channel]. frames
+    /// must be at most maxFrames().
+    void write( T const *const *in, size_t frames )
+    {
+        if ( frames > m_max_frames )
+        {
+            throw std::out_of_range( "DelayLine::write" );
+        }
+        for ( size_t i = 0; i < frames; ++i )
+        {
+            T *row = rowAt( m_written + i );
+            for ( size_t c = 0; c < m_channels; ++c )
+            {
+                row[c] = in[c][i];
+            }
+        }
+        m_written += frames;
+    }
+
+    /// Append one frame of channels() samples
+    void writeFrame( T const *frame )
+    {
+        std::copy( frame, frame + m_channels, rowAt( m_written ) );
+        ++m_written;
+    }
+
+    /// Read the last frames frames written, delayed by delay frames,
+    /// into the planar channels out[channel]. frames must be at most
+    /// maxFrames() and the number of frames written.
+    void read( T *const *out,
+               size_t frames,
+               double delay,
+               DelayInterpolation interpolation,
+               size_t tap = 0 )
+    {
+        checkRead( frames, tap );
+        size_t const first = m_written - frames;
+        for ( size_t i = 0; i < frames; ++i )
+        {
+            interpolate( first + i, delay, interpolation, tap );
+            for ( size_t c = 0; c < m_channels; ++c )
+            {
+                out[c][i] = m_frame[c];
+            }
+        }
+    }
+
+    /// Read the last frames frames written, frame i delayed by
+    /// delays[i] frames, into the planar channels out[channel]
+    void readModulated( T *const *out,
+                        size_t frames,
+                        T const *delays,
+                        DelayInterpolation interpolation,
+                        size_t tap = 0 )
+    {
+        checkRead( frames, tap );
+        size_t const first = m_written - frames;
+        for ( size_t i = 0; i < frames; ++i )
+        {
+            interpolate( first + i, delays[i], interpolation, tap );
+            for ( size_t c = 0; c < m_channels; ++c )
+            {
+                out[c][i] = m_frame[c];
+            }
+        }
+    }
+
+    /// Read one frame of channels() samples, delay frames before the
+    /// last frame written
+    void readFrame( T *frame,
+                    double delay,
+                    DelayInterpolation interpolation,
+                    size_t tap = 0 )
+    {
+        checkRead( 1, tap );
+        interpolate( m_written - 1, delay, interpolation, tap );
+        std::copy( m_frame, m_frame + m_channels, frame );
+    }
+
+  private:
+    void checkRead( size_t frames, size_t tap ) const
+    {
+        if ( frames > m_max_frames || frames > m_written
+             || tap >= m_taps )
+        {
+            throw std::out_of_range( "DelayLine::read" );
+        }
+    }
+
+    T *rowAt( size_t t ) const
+    {
+        return m_buffer + ( t & ( m_capacity - 1 ) ) * m_stride;
+    }
+
+    /// Interpolate every channel at delay frames before frame t into
+    /// m_frame, through the allpass state of tap for allpass reads
+    void interpolate( size_t t,
+                      double delay,
+                      DelayInterpolation interpolation,
+                      size_t tap )
+    {
+        double const low = interpolation == delay_cubic
+                               ? 1.0
+                               : interpolation == delay_allpass ? 0.5
+                                                                : 0.0;
+        double const high = double( m_max_delay );
+        delay = delay < low ? low : delay > high ? high : delay;
+
+        if ( interpolation == delay_integer )
+        {
+            size_t d = size_t( delay + 0.5 );
+            T const *row = rowAt( t - d );
+            std::copy( row, row + m_stride, m_frame );
+            return;
+        }
+
+        if ( interpolation == delay_allpass )
+        {
+            // keep the allpass's own delay in [0.5, 1.5), where its
+            // delay is flattest across frequency
+            size_t d = size_t( delay - 0.5 );
+            T const f = T( delay - double( d ) );
+            T const a = ( T( 1 ) - f ) / ( T( 1 ) + f );
+            T const *x0 = rowAt( t - d );
+            T const *x1 = rowAt( t - d - 1 );
+            T *state = m_allpass + tap * m_stride;
+            for ( size_t c = 0; c < m_stride; c += width )
+            {
+                vector_type v0, v1, y;
+                loadu( v0, x0 + c );
+                loadu( v1, x1 + c );
+                loadu( y, state + c );
+                y = v1 + ( v0 - y ) * a;
+                storeu( y, state + c );
+                storeu( y, m_frame + c );
+            }
+            return;
+        }
+
+        size_t d = size_t( delay );
+        T const f = T( delay - double( d ) );
+        if ( interpolation == delay_linear )
+        {
+            T const *x0 = rowAt( t - d );
+            T const *x1 = rowAt( t - d - 1 );
+            for ( size_t c = 0; c < m_stride; c += width )
+            {
+                vector_type v0, v1;
+                loadu( v0, x0 + c );
+                loadu( v1, x1 + c );
+                storeu( v0 + ( v1 - v0 ) * f, m_frame + c );
+            }
+            return;
+        }
+
+        // cubic hermite between x0 and x1, from xm1 = x[t - d + 1] to
+        // x2 = x[t - d - 2]
+        T const *xm1 = rowAt( t - d + 1 );
+        T const *x0 = rowAt( t - d );
+        T const *x1 = rowAt( t - d - 1 );
+        T const *x2 = rowAt( t - d - 2 );
+        T const half = T( 0.5 );
+        for ( size_t c = 0; c < m_stride; c += width )
+        {
+            vector_type vm1, v0, v1, v2;
+            loadu( vm1, xm1 + c );
+            loadu( v0, x0 + c );
+            loadu( v1, x1 + c );
+            loadu( v2, x2 + c );
+            vector_type c1 = ( v1 - vm1 ) * half;
+            vector_type c2
+                = vm1 - v0 * T( 2.5 ) + v1 * T( 2 ) - v2 * half;
+            vector_type c3
+                = ( v2 - vm1 ) * half + ( v0 - v1 ) * T( 1.5 );
+            vector_type y = ( ( c3 * f + c2 ) * f + c1 ) * f + v0;
+            storeu( y, m_frame + c );
+        }
+    }
+
+    Pools &m_pools;
+    size_t m_channels;
+    size_t m_stride;
+    size_t m_max_delay;
+    size_t m_max_frames;
+    size_t m_taps;
+    size_t m_capacity;
+
+    /// The number of frames ever written. Frame t is in row t modulo
+    /// m_capacity.
+    size_t m_written;
+
+    void *m_memory;
+    T *m_buffer;
+    T *m_allpass;
+    T *m_frame;
+};
+}
+}
+
+#endif
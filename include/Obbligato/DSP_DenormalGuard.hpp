@@ -0,0 +1,122 @@
+#pragma once
+/*
+ Copyright (c) 2013, J.D. Koftinoff Software, Ltd.
+ <jeffk@jdkoftinoff.com>
+ http://www.jdkoftinoff.com/
+ All rights reserved.
+
+ Permission to use, copy, modify, and/or distribute this software for
+ any
+ purpose with or without fee is hereby granted, provided that the above
+ copyright notice and this permission notice appear in all copies.
+
+ THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ WARRANTIES
+ WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "Obbligato/World.hpp"
+
+#if defined( __SSE__ ) || defined( _M_X64 )
+#include <xmmintrin.h>
+#endif
+
+namespace Obbligato
+{
+namespace DSP
+{
+
+/// Flush denormal floating point values to zero for the lifetime of the
+/// guard, restoring the previous mode when it goes out of scope.
+///
+/// Recursive filters such as Biquad and Gain decay into denormal values
+/// when their input goes silent, and arithmetic on denormals is many
+/// times slower on most CPUs. On x86 this sets the FTZ and DAZ bits of
+/// MXCSR and on ARM the FZ bit of FPCR / FPSCR. The mode is per thread.
+class DenormalGuard
+{
+  public:
+    DenormalGuard() : m_previous( getMode() )
+    {
+        setMode( m_previous | flushMask() );
+    }
+
+    ~DenormalGuard() { setMode( m_previous ); }
+
+    /// True when this platform can flush denormals to zero
+    static bool isSupported() { return flushMask() != 0; }
+
+    /// True when denormals are currently flushed to zero
+    static bool isActive()
+    {
+        return isSupported()
+               && ( getMode() & flushMask() ) == flushMask();
+    }
+
+  private:
+    DenormalGuard( DenormalGuard const & );
+    DenormalGuard &operator=( DenormalGuard const & );
+
+#if defined( __SSE__ ) || defined( _M_X64 )
+    typedef unsigned int mode_type;
+
+    /// MXCSR flush to zero (0x8000) and denormals are zero (0x0040)
+    static mode_type flushMask() { return 0x8040; }
+
+    static mode_type getMode() { return _mm_getcsr(); }
+
+    static void setMode( mode_type v ) { _mm_setcsr( v ); }
+#elif defined( __aarch64__ )
+    typedef uint64_t mode_type;
+
+    /// FPCR flush to zero
+    static mode_type flushMask() { return mode_type( 1 ) << 24; }
+
+    static mode_type getMode()
+    {
+        mode_type v;
+        __asm__ __volatile__( "mrs %0, fpcr" : "=r"( v ) );
+        return v;
+    }
+
+    static void setMode( mode_type v )
+    {
+        __asm__ __volatile__( "msr fpcr, %0" : : "r"( v ) );
+    }
+#elif defined( __arm__ ) && defined( __VFP_FP__ )                     \
+    && !defined( __SOFTFP__ )
+    typedef uint32_t mode_type;
+
+    /// FPSCR flush to zero
+    static mode_type flushMask() { return mode_type( 1 ) << 24; }
+
+    static mode_type getMode()
+    {
+        mode_type v;
+        __asm__ __volatile__( "vmrs %0, fpscr" : "=r"( v ) );
+        return v;
+    }
+
+    static void setMode( mode_type v )
+    {
+        __asm__ __volatile__( "vmsr fpscr, %0" : : "r"( v ) );
+    }
+#else
+    typedef unsigned int mode_type;
+
+    static mode_type flushMask() { return 0; }
+
+    static mode_type getMode() { return 0; }
+
+    static void setMode( mode_type ) {}
+#endif
+
+    mode_type m_previous;
+};
+}
+}
@@ -0,0 +1,340 @@
+#pragma once
+/*
+ Copyright (c) 2013, J.D. Koftinoff Software, Ltd.
+ <jeffk@jdkoftinoff.com>
+ http://www.jdkoftinoff.com/
+ All rights reserved.
+
+ Permission to use, copy, modify, and/or distribute this software for
+ any
+ purpose with or without fee is hereby granted, provided that the above
+ copyright notice and this permission notice appear in all copies.
+
+ THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ WARRANTIES
+ WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "Obbligato/World.hpp"
+#include "Obbligato/SIMD.hpp"
+#include "Obbligato/IOStream.hpp"
+#include "Obbligato/Form.hpp"
+#include "Obbligato/Pools.hpp"
+#include "Obbligato/DSP_DenormalGuard.hpp"
+
+#if __cplusplus >= 201103L
+
+namespace Obbligato
+{
+namespace DSP
+{
+
+using namespace SIMD;
+
+/// A type erased block processor, one node of a DynamicChain
+template <typename T>
+class Processor
+{
+  public:
+    typedef T value_type;
+
+    virtual ~Processor() {}
+
+    /// Process frames samples from in to out, which may be the same
+    /// buffer
+    virtual void process( T const *in, T *out, size_t frames ) = 0;
+
+    /// Print the processor's coefficients and state
+    virtual void print( std::ostream &o ) const = 0;
+
+    friend std::ostream &operator<<( std::ostream &o,
+                                     Processor const &v )
+    {
+        v.print( o );
+        return o;
+    }
+};
+
+/// Adapts any plugin with a block process() method, such as Biquad,
+/// Gain or Oscillator, to a Processor
+template <typename PluginType>
+class ProcessorAdapter
+    : public Processor<typename PluginType::value_type>
+{
+  public:
+    typedef typename PluginType::value_type T;
+
+    PluginType m_plugin;
+
+    ProcessorAdapter( PluginType const &plugin ) : m_plugin( plugin ) {}
+
+    virtual void process( T const *in, T *out, size_t frames ) override
+    {
+        m_plugin.process( in, out, frames );
+    }
+
+    virtual void print( std::ostream &o ) const override
+    {
+        o << m_plugin;
+    }
+};
+
+/// A chain of plugins that can be changed at run time. Each node costs
+/// one virtual call per block. The scratch buffer comes from a Pools
+/// when the chain is made, and each node comes from it when insert()
+/// is called. The node list is reserved up front, so processing and
+/// bypassing never touch the heap.
+///
+/// Inserted nodes fade in, and removed or bypassed nodes fade out,
+/// with a linear crossfade between their input and their output over
+/// fadeFrames() samples.
+///
+/// A DynamicChain is not thread safe. insert(), remove(), setBypass(),
+/// the plugin references insert() returns and every other member must
+/// be used on the thread that calls process(), between calls to it.
+/// To edit a chain from a control thread, hand the edit to the audio
+/// thread, for example through an Atomic::TripleBuffer as Automated
+/// does for coefficients, and apply it there before process().
+template <typename T>
+class DynamicChain
+{
+  public:
+    typedef T value_type;
+    typedef typename simd_flattened_type<T>::type item_type;
+
+    /// Create a chain of up to max_nodes nodes, processing up to
+    /// max_frames samples per virtual call
+    DynamicChain( Pools &pools,
+                  size_t max_nodes = 16,
+                  size_t max_frames = 256,
+                  size_t fade_frames = 64 )
+        : m_pools( pools )
+        , m_max_frames( max_frames )
+        , m_fade_step( item_type( 1 ) / item_type( fade_frames ) )
+        , m_scratch_memory( 0 )
+        , m_scratch( 0 )
+    {
+        m_nodes.reserve( max_nodes );
+        void *p = allocate(
+            sizeof( T ) * max_frames, alignof( T ), m_scratch_memory );
+        m_scratch = static_cast<T *>( p );
+    }
+
+    ~DynamicChain()
+    {
+        for ( size_t i = 0; i < m_nodes.size(); ++i )
+        {
+            destroy( m_nodes[i] );
+        }
+        m_pools.deallocateElement( m_scratch_memory );
+    }
+
+    /// The number of nodes, including those still fading out
+    size_t size() const { return m_nodes.size(); }
+
+    /// The number of samples a crossfade takes
+    size_t fadeFrames() const
+    {
+        return size_t( 1 / m_fade_step + item_type( 0.5 ) );
+    }
+
+    /// Get the processor of node i
+    Processor<T> &operator[]( size_t i )
+    {
+        return *m_nodes[i].m_processor;
+    }
+
+    /// Get the processor of node i (const)
+    Processor<T> const &operator[]( size_t i ) const
+    {
+        return *m_nodes[i].m_processor;
+    }
+
+    /// Insert a copy of plugin before node position, fading it in.
+    /// Returns the copy, so that its coefficients can be changed later.
+    template <typename PluginType>
+    PluginType &insert( size_t position, PluginType const &plugin )
+    {
+        typedef ProcessorAdapter<PluginType> adapter_type;
+        if ( m_nodes.size() == m_nodes.capacity() )
+        {
+            throw std::length_error( "DynamicChain" );
+        }
+        if ( position > m_nodes.size() )
+        {
+            throw std::out_of_range( "DynamicChain" );
+        }
+
+        Node node;
+        void *p = allocate( sizeof( adapter_type ),
+                            alignof( adapter_type ),
+                            node.m_memory );
+        adapter_type *adapter = new ( p ) adapter_type( plugin );
+        node.m_processor = adapter;
+        node.m_gain = 0;
+        node.m_target = 1;
+        node.m_removing = false;
+        m_nodes.insert( m_nodes.begin() + position, node );
+        return adapter->m_plugin;
+    }
+
+    /// Append a copy of plugin to the end of the chain
+    template <typename PluginType>
+    PluginType &pushBack( PluginType const &plugin )
+    {
+        return insert( m_nodes.size(), plugin );
+    }
+
+    /// Fade node position out and remove it once it is silent
+    void remove( size_t position )
+    {
+        Node &node = m_nodes.at( position );
+        node.m_target = 0;
+        node.m_removing = true;
+    }
+
+    /// Fade node position out, or back in
+    void setBypass( size_t position, bool bypass )
+    {
+        m_nodes.at( position ).m_target = bypass ? 0 : 1;
+    }
+
+    /// True when node position is bypassed or being removed
+    bool isBypassed( size_t position ) const
+    {
+        return m_nodes.at( position ).m_target == 0;
+    }
+
+    /// Process frames samples from in to out with denormals flushed to
+    /// zero. in and out may be the same buffer.
+    void process( T const *in, T *out, size_t frames )
+    {
+        DenormalGuard guard;
+        if ( in != out )
+        {
+            std::copy( in, in + frames, out );
+        }
+
+        for ( size_t pos = 0; pos < frames; pos += m_max_frames )
+        {
+            size_t n = frames - pos < m_max_frames ? frames - pos
+                                                   : m_max_frames;
+            for ( size_t i = 0; i < m_nodes.size(); ++i )
+            {
+                processNode( m_nodes[i], out + pos, n );
+            }
+        }
+
+        // nodes that have finished fading out leave the chain
+        for ( size_t i = 0; i < m_nodes.size(); )
+        {
+            if ( m_nodes[i].m_removing && m_nodes[i].m_gain == 0 )
+            {
+                destroy( m_nodes[i] );
+                m_nodes.erase( m_nodes.begin() + i );
+            }
+            else
+            {
+                ++i;
+            }
+        }
+    }
+
+    /// Process frames samples of buf in place
+    void processInPlace( T *buf, size_t frames )
+    {
+        process( buf, buf, frames );
+    }
+
+    friend std::ostream &operator<<( std::ostream &o,
+                                     DynamicChain const &v )
+    {
+        using namespace IOStream;
+        for ( size_t i = 0; i < v.size(); ++i )
+        {
+            o << title_fmt( form<128>( "item[%d]", int( i ) ) )
+              << std::endl;
+            o << v[i] << std::endl;
+        }
+        return o;
+    }
+
+  private:
+    DynamicChain( DynamicChain const & );
+    DynamicChain &operator=( DynamicChain const & );
+
+    struct Node
+    {
+        Processor<T> *m_processor;
+        void *m_memory;
+        item_type m_gain;
+        item_type m_target;
+        bool m_removing;
+    };
+
+    void processNode( Node &node, T *buf, size_t frames )
+    {
+        if ( node.m_gain == node.m_target )
+        {
+            if ( node.m_gain != 0 )
+            {
+                node.m_processor->process( buf, buf, frames );
+            }
+            return;
+        }
+
+        // crossfade from the input to the output of the node
+        node.m_processor->process( buf, m_scratch, frames );
+        item_type gain = node.m_gain;
+        item_type step
+            = node.m_target > gain ? m_fade_step : -m_fade_step;
+        for ( size_t i = 0; i < frames; ++i )
+        {
+            if ( gain != node.m_target )
+            {
+                gain += step;
+                if ( ( step > 0 && gain > node.m_target )
+                     || ( step < 0 && gain < node.m_target ) )
+                {
+                    gain = node.m_target;
+                }
+            }
+            buf[i] += ( m_scratch[i] - buf[i] ) * gain;
+        }
+        node.m_gain = gain;
+    }
+
+    void *allocate( size_t size, size_t alignment, void *&memory )
+    {
+        memory = m_pools.allocateElement( size + alignment - 1 );
+        if ( !memory )
+        {
+            throw std::bad_alloc();
+        }
+        uintptr_t p = reinterpret_cast<uintptr_t>( memory );
+        p = ( p + alignment - 1 ) & ~uintptr_t( alignment - 1 );
+        return reinterpret_cast<void *>( p );
+    }
+
+    void destroy( Node &node )
+    {
+        node.m_processor->~Processor<T>();
+        m_pools.deallocateElement( node.m_memory );
+    }
+
+    Pools &m_pools;
+    size_t m_max_frames;
+    item_type m_fade_step;
+    std::vector<Node> m_nodes;
+    void *m_scratch_memory;
+    T *m_scratch;
+};
+}
+}
+
+#endif
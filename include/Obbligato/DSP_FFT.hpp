@@ -0,0 +1,486 @@
+#pragma once
+/*
+ Copyright (c) 2013, J.D. Koftinoff Software, Ltd.
+ <jeffk@jdkoftinoff.com>
+ http://www.jdkoftinoff.com/
+ All rights reserved.
+
+ Permission to use, copy, modify, and/or distribute this software for
+ any
+ purpose with or without fee is hereby granted, provided that the above
+ copyright notice and this permission notice appear in all copies.
+
+ THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ WARRANTIES
+ WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "Obbligato/World.hpp"
+#include "Obbligato/SIMD.hpp"
+#include "Obbligato/SharedPtr.hpp"
+
+#if __cplusplus >= 201103L
+
+#include <mutex>
+
+namespace Obbligato
+{
+namespace DSP
+{
+
+using namespace SIMD;
+
+/// A complex FFT of one power of two size from 2 to 65536, on split
+/// complex data: one array of real parts and one of imaginary parts.
+///
+/// The transform is decimation in frequency, in radix 4 stages with a
+/// final radix 2 stage when the size is an odd power of two, followed
+/// by a bit reversal. Butterflies that are at least a native SIMD
+/// register apart are computed a register at a time, with their
+/// twiddle factors stored contiguously per stage. The forward
+/// transform is unscaled and the inverse is scaled by 1 / size, so one
+/// undoes the other.
+///
+/// A plan is immutable once made, so one plan may be shared by any
+/// number of channels and threads. get() returns the shared plan for a
+/// size, making it the first time.
+template <typename T = float>
+class FFTPlan
+{
+  public:
+    typedef T value_type;
+    typedef SIMD_Vector<T, simd_native_size<T>::value> vector_type;
+
+    enum
+    {
+        width = simd_native_size<T>::value,
+        max_size = 65536
+    };
+
+    explicit FFTPlan( size_t size ) : m_size( size )
+    {
+        if ( size < 2 || size > size_t( max_size )
+             || ( size & ( size - 1 ) ) != 0 )
+        {
+            throw std::invalid_argument(
+                "FFTPlan size must be a power of 2 up to 65536" );
+        }
+
+        size_t bits = 0;
+        while ( ( size_t( 1 ) << bits ) < size )
+        {
+            ++bits;
+        }
+
+        // W^j, W^2j and W^3j with W = exp( -2 pi i / ( 4 q ) ) for
+        // each radix 4 stage of quarter length q
+        for ( size_t q = size / 4; q >= 1; q /= 4 )
+        {
+            m_quarters.push_back( q );
+            m_offsets.push_back( m_twiddles.size() );
+            for ( size_t t = 1; t <= 3; ++t )
+            {
+                for ( size_t j = 0; j < q; ++j )
+                {
+                    double angle = -OBBLIGATO_TWO_PI * double( t * j )
+                                   / double( 4 * q );
+                    m_twiddles.push_back( T( std::cos( angle ) ) );
+                }
+                for ( size_t j = 0; j < q; ++j )
+                {
+                    double angle = -OBBLIGATO_TWO_PI * double( t * j )
+                                   / double( 4 * q );
+                    m_twiddles.push_back( T( std::sin( angle ) ) );
+                }
+            }
+        }
+        m_radix2 = ( bits & 1 ) != 0;
+
+        for ( size_t i = 0; i < size; ++i )
+        {
+            size_t r = 0;
+            for ( size_t b = 0; b < bits; ++b )
+            {
+                r |= ( ( i >> b ) & 1 ) << ( bits - 1 - b );
+            }
+            if ( i < r )
+            {
+                m_swaps.push_back( uint32_t( i ) );
+                m_swaps.push_back( uint32_t( r ) );
+            }
+        }
+    }
+
+    /// The shared plan for size
+    static shared_ptr<FFTPlan const> get( size_t size )
+    {
+        static std::mutex mutex;
+        static std::map<size_t, shared_ptr<FFTPlan const> > plans;
+        std::lock_guard<std::mutex> lock( mutex );
+        shared_ptr<FFTPlan const> &plan = plans[size];
+        if ( !plan )
+        {
+            plan.reset( new FFTPlan( size ) );
+        }
+        return plan;
+    }
+
+    size_t size() const { return m_size; }
+
+    /// Transform size points of re and im in place
+    void forward( T *re, T *im ) const
+    {
+        transform( re, im );
+    }
+
+    /// Transform size points of in_re and in_im to out_re and out_im
+    void forward( T const *in_re,
+                  T const *in_im,
+                  T *out_re,
+                  T *out_im ) const
+    {
+        std::copy( in_re, in_re + m_size, out_re );
+        std::copy( in_im, in_im + m_size, out_im );
+        transform( out_re, out_im );
+    }
+
+    /// Inverse transform size points of re and im in place
+    void inverse( T *re, T *im ) const
+    {
+        // the forward transform with re and im swapped is the inverse
+        // with its outputs swapped
+        transform( im, re );
+        scale( re, im );
+    }
+
+    /// Inverse transform size points of in_re and in_im to out_re and
+    /// out_im
+    void inverse( T const *in_re,
+                  T const *in_im,
+                  T *out_re,
+                  T *out_im ) const
+    {
+        std::copy( in_re, in_re + m_size, out_re );
+        std::copy( in_im, in_im + m_size, out_im );
+        inverse( out_re, out_im );
+    }
+
+    /// Transform count channels in place, re[c] and im[c] each
+    void forwardBatch( T *const *re, T *const *im, size_t count ) const
+    {
+        for ( size_t c = 0; c < count; ++c )
+        {
+            transform( re[c], im[c] );
+        }
+    }
+
+    /// Inverse transform count channels in place
+    void inverseBatch( T *const *re, T *const *im, size_t count ) const
+    {
+        for ( size_t c = 0; c < count; ++c )
+        {
+            inverse( re[c], im[c] );
+        }
+    }
+
+  private:
+    void transform( T *re, T *im ) const
+    {
+        for ( size_t s = 0; s < m_quarters.size(); ++s )
+        {
+            size_t const q = m_quarters[s];
+            T const *w = &m_twiddles[m_offsets[s]];
+            for ( size_t block = 0; block < m_size; block += 4 * q )
+            {
+                if ( q >= size_t( width ) )
+                {
+                    radix4Vector( re + block, im + block, q, w );
+                }
+                else
+                {
+                    radix4Scalar( re + block, im + block, q, w );
+                }
+            }
+        }
+
+        if ( m_radix2 )
+        {
+            for ( size_t i = 0; i < m_size; i += 2 )
+            {
+                T r0 = re[i], i0 = im[i];
+                T r1 = re[i + 1], i1 = im[i + 1];
+                re[i] = r0 + r1;
+                im[i] = i0 + i1;
+                re[i + 1] = r0 - r1;
+                im[i + 1] = i0 - i1;
+            }
+        }
+
+        for ( size_t i = 0; i < m_swaps.size(); i += 2 )
+        {
+            std::swap( re[m_swaps[i]], re[m_swaps[i + 1]] );
+            std::swap( im[m_swaps[i]], im[m_swaps[i + 1]] );
+        }
+    }
+
+    /// One radix 4 butterfly, the same as two radix 2 decimation in
+    /// frequency stages, at offsets 0, q, 2q and 3q from j. w holds
+    /// the real then imaginary parts of W^j, W^2j and W^3j, q apart.
+    template <typename V>
+    static void butterfly( V &r0,
+                           V &i0,
+                           V &r1,
+                           V &i1,
+                           V &r2,
+                           V &i2,
+                           V &r3,
+                           V &i3,
+                           V const *w )
+    {
+        V sr02 = r0 + r2, si02 = i0 + i2;
+        V dr02 = r0 - r2, di02 = i0 - i2;
+        V sr13 = r1 + r3, si13 = i1 + i3;
+        V dr13 = r1 - r3, di13 = i1 - i3;
+
+        // y0 = s02 + s13, y1 = ( s02 - s13 ) W^2j,
+        // y2 = ( d02 - i d13 ) W^j, y3 = ( d02 + i d13 ) W^3j
+        V ar = sr02 - sr13, ai = si02 - si13;
+        V br = dr02 + di13, bi = di02 - dr13;
+        V cr = dr02 - di13, ci = di02 + dr13;
+
+        r0 = sr02 + sr13;
+        i0 = si02 + si13;
+        r1 = ar * w[2] - ai * w[3];
+        i1 = ar * w[3] + ai * w[2];
+        r2 = br * w[0] - bi * w[1];
+        i2 = br * w[1] + bi * w[0];
+        r3 = cr * w[4] - ci * w[5];
+        i3 = cr * w[5] + ci * w[4];
+    }
+
+    void radix4Scalar( T *re, T *im, size_t q, T const *w ) const
+    {
+        for ( size_t j = 0; j < q; ++j )
+        {
+            T tw[6];
+            for ( size_t t = 0; t < 6; ++t )
+            {
+                tw[t] = w[t * q + j];
+            }
+            butterfly( re[j],
+                       im[j],
+                       re[j + q],
+                       im[j + q],
+                       re[j + 2 * q],
+                       im[j + 2 * q],
+                       re[j + 3 * q],
+                       im[j + 3 * q],
+                       tw );
+        }
+    }
+
+    void radix4Vector( T *re, T *im, size_t q, T const *w ) const
+    {
+        for ( size_t j = 0; j < q; j += width )
+        {
+            vector_type v[8], tw[6];
+            for ( size_t k = 0; k < 4; ++k )
+            {
+                loadu( v[2 * k], re + j + k * q );
+                loadu( v[2 * k + 1], im + j + k * q );
+            }
+            for ( size_t t = 0; t < 6; ++t )
+            {
+                loadu( tw[t], w + t * q + j );
+            }
+            butterfly(
+                v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7], tw );
+            for ( size_t k = 0; k < 4; ++k )
+            {
+                storeu( v[2 * k], re + j + k * q );
+                storeu( v[2 * k + 1], im + j + k * q );
+            }
+        }
+    }
+
+    void scale( T *re, T *im ) const
+    {
+        T const s = T( 1 ) / T( m_size );
+        for ( size_t i = 0; i < m_size; ++i )
+        {
+            re[i] *= s;
+            im[i] *= s;
+        }
+    }
+
+    size_t m_size;
+    bool m_radix2;
+    std::vector<size_t> m_quarters;
+    std::vector<size_t> m_offsets;
+    std::vector<T> m_twiddles;
+    std::vector<uint32_t> m_swaps;
+};
+
+/// A real FFT of a power of two size from 4 to 65536, computed with a
+/// complex FFTPlan of half the size.
+///
+/// The even and odd samples are packed as the real and imaginary parts
+/// of size / 2 complex points, transformed, and separated into the
+/// size / 2 + 1 bins from 0 to nyquist. Like FFTPlan, a plan may be
+/// shared, and get() returns the shared plan for a size.
+template <typename T = float>
+class RealFFTPlan
+{
+  public:
+    typedef T value_type;
+
+    explicit RealFFTPlan( size_t size )
+        : m_size( checkSize( size ) )
+        , m_half( FFTPlan<T>::get( size / 2 ) )
+    {
+        for ( size_t k = 0; k <= size / 4; ++k )
+        {
+            double angle
+                = -OBBLIGATO_TWO_PI * double( k ) / double( size );
+            m_cos.push_back( T( std::cos( angle ) ) );
+            m_sin.push_back( T( std::sin( angle ) ) );
+        }
+    }
+
+    /// The shared plan for size
+    static shared_ptr<RealFFTPlan const> get( size_t size )
+    {
+        static std::mutex mutex;
+        static std::map<size_t, shared_ptr<RealFFTPlan const> > plans;
+        std::lock_guard<std::mutex> lock( mutex );
+        shared_ptr<RealFFTPlan const> &plan = plans[size];
+        if ( !plan )
+        {
+            plan.reset( new RealFFTPlan( size ) );
+        }
+        return plan;
+    }
+
+    size_t size() const { return m_size; }
+
+    /// The number of bins, size / 2 + 1
+    size_t bins() const { return m_size / 2 + 1; }
+
+    /// Transform size samples of in to bins() bins of re and im
+    void forward( T const *in, T *re, T *im ) const
+    {
+        size_t const half = m_size / 2;
+        for ( size_t n = 0; n < half; ++n )
+        {
+            re[n] = in[2 * n];
+            im[n] = in[2 * n + 1];
+        }
+        m_half->forward( re, im );
+
+        T const r0 = re[0], i0 = im[0];
+        re[0] = r0 + i0;
+        im[0] = 0;
+        re[half] = r0 - i0;
+        im[half] = 0;
+
+        T const hk = T( 0.5 );
+        for ( size_t k = 1; k <= half / 2; ++k )
+        {
+            size_t const m = half - k;
+            T er = ( re[k] + re[m] ) * hk, ei = ( im[k] - im[m] ) * hk;
+            T or_ = ( im[k] + im[m] ) * hk, oi = ( re[m] - re[k] ) * hk;
+            T wr = or_ * m_cos[k] - oi * m_sin[k];
+            T wi = or_ * m_sin[k] + oi * m_cos[k];
+            re[k] = er + wr;
+            im[k] = ei + wi;
+            re[m] = er - wr;
+            im[m] = wi - ei;
+        }
+    }
+
+    /// Inverse transform bins() bins of re and im to size samples of
+    /// out, scaled so that it undoes forward(). re and im are used as
+    /// scratch space and are overwritten.
+    void inverse( T *re, T *im, T *out ) const
+    {
+        size_t const half = m_size / 2;
+        T const hk = T( 0.5 );
+        T const x0 = re[0], xh = re[half];
+        re[0] = ( x0 + xh ) * hk;
+        im[0] = ( x0 - xh ) * hk;
+
+        for ( size_t k = 1; k <= half / 2; ++k )
+        {
+            size_t const m = half - k;
+            T er = ( re[k] + re[m] ) * hk, ei = ( im[k] - im[m] ) * hk;
+            T wr = ( re[k] - re[m] ) * hk, wi = ( im[k] + im[m] ) * hk;
+            // O = conj( W^k ) ( X[k] - conj( X[m] ) ) / 2
+            T or_ = wr * m_cos[k] + wi * m_sin[k];
+            T oi = wi * m_cos[k] - wr * m_sin[k];
+            // Z[k] = E + i O, Z[m] = conj( E ) + i conj( O )
+            re[k] = er - oi;
+            im[k] = ei + or_;
+            re[m] = er + oi;
+            im[m] = or_ - ei;
+        }
+
+        m_half->inverse( re, im );
+        for ( size_t n = 0; n < half; ++n )
+        {
+            out[2 * n] = re[n];
+            out[2 * n + 1] = im[n];
+        }
+    }
+
+    /// Transform count channels, in[c] to re[c] and im[c]
+    void forwardBatch( T const *const *in,
+                       T *const *re,
+                       T *const *im,
+                       size_t count ) const
+    {
+        for ( size_t c = 0; c < count; ++c )
+        {
+            forward( in[c], re[c], im[c] );
+        }
+    }
+
+    /// Inverse transform count channels, re[c] and im[c] to out[c]
+    void inverseBatch( T *const *re,
+                       T *const *im,
+                       T *const *out,
+                       size_t count ) const
+    {
+        for ( size_t c = 0; c < count; ++c )
+        {
+            inverse( re[c], im[c], out[c] );
+        }
+    }
+
+  private:
+    /// Return size if it is a power of 2 from 4 to 65536, before the
+    /// half size plan is made
+    static size_t checkSize( size_t size )
+    {
+        if ( size < 4 || size > size_t( FFTPlan<T>::max_size )
+             || ( size & ( size - 1 ) ) != 0 )
+        {
+            throw std::invalid_argument( "RealFFTPlan size must be a "
+                                         "power of 2 from 4 to 65536" );
+        }
+        return size;
+    }
+
+    size_t m_size;
+    shared_ptr<FFTPlan<T> const> m_half;
+    std::vector<T> m_cos;
+    std::vector<T> m_sin;
+};
+}
+}
+
+#endif
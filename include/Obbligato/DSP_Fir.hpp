@@ -0,0 +1,260 @@
+#pragma once
+/*
+ Copyright (c) 2013, J.D. Koftinoff Software, Ltd.
+ <jeffk@jdkoftinoff.com>
+ http://www.jdkoftinoff.com/
+ All rights reserved.
+
+ Permission to use, copy, modify, and/or distribute this software for
+ any
+ purpose with or without fee is hereby granted, provided that the above
+ copyright notice and this permission notice appear in all copies.
+
+ THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ WARRANTIES
+ WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "Obbligato/World.hpp"
+#include "Obbligato/SIMD.hpp"
+#include "Obbligato/IOStream.hpp"
+#include "Obbligato/DSP_DenormalGuard.hpp"
+
+#if __cplusplus >= 201103L
+
+namespace Obbligato
+{
+namespace DSP
+{
+
+using namespace SIMD;
+
+/// The dot product of n items of a and b, n a multiple of the native
+/// SIMD width. Four registers are accumulated independently so that
+/// consecutive multiply adds do not wait on each other.
+template <typename T>
+inline T fir_dot( T const *a, T const *b, size_t n )
+{
+    typedef SIMD_Vector<T, simd_native_size<T>::value> vector_type;
+    size_t const w = simd_native_size<T>::value;
+    size_t const unrolled = n - n % ( w * 4 );
+
+    vector_type acc0, acc1, acc2, acc3, va, vb;
+    zero( acc0 );
+    zero( acc1 );
+    zero( acc2 );
+    zero( acc3 );
+    for ( size_t i = 0; i < unrolled; i += w * 4 )
+    {
+        loadu( va, a + i );
+        loadu( vb, b + i );
+        acc0 += va * vb;
+        loadu( va, a + i + w );
+        loadu( vb, b + i + w );
+        acc1 += va * vb;
+        loadu( va, a + i + w * 2 );
+        loadu( vb, b + i + w * 2 );
+        acc2 += va * vb;
+        loadu( va, a + i + w * 3 );
+        loadu( vb, b + i + w * 3 );
+        acc3 += va * vb;
+    }
+    for ( size_t i = unrolled; i < n; i += w )
+    {
+        loadu( va, a + i );
+        loadu( vb, b + i );
+        acc0 += va * vb;
+    }
+
+    acc0 += acc1;
+    acc2 += acc3;
+    acc0 += acc2;
+    T r = T( 0 );
+    for ( size_t i = 0; i < w; ++i )
+    {
+        r += acc0[i];
+    }
+    return r;
+}
+
+/// A direct form FIR filter for short kernels, where an FFT Convolver
+/// costs more than it saves.
+///
+/// The history is a circular buffer of twice the padded kernel length
+/// with every input written to both halves, so the newest taps() inputs
+/// are always contiguous and each output is one fir_dot() of them with
+/// the reversed kernel. The kernel is padded at its old end with zeros
+/// to a whole number of native SIMD registers: 4 floats with SSE or
+/// NEON, 8 with AVX.
+///
+/// Besides process(), which filters at the input rate, decimate() keeps
+/// one output in factor and interpolate() inserts factor - 1 zeros
+/// after each input and filters at the output rate. Both compute only
+/// the outputs that are kept, interpolate() by splitting the kernel
+/// into factor polyphase kernels of taps() / factor. The kernel of an
+/// interpolator should include its gain of factor. All three share one
+/// history.
+template <typename T = float>
+class Fir
+{
+  public:
+    typedef T value_type;
+
+    enum
+    {
+        width = simd_native_size<T>::value
+    };
+
+    /// A filter with count taps of kernel, the first applied to the
+    /// newest input, decimating or interpolating by factor
+    Fir( T const *kernel, size_t count, size_t factor = 1 )
+        : m_count( count ), m_factor( factor )
+    {
+        if ( count == 0 || factor == 0 )
+        {
+            throw std::invalid_argument(
+                "Fir needs taps and a factor of at least 1" );
+        }
+
+        m_padded = padded( count );
+        m_taps.assign( m_padded, T( 0 ) );
+        for ( size_t k = 0; k < count; ++k )
+        {
+            m_taps[m_padded - 1 - k] = kernel[k];
+        }
+
+        // phase j holds taps j, j + factor, j + 2 factor ...
+        m_phase_length = padded( ( count + factor - 1 ) / factor );
+        m_phases.assign( factor * m_phase_length, T( 0 ) );
+        for ( size_t k = 0; k < count; ++k )
+        {
+            size_t j = k % factor, m = k / factor;
+            m_phases[j * m_phase_length + m_phase_length - 1 - m]
+                = kernel[k];
+        }
+
+        m_history.assign( m_padded * 2, T( 0 ) );
+        m_pos = 0;
+        m_skip = 0;
+    }
+
+    /// The number of taps
+    size_t taps() const { return m_count; }
+
+    size_t factor() const { return m_factor; }
+
+    /// Clear the history
+    void reset()
+    {
+        std::fill( m_history.begin(), m_history.end(), T( 0 ) );
+        m_pos = 0;
+        m_skip = 0;
+    }
+
+    /// Filter frames samples from in to out with denormals flushed to
+    /// zero. in and out may be the same buffer.
+    void process( T const *in, T *out, size_t frames )
+    {
+        DenormalGuard guard;
+        for ( size_t i = 0; i < frames; ++i )
+        {
+            push( in[i] );
+            out[i] = filter();
+        }
+    }
+
+    /// Filter frames samples of buf in place
+    void processInPlace( T *buf, size_t frames )
+    {
+        process( buf, buf, frames );
+    }
+
+    /// Filter frames samples of in, keeping every factor()th output
+    /// starting with the first input ever processed, and write them to
+    /// out. Returns the number written. in and out may be the same
+    /// buffer.
+    size_t decimate( T const *in, T *out, size_t frames )
+    {
+        DenormalGuard guard;
+        size_t written = 0;
+        for ( size_t i = 0; i < frames; ++i )
+        {
+            push( in[i] );
+            if ( m_skip == 0 )
+            {
+                out[written++] = filter();
+            }
+            m_skip = m_skip + 1 < m_factor ? m_skip + 1 : 0;
+        }
+        return written;
+    }
+
+    /// Upsample frames samples of in by factor(), writing frames *
+    /// factor() samples to out, which must not overlap in
+    void interpolate( T const *in, T *out, size_t frames )
+    {
+        DenormalGuard guard;
+        for ( size_t i = 0; i < frames; ++i )
+        {
+            push( in[i] );
+            T const *history = newest( m_phase_length );
+            for ( size_t j = 0; j < m_factor; ++j )
+            {
+                *out++ = fir_dot( &m_phases[j * m_phase_length],
+                                  history,
+                                  m_phase_length );
+            }
+        }
+    }
+
+    friend std::ostream &operator<<( std::ostream &o, Fir const &v )
+    {
+        using namespace IOStream;
+        o << "{ taps=" << v.m_count << " factor=" << v.m_factor
+          << " }";
+        return o;
+    }
+
+  private:
+    static size_t padded( size_t n )
+    {
+        return ( n + width - 1 ) / width * width;
+    }
+
+    void push( T value )
+    {
+        m_history[m_pos] = value;
+        m_history[m_pos + m_padded] = value;
+        m_pos = m_pos + 1 < m_padded ? m_pos + 1 : 0;
+    }
+
+    T filter() const
+    {
+        return fir_dot( &m_taps[0], newest( m_padded ), m_padded );
+    }
+
+    /// The newest n inputs, oldest first
+    T const *newest( size_t n ) const
+    {
+        return &m_history[m_pos + m_padded - n];
+    }
+
+    size_t m_count;
+    size_t m_factor;
+    size_t m_padded;
+    size_t m_phase_length;
+    std::vector<T> m_taps;
+    std::vector<T> m_phases;
+    std::vector<T> m_history;
+    size_t m_pos;
+    size_t m_skip;
+};
+}
+}
+
+#endif
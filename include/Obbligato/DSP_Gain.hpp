@@ -24,6 +24,8 @@
 #include "Obbligato/SIMD.hpp"
 #include "Obbligato/IOStream.hpp"
 #include "Obbligato/Constants.hpp"
+#include "Obbligato/DSP_DenormalGuard.hpp"
+#include "Obbligato/DSP_Response.hpp"
 
 #if __cplusplus >= 201103L
 namespace Obbligato
@@ -33,6 +35,87 @@ namespace DSP
 
 using namespace SIMD;
 
+/// Multiply frames samples of in by amplitude + deviation * ratio^n,
+/// for n from 1 to frames, writing them to out. Returns the deviation
+/// after the last sample.
+template <typename T>
+T gain_ramp( T const *in,
+             T *out,
+             size_t frames,
+             T const &amplitude,
+             T deviation,
+             T const &ratio )
+{
+    for ( size_t i = 0; i < frames; ++i )
+    {
+        deviation = deviation * ratio;
+        out[i] = in[i] * ( amplitude + deviation );
+    }
+    return deviation;
+}
+
+/// gain_ramp() for one channel of float or double, computing a whole
+/// native SIMD register of samples at a time from the powers of ratio
+template <typename T>
+T gain_ramp_scalar( T const *in,
+                    T *out,
+                    size_t frames,
+                    T amplitude,
+                    T deviation,
+                    T ratio )
+{
+    typedef SIMD_Vector<T, simd_native_size<T>::value> vector_type;
+    size_t const n = simd_native_size<T>::value;
+
+    vector_type powers, amplitudes;
+    T p = ratio;
+    for ( size_t k = 0; k < n; ++k )
+    {
+        powers[k] = p;
+        amplitudes[k] = amplitude;
+        p *= ratio;
+    }
+    T const step = powers[n - 1];
+
+    size_t const full_frames = frames - frames % n;
+    for ( size_t i = 0; i < full_frames; i += n )
+    {
+        vector_type x;
+        loadu( x, in + i );
+        x = x * ( amplitudes + powers * deviation );
+        storeu( x, out + i );
+        deviation *= step;
+    }
+    return gain_ramp( in + full_frames,
+                      out + full_frames,
+                      frames - full_frames,
+                      amplitude,
+                      deviation,
+                      ratio );
+}
+
+inline float gain_ramp( float const *in,
+                        float *out,
+                        size_t frames,
+                        float const &amplitude,
+                        float deviation,
+                        float const &ratio )
+{
+    return gain_ramp_scalar(
+        in, out, frames, amplitude, deviation, ratio );
+}
+
+inline double gain_ramp( double const *in,
+                         double *out,
+                         size_t frames,
+                         double const &amplitude,
+                         double deviation,
+                         double const &ratio )
+{
+    return gain_ramp_scalar(
+        in, out, frames, amplitude, deviation, ratio );
+}
+
 template <typename T>
 struct Gain
 {
@@ -67,10 +150,28 @@ struct Gain
         Coeffs &operator=( Coeffs const &other ) = default;
 #endif
 
+        /// The response at z1 is the flat target amplitude
         template <typename ComplexType>
         ComplexType processZDomain( size_t channel, ComplexType z1 )
         {
-            return z1 * m_amplitude;
+            (void)z1;
+            ComplexType one( 1.0, 0.0 );
+            return one * get_flattened_item( m_amplitude, channel );
+        }
+
+        /// Multiply the flat target amplitude of channel into the
+        /// split complex arrays re and im
+        template <typename G>
+        void responseZDomain( size_t channel,
+                              FrequencyGrid<G> const &grid,
+                              G *re,
+                              G *im ) const
+        {
+            response_multiply_gain(
+                grid,
+                double( get_flattened_item( m_amplitude, channel ) ),
+                re,
+                im );
         }
 
         void setTimeConstant( double sample_rate,
@@ -92,6 +193,26 @@ struct Gain
             set_flattened_item( m_amplitude, v, channel );
         }
 
+        /// Copy the coefficients of all channels to p member by member,
+        /// returning the pointer just past the last item written
+        item_type *flattenTo( item_type *p ) const
+        {
+            p = flatten_to( m_amplitude, p );
+            p = flatten_to( m_time_constant, p );
+            p = flatten_to( m_one_minus_time_constant, p );
+            return p;
+        }
+
+        /// Load the coefficients of all channels from p, in the layout
+        /// written by flattenTo()
+        item_type const *unflattenFrom( item_type const *p )
+        {
+            p = unflatten_from( m_amplitude, p );
+            p = unflatten_from( m_time_constant, p );
+            p = unflatten_from( m_one_minus_time_constant, p );
+            return p;
+        }
+
         friend std::ostream &operator<<( std::ostream &o,
                                          Coeffs const &v )
         {
@@ -116,6 +237,22 @@ struct Gain
 
         State &operator=( State const &other ) = default;
 #endif
+        /// Copy the state of all channels to p member by member,
+        /// returning the pointer just past the last item written
+        item_type *flattenTo( item_type *p ) const
+        {
+            p = flatten_to( m_current_amplitude, p );
+            return p;
+        }
+
+        /// Load the state of all channels from p, in the layout
+        /// written by flattenTo()
+        item_type const *unflattenFrom( item_type const *p )
+        {
+            p = unflatten_from( m_current_amplitude, p );
+            return p;
+        }
+
         friend std::ostream &operator<<( std::ostream &o,
                                          State const &v )
         {
@@ -140,6 +277,7 @@ struct Gain
     {
         m_coeffs = other.m_coeffs;
         m_state = other.m_state;
+        return *this;
     }
 
     T operator()( T input_value )
@@ -152,6 +290,160 @@ struct Gain
         return input_value * m_state.m_current_amplitude;
     }
 
+    /// Process frames samples from in to out with denormals flushed to
+    /// zero. in and out may be the same buffer.
+    ///
+    /// The smoothed amplitude approaches the target geometrically, so
+    /// after n samples it is amplitude + d * r^n, where d is its
+    /// current distance from the target and r is
+    /// m_one_minus_time_constant. The number of samples until every
+    /// channel is within the precision of item_type of its target is
+    /// calculated up front and only those samples are ramped. The rest
+    /// of the block, usually all of it, is copied when the gain is 1,
+    /// zeroed when it is 0 and multiplied otherwise.
+    void process( T const *in, T *out, size_t frames )
+    {
+        DenormalGuard guard;
+        T const &amplitude = m_coeffs.m_amplitude;
+        T deviation = m_state.m_current_amplitude - amplitude;
+
+        size_t ramp = rampFrames( deviation, frames );
+        if ( ramp > 0 )
+        {
+            deviation = gain_ramp( in,
+                                   out,
+                                   ramp,
+                                   amplitude,
+                                   deviation,
+                                   m_coeffs.m_one_minus_time_constant );
+        }
+        if ( ramp < frames )
+        {
+            m_state.m_current_amplitude = amplitude;
+            processStatic( in + ramp, out + ramp, frames - ramp );
+        }
+        else
+        {
+            m_state.m_current_amplitude = amplitude + deviation;
+        }
+    }
+
+    /// The number of samples, up to frames, before the amplitude of
+    /// every channel is within the precision of item_type of its
+    /// target, starting deviation away from it
+    size_t rampFrames( T const &deviation, size_t frames ) const
+    {
+        double const epsilon
+            = std::numeric_limits<item_type>::epsilon();
+        size_t ramp = 0;
+        for ( size_t i = 0; i < flattened_size && ramp < frames; ++i )
+        {
+            double d = std::abs( double(
+                get_flattened_item( deviation, i ) ) );
+            double a = std::abs( double(
+                get_flattened_item( m_coeffs.m_amplitude, i ) ) );
+            double r = std::abs( double( get_flattened_item(
+                m_coeffs.m_one_minus_time_constant, i ) ) );
+            double limit = epsilon * ( a > 1.0 ? a : 1.0 );
+
+            if ( d <= limit )
+            {
+                continue;
+            }
+            if ( r >= 1.0 )
+            {
+                return frames;
+            }
+            double n = r > 0.0
+                           ? std::ceil( std::log( limit / d )
+                                        / std::log( r ) )
+                           : 1.0;
+            if ( n >= double( frames ) )
+            {
+                return frames;
+            }
+            ramp = std::max( ramp, size_t( n ) );
+        }
+        return ramp;
+    }
+
+    /// Apply the converged amplitude to frames samples, skipping the
+    /// multiply when every channel is at unity or zero gain
+    void processStatic( T const *in, T *out, size_t frames ) const
+    {
+        T const &amplitude = m_coeffs.m_amplitude;
+        bool unity = true;
+        bool silent = true;
+        for ( size_t i = 0; i < flattened_size; ++i )
+        {
+            item_type a = get_flattened_item( amplitude, i );
+            unity = unity && a == item_type( 1 );
+            silent = silent && a == item_type( 0 );
+        }
+
+        if ( unity )
+        {
+            if ( in != out )
+            {
+                std::copy( in, in + frames, out );
+            }
+        }
+        else if ( silent )
+        {
+            T z;
+            zero( z );
+            std::fill( out, out + frames, z );
+        }
+        else
+        {
+            for ( size_t i = 0; i < frames; ++i )
+            {
+                out[i] = in[i] * amplitude;
+            }
+        }
+    }
+
+    /// Process frames samples of buf in place
+    void processInPlace( T *buf, size_t frames )
+    {
+        process( buf, buf, frames );
+    }
+
+    /// Process frames samples like process() while moving the
+    /// coefficients linearly from m_coeffs to target across the block.
+    /// m_coeffs is target afterwards.
+    void processRamped( T const *in,
+                        T *out,
+                        size_t frames,
+                        Coeffs const &target )
+    {
+        DenormalGuard guard;
+        item_type const step
+            = frames ? item_type( 1 ) / item_type( frames ) : 0;
+        T const d_amplitude
+            = ( target.m_amplitude - m_coeffs.m_amplitude ) * step;
+        T const d_time_constant
+            = ( target.m_time_constant - m_coeffs.m_time_constant )
+              * step;
+        T amplitude = m_coeffs.m_amplitude;
+        T time_constant = m_coeffs.m_time_constant;
+        T current = m_state.m_current_amplitude;
+        T unity;
+        one( unity );
+
+        for ( size_t i = 0; i < frames; ++i )
+        {
+            amplitude += d_amplitude;
+            time_constant += d_time_constant;
+            current = amplitude * time_constant
+                      + current * ( unity - time_constant );
+            out[i] = in[i] * current;
+        }
+
+        m_coeffs = target;
+        m_state.m_current_amplitude = current;
+    }
+
     friend std::ostream &operator<<( std::ostream &o, Gain const &v )
     {
         using namespace IOStream;
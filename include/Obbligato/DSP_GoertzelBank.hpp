@@ -0,0 +1,258 @@
+#pragma once
+/*
+ Copyright (c) 2013, J.D. Koftinoff Software, Ltd.
+ <jeffk@jdkoftinoff.com>
+ http://www.jdkoftinoff.com/
+ All rights reserved.
+
+ Permission to use, copy, modify, and/or distribute this software for
+ any
+ purpose with or without fee is hereby granted, provided that the above
+ copyright notice and this permission notice appear in all copies.
+
+ THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ WARRANTIES
+ WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "Obbligato/World.hpp"
+#include "Obbligato/SIMD.hpp"
+#include "Obbligato/IOStream.hpp"
+#include "Obbligato/Form.hpp"
+#include "Obbligato/DSP_Oscillator.hpp"
+
+#if __cplusplus >= 201103L
+
+namespace Obbligato
+{
+namespace DSP
+{
+
+using namespace SIMD;
+
+/// A bank of Goertzel detectors, each measuring the level of one
+/// frequency in blocks of a single input stream.
+///
+/// Each detector is the two pole resonator
+///
+///     s[n] = x[n] + 2 cos( w ) s[n-1] - s[n-2]
+///
+/// run over a block of N samples, after which the magnitude of the
+/// input at w is found from the last two states. Groups of Width
+/// detectors run one detector per lane of a SIMD_Vector<T,Width>, and
+/// several groups are run together so that their recursions overlap.
+/// For a few dozen frequencies this costs far less than an FFT of the
+/// block, and the frequencies need not lie on FFT bins.
+///
+/// Magnitudes are scaled so that a sine of amplitude A at a detector's
+/// frequency reads A. A detector resolves frequencies about
+/// sample_rate / N apart. With T = float, blocks of more than some ten
+/// thousand samples at low frequencies lose precision; use double.
+template <typename T = float, size_t Width = simd_native_size<T>::value>
+class GoertzelBank
+{
+  public:
+    typedef T value_type;
+    typedef SIMD_Vector<T, Width> vector_type;
+
+    enum
+    {
+        width = Width,
+        /// The number of groups run together
+        interleave = 4
+    };
+
+    /// detectors detectors, all at 0 Hz, reporting every block_size
+    /// samples
+    GoertzelBank( size_t detectors, size_t block_size )
+        : m_detectors( detectors )
+        , m_groups( ( detectors + Width * interleave - 1 )
+                    / ( Width * interleave ) * interleave )
+        , m_block_size( block_size )
+        , m_position( 0 )
+        , m_coeff( m_groups * Width, T( 2 ) )
+        , m_next_coeff( m_groups * Width, T( 2 ) )
+        , m_s1( m_groups * Width, T( 0 ) )
+        , m_s2( m_groups * Width, T( 0 ) )
+        , m_magnitude( detectors, T( 0 ) )
+    {
+        if ( block_size == 0 )
+        {
+            throw std::invalid_argument(
+                "GoertzelBank block size must not be 0" );
+        }
+    }
+
+    size_t detectors() const { return m_detectors; }
+
+    size_t blockSize() const { return m_block_size; }
+
+    /// Set the frequency of a detector. It takes effect at the start of
+    /// the next block, so a block part way through keeps running at the
+    /// frequency it started with.
+    void setFrequency( size_t detector,
+                       double sample_rate_recip,
+                       double frequency )
+    {
+        if ( detector >= m_detectors )
+        {
+            throw std::out_of_range( "GoertzelBank::setFrequency" );
+        }
+        m_next_coeff[detector] = T(
+            2.0 * std::cos( OBBLIGATO_TWO_PI * frequency
+                            * sample_rate_recip ) );
+    }
+
+    /// Set the frequency of a detector from a note and octave, as
+    /// Oscillator::State::setFrequencyNote() does
+    void setFrequencyNote( size_t detector,
+                           double sample_rate_recip,
+                           int octave,
+                           int note,
+                           double tuning_in_cents = 0.0,
+                           double tuning_of_a = 440.0 )
+    {
+        double tuning_multiplier
+            = pow( 2.0, tuning_in_cents * ( 1.0 / 1200.0 ) );
+        double octave_multiplier
+            = oscillator_octave_multiplier_table[octave];
+        double a_tuning_multipler = tuning_of_a * ( 1.0 / 440.0 );
+        double freq = oscillator_note_frequencies_a440[note]
+                      * tuning_multiplier * octave_multiplier
+                      * a_tuning_multipler;
+        setFrequency( detector, sample_rate_recip, freq );
+    }
+
+    /// The magnitude of a detector over the last complete block
+    T magnitude( size_t detector ) const
+    {
+        return m_magnitude.at( detector );
+    }
+
+    /// Abandon the current block
+    void reset()
+    {
+        std::fill( m_s1.begin(), m_s1.end(), T( 0 ) );
+        std::fill( m_s2.begin(), m_s2.end(), T( 0 ) );
+        m_position = 0;
+    }
+
+    /// Run frames samples of in through every detector. Returns the
+    /// number of blocks completed, and if magnitudes is not null writes
+    /// detectors() magnitudes to it for each of them in turn.
+    size_t process( T const *in, size_t frames, T *magnitudes = 0 )
+    {
+        size_t blocks = 0;
+        while ( frames > 0 )
+        {
+            if ( m_position == 0 )
+            {
+                std::copy( m_next_coeff.begin(),
+                           m_next_coeff.end(),
+                           m_coeff.begin() );
+            }
+            size_t n = m_block_size - m_position;
+            n = n < frames ? n : frames;
+            for ( size_t g = 0; g < m_groups; g += interleave )
+            {
+                run( g, in, n );
+            }
+            in += n;
+            frames -= n;
+            m_position += n;
+
+            if ( m_position == m_block_size )
+            {
+                finish( magnitudes ? magnitudes + blocks * m_detectors
+                                   : 0 );
+                ++blocks;
+            }
+        }
+        return blocks;
+    }
+
+    friend std::ostream &operator<<( std::ostream &o,
+                                     GoertzelBank const &v )
+    {
+        using namespace IOStream;
+        for ( size_t i = 0; i < v.m_detectors; ++i )
+        {
+            o << label_fmt( form<128>( "detector %d", int( i ) ) )
+              << "{ "
+              << "coeff=" << v.m_coeff[i]
+              << " magnitude=" << v.m_magnitude[i] << " }"
+              << std::endl;
+        }
+        return o;
+    }
+
+  private:
+    /// Run frames samples of in through the interleave groups from g
+    void run( size_t g, T const *in, size_t frames )
+    {
+        size_t const first = g * Width;
+        vector_type c[interleave], s1[interleave], s2[interleave];
+        for ( size_t j = 0; j < interleave; ++j )
+        {
+            loadu( c[j], &m_coeff[first + j * Width] );
+            loadu( s1[j], &m_s1[first + j * Width] );
+            loadu( s2[j], &m_s2[first + j * Width] );
+        }
+
+        for ( size_t i = 0; i < frames; ++i )
+        {
+            vector_type x;
+            splat( x, in[i] );
+            for ( size_t j = 0; j < interleave; ++j )
+            {
+                vector_type s0 = x + c[j] * s1[j] - s2[j];
+                s2[j] = s1[j];
+                s1[j] = s0;
+            }
+        }
+
+        for ( size_t j = 0; j < interleave; ++j )
+        {
+            storeu( s1[j], &m_s1[first + j * Width] );
+            storeu( s2[j], &m_s2[first + j * Width] );
+        }
+    }
+
+    /// Find the magnitude of every detector at the end of a block and
+    /// start the next
+    void finish( T *magnitudes )
+    {
+        double const scale = 2.0 / double( m_block_size );
+        for ( size_t i = 0; i < m_detectors; ++i )
+        {
+            double s1 = m_s1[i], s2 = m_s2[i];
+            double power = s1 * s1 + s2 * s2 - m_coeff[i] * s1 * s2;
+            T m = T( std::sqrt( power > 0.0 ? power : 0.0 ) * scale );
+            m_magnitude[i] = m;
+            if ( magnitudes )
+            {
+                magnitudes[i] = m;
+            }
+        }
+        reset();
+    }
+
+    size_t m_detectors;
+    size_t m_groups;
+    size_t m_block_size;
+    size_t m_position;
+    std::vector<T> m_coeff;
+    std::vector<T> m_next_coeff;
+    std::vector<T> m_s1;
+    std::vector<T> m_s2;
+    std::vector<T> m_magnitude;
+};
+}
+}
+
+#endif
@@ -0,0 +1,214 @@
+#pragma once
+/*
+ Copyright (c) 2013, J.D. Koftinoff Software, Ltd.
+ <jeffk@jdkoftinoff.com>
+ http://www.jdkoftinoff.com/
+ All rights reserved.
+
+ Permission to use, copy, modify, and/or distribute this software for
+ any
+ purpose with or without fee is hereby granted, provided that the above
+ copyright notice and this permission notice appear in all copies.
+
+ THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ WARRANTIES
+ WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "Obbligato/World.hpp"
+#include "Obbligato/DSP_DenormalGuard.hpp"
+
+#if __cplusplus >= 201103L
+
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace Obbligato
+{
+namespace DSP
+{
+
+/// One node of a GraphScheduler. run() is called once per block, on
+/// any worker thread, after all of the node's inputs have run.
+class GraphTask
+{
+  public:
+    virtual ~GraphTask() {}
+
+    virtual void run() = 0;
+};
+
+/// A GraphTask that runs a plugin's block process() method, such as
+/// a channel's Biquad or Gain. Point m_in, m_out and m_frames at the
+/// block's buffers before running the graph.
+template <typename PluginType>
+class PluginTask : public GraphTask
+{
+  public:
+    typedef typename PluginType::value_type value_type;
+
+    PluginType m_plugin;
+    value_type const *m_in;
+    value_type *m_out;
+    size_t m_frames;
+
+    PluginTask( PluginType const &plugin = PluginType() )
+        : m_plugin( plugin ), m_in( 0 ), m_out( 0 ), m_frames( 0 )
+    {
+    }
+
+    void setBuffers( value_type const *in,
+                     value_type *out,
+                     size_t frames )
+    {
+        m_in = in;
+        m_out = out;
+        m_frames = frames;
+    }
+
+    virtual void run() override
+    {
+        m_plugin.process( m_in, m_out, m_frames );
+    }
+};
+
+/// Runs a directed acyclic graph of GraphTasks once per audio block
+/// on a pool of worker threads.
+///
+/// Each worker owns a deque of ready tasks. It runs the newest task of
+/// its own deque, so a channel's next stage tends to stay on the same
+/// core and in the same cache, and when it runs dry it steals the
+/// oldest task of another worker. Ready tasks are ordered by the
+/// length of the longest path from them to the end of the graph, as
+/// measured in the previous block, so the critical path starts first.
+///
+/// The calling thread of run() works as worker 0. The others are
+/// pinned to their own cores when the platform allows it. Tasks run
+/// with denormals flushed to zero.
+class GraphScheduler
+{
+  public:
+    /// Create a scheduler with num_workers workers including the
+    /// calling thread. 0 means one per hardware thread.
+    explicit GraphScheduler( size_t num_workers = 0,
+                             bool pin_threads = true );
+
+    ~GraphScheduler();
+
+    /// Add a task to the graph and return its node index. The task is
+    /// not owned by the scheduler.
+    size_t addTask( GraphTask *task );
+
+    /// Make node to wait for node from in every block
+    void addEdge( size_t from, size_t to );
+
+    /// The number of nodes in the graph
+    size_t size() const { return m_nodes.size(); }
+
+    /// The number of workers including the calling thread
+    size_t workerCount() const { return m_num_workers; }
+
+    /// The time allowed for one block, in seconds. 0 means no deadline.
+    void setDeadline( double seconds ) { m_deadline = seconds; }
+
+    double deadline() const { return m_deadline; }
+
+    /// Run every task of the graph once and wait for them to finish.
+    /// Returns false when the block took longer than the deadline.
+    bool run();
+
+    /// The wall clock time of the last block, in seconds
+    double blockTime() const { return m_block_time; }
+
+    /// The sum of the run times of all tasks of the last block
+    double workTime() const { return m_work_time; }
+
+    /// The run time of the longest chain of dependent tasks in the
+    /// last block. No number of workers can run a block faster.
+    double criticalPathTime() const { return m_critical_path_time; }
+
+    /// The node indexes of the last block's critical path, in order
+    std::vector<size_t> const &criticalPath() const
+    {
+        return m_critical_path;
+    }
+
+    /// The number of blocks that missed the deadline
+    size_t deadlineMisses() const { return m_deadline_misses; }
+
+  private:
+    GraphScheduler( GraphScheduler const & );
+    GraphScheduler &operator=( GraphScheduler const & );
+
+    struct Node
+    {
+        GraphTask *m_task;
+        std::vector<size_t> m_successors;
+        size_t m_num_inputs;
+        double m_start;
+        double m_finish;
+        double m_rank;
+    };
+
+    /// A fixed capacity deque of ready node indexes with a spin lock
+    struct WorkDeque
+    {
+        WorkDeque() : m_head( 0 ), m_tail( 0 ) { m_lock.clear(); }
+
+        void lock()
+        {
+            while ( m_lock.test_and_set( std::memory_order_acquire ) )
+            {
+            }
+        }
+
+        void unlock() { m_lock.clear( std::memory_order_release ); }
+
+        std::atomic_flag m_lock;
+        std::vector<size_t> m_items;
+        size_t m_head;
+        size_t m_tail;
+    };
+
+    void prepare();
+    void push( size_t worker, size_t node );
+    bool popOrSteal( size_t worker, size_t &node );
+    void work( size_t worker );
+    void workerThread( size_t worker );
+    void measure();
+
+    size_t m_num_workers;
+    std::vector<Node> m_nodes;
+    std::vector<size_t> m_order;
+    std::vector<size_t> m_sources;
+    std::unique_ptr<std::atomic<size_t>[]> m_pending;
+    std::unique_ptr<WorkDeque[]> m_deques;
+    std::vector<std::thread> m_threads;
+    bool m_prepared;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::atomic<size_t> m_epoch;
+    std::atomic<bool> m_stop;
+    std::atomic<size_t> m_remaining;
+    std::atomic<size_t> m_finished;
+    std::chrono::steady_clock::time_point m_block_start;
+
+    double m_deadline;
+    double m_block_time;
+    double m_work_time;
+    double m_critical_path_time;
+    std::vector<size_t> m_critical_path;
+    size_t m_deadline_misses;
+};
+}
+}
+
+#endif
@@ -0,0 +1,440 @@
+#pragma once
+/*
+ Copyright (c) 2013, J.D. Koftinoff Software, Ltd.
+ <jeffk@jdkoftinoff.com>
+ http://www.jdkoftinoff.com/
+ All rights reserved.
+
+ Permission to use, copy, modify, and/or distribute this software for
+ any
+ purpose with or without fee is hereby granted, provided that the above
+ copyright notice and this permission notice appear in all copies.
+
+ THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ WARRANTIES
+ WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "Obbligato/World.hpp"
+#include "Obbligato/SIMD.hpp"
+#include "Obbligato/IOStream.hpp"
+#include "Obbligato/DSP_Response.hpp"
+
+#if __cplusplus >= 201103L
+
+namespace Obbligato
+{
+namespace DSP
+{
+
+using namespace SIMD;
+
+/// The kinds of noise that Noise generates
+enum NoiseType
+{
+    /// Uniform in [-1, 1)
+    noise_white,
+    /// Triangular in (-1, 1), the sum of two uniform values, as used
+    /// for dither
+    noise_tpdf,
+    /// White noise filtered to fall 3 dB per octave, at about the same
+    /// level as white
+    noise_pink
+};
+
+/// Independent xorshift128 random number streams, one per lane.
+///
+/// Every lane is updated with the same shifts and exclusive ors, in
+/// loops of a fixed number of lanes that the compiler turns into SIMD
+/// integer instructions, and the results are converted to floating
+/// point the same way. The lanes are seeded from one seed with
+/// splitmix64, so their streams do not overlap in practice.
+class NoiseGenerator
+{
+  public:
+    enum
+    {
+        lanes = 8
+    };
+
+    explicit NoiseGenerator( uint64_t seed = 1 ) { reseed( seed ); }
+
+    /// Restart every lane from seed
+    void reseed( uint64_t seed )
+    {
+        for ( size_t i = 0; i < lanes; ++i )
+        {
+            m_x[i] = splitmix( seed );
+            m_y[i] = splitmix( seed );
+            m_z[i] = splitmix( seed );
+            m_w[i] = splitmix( seed ) | 1;
+        }
+    }
+
+    /// Write count uniform values in [-1, 1) to out
+    template <typename U>
+    void white( U *out, size_t count )
+    {
+        U const scale = U( 1.0 / 2147483648.0 );
+        int32_t r[lanes];
+        size_t i = 0;
+        for ( ; i + lanes <= count; i += lanes )
+        {
+            next( r );
+            for ( size_t j = 0; j < lanes; ++j )
+            {
+                out[i + j] = U( r[j] ) * scale;
+            }
+        }
+        if ( i < count )
+        {
+            next( r );
+            for ( size_t j = 0; i + j < count; ++j )
+            {
+                out[i + j] = U( r[j] ) * scale;
+            }
+        }
+    }
+
+    /// Write count triangular values in (-1, 1) to out
+    template <typename U>
+    void tpdf( U *out, size_t count )
+    {
+        U const scale = U( 0.5 / 2147483648.0 );
+        int32_t r[lanes], s[lanes];
+        for ( size_t i = 0; i < count; i += lanes )
+        {
+            next( r );
+            next( s );
+            size_t n = count - i < size_t( lanes ) ? count - i
+                                                    : size_t( lanes );
+            for ( size_t j = 0; j < n; ++j )
+            {
+                out[i + j] = ( U( r[j] ) + U( s[j] ) ) * scale;
+            }
+        }
+    }
+
+  private:
+    static uint32_t splitmix( uint64_t &state )
+    {
+        uint64_t z = ( state += 0x9e3779b97f4a7c15ULL );
+        z = ( z ^ ( z >> 30 ) ) * 0xbf58476d1ce4e5b9ULL;
+        z = ( z ^ ( z >> 27 ) ) * 0x94d049bb133111ebULL;
+        return uint32_t( ( z ^ ( z >> 31 ) ) >> 32 );
+    }
+
+    /// Advance every lane, writing its output as a signed value
+    void next( int32_t *out )
+    {
+        for ( size_t j = 0; j < lanes; ++j )
+        {
+            uint32_t t = m_x[j] ^ ( m_x[j] << 11 );
+            m_x[j] = m_y[j];
+            m_y[j] = m_z[j];
+            m_z[j] = m_w[j];
+            m_w[j] = m_w[j] ^ ( m_w[j] >> 19 ) ^ t ^ ( t >> 8 );
+            out[j] = int32_t( m_w[j] );
+        }
+    }
+
+    uint32_t m_x[lanes];
+    uint32_t m_y[lanes];
+    uint32_t m_z[lanes];
+    uint32_t m_w[lanes];
+};
+
+/// A noise source plugin that adds white, triangular or pink noise
+/// times an amplitude to its input, like Oscillator. T may be a
+/// SIMD_Vector of channels, each with its own noise and pink filter
+/// state.
+template <typename T>
+struct Noise
+{
+    typedef T value_type;
+    typedef typename simd_flattened_type<T>::type item_type;
+
+    enum
+    {
+        vector_size = simd_size<T>::value,
+        flattened_size = simd_flattened_size<T>::value,
+        /// The number of frames generated at a time by process()
+        chunk_frames = 64
+    };
+
+    struct Coeffs
+    {
+        T m_amplitude;
+        NoiseType m_type;
+
+        Coeffs() : m_type( noise_white ) { zero( m_amplitude ); }
+
+        /// The noise is added to the input, which passes through
+        /// unchanged
+        template <typename ComplexType>
+        ComplexType processZDomain( size_t channel, ComplexType z1 )
+        {
+            (void)channel;
+            (void)z1;
+            return ComplexType( 1.0, 0.0 );
+        }
+
+        /// The input passes through unchanged
+        template <typename G>
+        void responseZDomain( size_t channel,
+                              FrequencyGrid<G> const &grid,
+                              G *re,
+                              G *im ) const
+        {
+            (void)channel;
+            (void)grid;
+            (void)re;
+            (void)im;
+        }
+
+        void setAmplitude( item_type const &v, size_t channel )
+        {
+            set_flattened_item( m_amplitude, v, channel );
+        }
+
+        /// Copy the coefficients of all channels to p member by member,
+        /// returning the pointer just past the last item written
+        item_type *flattenTo( item_type *p ) const
+        {
+            p = flatten_to( m_amplitude, p );
+            return p;
+        }
+
+        /// Load the coefficients of all channels from p, in the layout
+        /// written by flattenTo()
+        item_type const *unflattenFrom( item_type const *p )
+        {
+            p = unflatten_from( m_amplitude, p );
+            return p;
+        }
+
+        friend std::ostream &operator<<( std::ostream &o,
+                                         Coeffs const &v )
+        {
+            using namespace IOStream;
+            o << "{ "
+              << "amplitude=" << v.m_amplitude
+              << " type=" << int( v.m_type ) << " }";
+            return o;
+        }
+    };
+
+    struct State
+    {
+        NoiseGenerator m_generator;
+
+        /// The seed the noise restarts from on reset()
+        uint64_t m_seed;
+
+        /// Paul Kellet's pink filter, seven one pole sections
+        T m_b[7];
+
+        /// Each state made this way gets a seed of its own, so that
+        /// separate plugins, such as a left and right pair, produce
+        /// independent noise. A copy continues the same noise.
+        State() : m_seed( nextSeed() ) { reset(); }
+
+        explicit State( uint64_t seed ) : m_seed( seed ) { reset(); }
+
+        /// Clear the pink filter and restart the noise from m_seed
+        void reset()
+        {
+            m_generator.reseed( m_seed );
+            for ( size_t i = 0; i < 7; ++i )
+            {
+                zero( m_b[i] );
+            }
+        }
+
+        /// Clear the pink filter and restart the noise from seed
+        void reset( uint64_t seed )
+        {
+            m_seed = seed;
+            reset();
+        }
+
+        static uint64_t nextSeed()
+        {
+            static std::atomic<uint64_t> next( 1 );
+            return next.fetch_add( 1, std::memory_order_relaxed );
+        }
+
+        friend std::ostream &operator<<( std::ostream &o,
+                                         State const &v )
+        {
+            o << "{ pink=" << v.m_b[0] << " }";
+            return o;
+        }
+    };
+
+    Coeffs m_coeffs;
+    State m_state;
+
+    T operator()( T input_value )
+    {
+        T output_value;
+        generate( &output_value, 1 );
+        return output_value * m_coeffs.m_amplitude + input_value;
+    }
+
+    /// Write frames samples of noise times the amplitude to out
+    void process( T *out, size_t frames )
+    {
+        generate( out, frames );
+        for ( size_t i = 0; i < frames; ++i )
+        {
+            out[i] = out[i] * m_coeffs.m_amplitude;
+        }
+    }
+
+    /// Add frames samples of noise times the amplitude to in, writing
+    /// to out. in and out may be the same buffer.
+    void process( T const *in, T *out, size_t frames )
+    {
+        T buf[chunk_frames];
+        for ( size_t pos = 0; pos < frames; pos += chunk_frames )
+        {
+            size_t n = frames - pos < size_t( chunk_frames )
+                           ? frames - pos
+                           : size_t( chunk_frames );
+            generate( buf, n );
+            for ( size_t i = 0; i < n; ++i )
+            {
+                out[pos + i]
+                    = buf[i] * m_coeffs.m_amplitude + in[pos + i];
+            }
+        }
+    }
+
+    /// Process frames samples of buf in place
+    void processInPlace( T *buf, size_t frames )
+    {
+        process( buf, buf, frames );
+    }
+
+    friend std::ostream &operator<<( std::ostream &o, Noise const &v )
+    {
+        using namespace IOStream;
+        o << label_fmt( "coeffs" ) << v.m_coeffs << std::endl;
+        o << label_fmt( "state" ) << v.m_state << std::endl;
+        return o;
+    }
+
+  private:
+    /// Write frames samples of unscaled noise of the current type to
+    /// out
+    void generate( T *out, size_t frames )
+    {
+        for ( size_t pos = 0; pos < frames; pos += chunk_frames )
+        {
+            size_t n = frames - pos < size_t( chunk_frames )
+                           ? frames - pos
+                           : size_t( chunk_frames );
+            item_type items[chunk_frames * flattened_size];
+            if ( m_coeffs.m_type == noise_tpdf )
+            {
+                m_state.m_generator.tpdf( items, n * flattened_size );
+            }
+            else
+            {
+                m_state.m_generator.white( items, n * flattened_size );
+            }
+            for ( size_t i = 0; i < n; ++i )
+            {
+                unflatten_from( out[pos + i],
+                                items + i * flattened_size );
+            }
+            if ( m_coeffs.m_type == noise_pink )
+            {
+                pink( out + pos, n );
+            }
+        }
+    }
+
+    /// Filter frames samples of white noise in place to pink
+    void pink( T *buf, size_t frames )
+    {
+        T *b = m_state.m_b;
+        typedef item_type I;
+        I const gain = I( 0.326 );
+        for ( size_t i = 0; i < frames; ++i )
+        {
+            T const w = buf[i];
+            b[0] = b[0] * I( 0.99886 ) + w * I( 0.0555179 );
+            b[1] = b[1] * I( 0.99332 ) + w * I( 0.0750759 );
+            b[2] = b[2] * I( 0.96900 ) + w * I( 0.1538520 );
+            b[3] = b[3] * I( 0.86650 ) + w * I( 0.3104856 );
+            b[4] = b[4] * I( 0.55000 ) + w * I( 0.5329522 );
+            b[5] = b[5] * I( -0.7616 ) - w * I( 0.0168980 );
+            buf[i] = ( b[0] + b[1] + b[2] + b[3] + b[4] + b[5] + b[6]
+                       + w * I( 0.5362 ) ) * gain;
+            b[6] = w * I( 0.115926 );
+        }
+    }
+};
+
+/// Convert frames samples of in, full scale at +-1, to 16 bit integers
+/// with triangular dither of +-1 least significant bit from generator,
+/// rounding to nearest and clipping
+inline void dither_to_int16( float const *in,
+                             int16_t *out,
+                             size_t frames,
+                             NoiseGenerator &generator )
+{
+    float dither[256];
+    for ( size_t pos = 0; pos < frames; pos += 256 )
+    {
+        size_t n = frames - pos < 256 ? frames - pos : 256;
+        generator.tpdf( dither, n );
+        for ( size_t i = 0; i < n; ++i )
+        {
+            float y = std::floor( in[pos + i] * 32768.0f + dither[i]
+                                  + 0.5f );
+            y = y < -32768.0f ? -32768.0f : y > 32767.0f ? 32767.0f : y;
+            out[pos + i] = int16_t( y );
+        }
+    }
+}
+
+/// Convert frames samples of in, full scale at +-1, to packed little
+/// endian 24 bit integers, three bytes per sample, with triangular
+/// dither of +-1 least significant bit from generator, rounding to
+/// nearest and clipping
+inline void dither_to_int24( float const *in,
+                             uint8_t *out,
+                             size_t frames,
+                             NoiseGenerator &generator )
+{
+    float dither[256];
+    for ( size_t pos = 0; pos < frames; pos += 256 )
+    {
+        size_t n = frames - pos < 256 ? frames - pos : 256;
+        generator.tpdf( dither, n );
+        for ( size_t i = 0; i < n; ++i )
+        {
+            double y = std::floor( double( in[pos + i] ) * 8388608.0
+                                   + dither[i] + 0.5 );
+            y = y < -8388608.0 ? -8388608.0 : y > 8388607.0 ? 8388607.0
+                                                            : y;
+            int32_t v = int32_t( y );
+            uint8_t *p = out + ( pos + i ) * 3;
+            p[0] = uint8_t( v );
+            p[1] = uint8_t( v >> 8 );
+            p[2] = uint8_t( v >> 16 );
+        }
+    }
+}
+}
+}
+
+#endif
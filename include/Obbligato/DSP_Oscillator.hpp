@@ -24,6 +24,7 @@
 #include "Obbligato/SIMD.hpp"
 #include "Obbligato/IOStream.hpp"
 #include "Obbligato/Constants.hpp"
+#include "Obbligato/DSP_Response.hpp"
 
 #if __cplusplus >= 201103L
 
@@ -39,6 +40,131 @@ extern double oscillator_note_frequencies_a440[12];
 extern float oscillator_octave_multiplier_table_f[8];
 extern float oscillator_note_frequencies_a440_f[12];
 
+/// Write frames samples of the recursive sine with coefficient
+/// a = 2 cos( w ) and previous outputs z1 and z2, times amplitude, to
+/// out, advancing z1 and z2
+template <typename T>
+void oscillator_generate( T const &a,
+                          T &z1,
+                          T &z2,
+                          T const &amplitude,
+                          T *out,
+                          size_t frames )
+{
+    for ( size_t i = 0; i < frames; ++i )
+    {
+        T output_value = a * z1 - z2;
+        z2 = z1;
+        z1 = output_value;
+        out[i] = output_value * amplitude;
+    }
+}
+
+/// oscillator_generate() for one channel of float or double, K samples
+/// per native SIMD register at a time.
+///
+/// The Chebyshev recurrence y[n+K] = 2 cos( K w ) y[n] - y[n-K] steps
+/// a whole register of samples K ahead from the two registers before
+/// it. The first two registers are calculated directly from z1 and z2
+/// as y[k] = p[k] z1 - q[k] z2, rearranged as
+/// ( p[k] - q[k] ) z1 + q[k] ( z1 - z2 ) because at low frequencies
+/// p[k] and q[k] are both close to k and the terms nearly cancel.
+///
+/// The lanes round independently, so the last two samples of a block
+/// do not make a good state for the next one. z1 and z2 are instead
+/// moved frames samples on in double precision with
+/// p[k] = sin( ( k + 2 ) w ) / sin( w ) and
+/// q[k] = sin( ( k + 1 ) w ) / sin( w ).
+template <typename T>
+void oscillator_generate_scalar(
+    T a, T &z1, T &z2, T amplitude, T *out, size_t frames )
+{
+    size_t const K = simd_native_size<T>::value;
+    typedef SIMD_Vector<T, simd_native_size<T>::value> vector_type;
+    double const cos_w = std::max( -1.0, std::min( 1.0, 0.5 * a ) );
+    double const w = std::acos( cos_w );
+    double const sin_w = std::sin( w );
+    if ( K < 2 || frames < 2 * K || sin_w < 1e-9 )
+    {
+        oscillator_generate<T>( a, z1, z2, amplitude, out, frames );
+        return;
+    }
+
+    T r[2 * K], q[2 * K];
+    double p1 = 1, p2 = 0, q1 = 0, q2 = -1;
+    for ( size_t k = 0; k < 2 * K; ++k )
+    {
+        double pk = a * p1 - p2;
+        double qk = a * q1 - q2;
+        r[k] = T( pk - qk );
+        q[k] = T( qk );
+        p2 = p1;
+        p1 = pk;
+        q2 = q1;
+        q1 = qk;
+    }
+
+    // step by 2 - d instead of 2 cos( K w ), which for low frequencies
+    // is too close to 2 for T to hold the frequency accurately
+    T const d = T( 4.0 * std::pow( std::sin( 0.5 * K * w ), 2 ) );
+
+    T const slope = z1 - z2;
+    vector_type rv, qv, prev, cur, next;
+    loadu( rv, r );
+    loadu( qv, q );
+    prev = rv * z1 + qv * slope;
+    loadu( rv, r + K );
+    loadu( qv, q + K );
+    cur = rv * z1 + qv * slope;
+    storeu( prev * amplitude, out );
+    storeu( cur * amplitude, out + K );
+
+    size_t i = 2 * K;
+    for ( ; i + K <= frames; i += K )
+    {
+        next = cur + cur - prev - cur * d;
+        prev = cur;
+        cur = next;
+        storeu( cur * amplitude, out + i );
+    }
+    if ( i < frames )
+    {
+        T tail[K];
+        next = cur + cur - prev - cur * d;
+        storeu( next * amplitude, tail );
+        std::copy( tail, tail + frames - i, out + i );
+    }
+
+    double const n = double( frames );
+    double const s0 = std::sin( ( n - 1 ) * w );
+    double const s1 = std::sin( n * w );
+    double const s2 = std::sin( ( n + 1 ) * w );
+    double const y1 = ( s2 * z1 - s1 * z2 ) / sin_w;
+    double const y2 = ( s1 * z1 - s0 * z2 ) / sin_w;
+    z1 = T( y1 );
+    z2 = T( y2 );
+}
+
+inline void oscillator_generate( float const &a,
+                                 float &z1,
+                                 float &z2,
+                                 float const &amplitude,
+                                 float *out,
+                                 size_t frames )
+{
+    oscillator_generate_scalar( a, z1, z2, amplitude, out, frames );
+}
+
+inline void oscillator_generate( double const &a,
+                                 double &z1,
+                                 double &z2,
+                                 double const &amplitude,
+                                 double *out,
+                                 size_t frames )
+{
+    oscillator_generate_scalar( a, z1, z2, amplitude, out, frames );
+}
+
 template <typename T>
 struct Oscillator
 {
@@ -54,10 +180,50 @@ struct Oscillator
     {
         T m_amplitude;
 
+        /// The oscillator is added to the input, which passes through
+        /// unchanged
+        template <typename ComplexType>
+        ComplexType processZDomain( size_t channel, ComplexType z1 )
+        {
+            (void)channel;
+            (void)z1;
+            return ComplexType( 1.0, 0.0 );
+        }
+
+        /// The input passes through unchanged
+        template <typename G>
+        void responseZDomain( size_t channel,
+                              FrequencyGrid<G> const &grid,
+                              G *re,
+                              G *im ) const
+        {
+            (void)channel;
+            (void)grid;
+            (void)re;
+            (void)im;
+        }
+
         void setAmplitude( item_type const &v, size_t channel )
         {
             set_flattened_item( m_amplitude, v, channel );
         }
+
+        /// Copy the coefficients of all channels to p member by member,
+        /// returning the pointer just past the last item written
+        item_type *flattenTo( item_type *p ) const
+        {
+            p = flatten_to( m_amplitude, p );
+            return p;
+        }
+
+        /// Load the coefficients of all channels from p, in the layout
+        /// written by flattenTo()
+        item_type const *unflattenFrom( item_type const *p )
+        {
+            p = unflatten_from( m_amplitude, p );
+            return p;
+        }
+
         friend std::ostream &operator<<( std::ostream &o,
                                          Coeffs const &v )
         {
@@ -92,10 +258,10 @@ struct Oscillator
         {
             float w = static_cast<float>( OBBLIGATO_TWO_PI ) * frequency
                       * sample_rate_recip;
-            float temp2 = sinf( w + phase_in_radians );
+            float temp1 = -sinf( phase_in_radians );
+            float temp2 = sinf( w - phase_in_radians );
             float tempa = 2.0f * cosf( w );
-            item_type nz1;
-            zero( nz1 );
+            item_type nz1 = static_cast<item_type>( temp1 );
             item_type nz2 = static_cast<item_type>( temp2 );
             item_type na = static_cast<item_type>( tempa );
             set_flattened_item( m_z1, nz1, channel );
@@ -109,10 +275,10 @@ struct Oscillator
                            size_t channel )
         {
             double w = (OBBLIGATO_TWO_PI)*frequency * sample_rate_recip;
-            double temp2 = sin( w + phase_in_radians );
+            double temp1 = -sin( phase_in_radians );
+            double temp2 = sin( w - phase_in_radians );
             double tempa = 2.0f * cos( w );
-            item_type nz1;
-            zero( nz1 );
+            item_type nz1 = static_cast<item_type>( temp1 );
             item_type nz2 = static_cast<item_type>( temp2 );
             item_type na = static_cast<item_type>( tempa );
             set_flattened_item( m_z1, nz1, channel );
@@ -160,6 +326,52 @@ struct Oscillator
                 sample_rate_recip, freq, phase_in_radians, channel );
         }
 
+        /// Scale z1 and z2 of every channel back to unit amplitude.
+        ///
+        /// A unit sine from the recursion keeps
+        /// z1^2 + z2^2 - a z1 z2 = sin^2( w ) = 1 - a^2 / 4, and
+        /// rounding errors make the amplitude wander away from it over
+        /// a long run.
+        void renormalize()
+        {
+            for ( size_t i = 0; i < flattened_size; ++i )
+            {
+                double a = get_flattened_item( m_a, i );
+                double z1 = get_flattened_item( m_z1, i );
+                double z2 = get_flattened_item( m_z2, i );
+                double energy = z1 * z1 + z2 * z2 - a * z1 * z2;
+                double target = 1.0 - 0.25 * a * a;
+                if ( energy > 0.0 && target > 0.0 )
+                {
+                    double g = std::sqrt( target / energy );
+                    set_flattened_item(
+                        m_z1, static_cast<item_type>( z1 * g ), i );
+                    set_flattened_item(
+                        m_z2, static_cast<item_type>( z2 * g ), i );
+                }
+            }
+        }
+
+        /// Copy the state of all channels to p member by member,
+        /// returning the pointer just past the last item written
+        item_type *flattenTo( item_type *p ) const
+        {
+            p = flatten_to( m_a, p );
+            p = flatten_to( m_z1, p );
+            p = flatten_to( m_z2, p );
+            return p;
+        }
+
+        /// Load the state of all channels from p, in the layout
+        /// written by flattenTo()
+        item_type const *unflattenFrom( item_type const *p )
+        {
+            p = unflatten_from( m_a, p );
+            p = unflatten_from( m_z1, p );
+            p = unflatten_from( m_z2, p );
+            return p;
+        }
+
         friend std::ostream &operator<<( std::ostream &o,
                                          State const &v )
         {
@@ -184,6 +396,7 @@ struct Oscillator
     {
         m_coeffs = other.m_coeffs;
         m_state = other.m_state;
+        return *this;
     }
 
     T operator()( T input_value )
@@ -197,6 +410,75 @@ struct Oscillator
         return output_value * m_coeffs.m_amplitude + input_value;
     }
 
+    enum
+    {
+        /// The number of frames generated between renormalizations
+        renormalize_frames = 4096,
+        /// The number of frames generated at a time by the adding
+        /// process()
+        chunk_frames = 64
+    };
+
+    /// Write frames samples of the oscillator times its amplitude to
+    /// out. A mono float or double oscillator fills a whole SIMD
+    /// register per step with oscillator_generate_scalar(). The
+    /// amplitude is renormalized every renormalize_frames frames and at
+    /// the end of the block.
+    void process( T *out, size_t frames )
+    {
+        for ( size_t pos = 0; pos < frames; pos += renormalize_frames )
+        {
+            size_t n = frames - pos < size_t( renormalize_frames )
+                           ? frames - pos
+                           : size_t( renormalize_frames );
+            oscillator_generate( m_state.m_a,
+                                 m_state.m_z1,
+                                 m_state.m_z2,
+                                 m_coeffs.m_amplitude,
+                                 out + pos,
+                                 n );
+            m_state.renormalize();
+        }
+    }
+
+    /// Add frames samples of the oscillator to in, writing to out, as
+    /// process( out, frames ) generates them. in and out may be the
+    /// same buffer.
+    void process( T const *in, T *out, size_t frames )
+    {
+        T buf[chunk_frames];
+        size_t since_renormalize = 0;
+        for ( size_t pos = 0; pos < frames; pos += chunk_frames )
+        {
+            size_t n = frames - pos < size_t( chunk_frames )
+                           ? frames - pos
+                           : size_t( chunk_frames );
+            oscillator_generate( m_state.m_a,
+                                 m_state.m_z1,
+                                 m_state.m_z2,
+                                 m_coeffs.m_amplitude,
+                                 buf,
+                                 n );
+            for ( size_t i = 0; i < n; ++i )
+            {
+                out[pos + i] = buf[i] + in[pos + i];
+            }
+            since_renormalize += n;
+            if ( since_renormalize >= size_t( renormalize_frames ) )
+            {
+                m_state.renormalize();
+                since_renormalize = 0;
+            }
+        }
+        m_state.renormalize();
+    }
+
+    /// Process frames samples of buf in place
+    void processInPlace( T *buf, size_t frames )
+    {
+        process( buf, buf, frames );
+    }
+
     friend std::ostream &operator<<( std::ostream &o,
                                      Oscillator const &v )
     {
@@ -0,0 +1,379 @@
+#pragma once
+/*
+ Copyright (c) 2013, J.D. Koftinoff Software, Ltd.
+ <jeffk@jdkoftinoff.com>
+ http://www.jdkoftinoff.com/
+ All rights reserved.
+
+ Permission to use, copy, modify, and/or distribute this software for
+ any
+ purpose with or without fee is hereby granted, provided that the above
+ copyright notice and this permission notice appear in all copies.
+
+ THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ WARRANTIES
+ WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "Obbligato/World.hpp"
+#include "Obbligato/SIMD.hpp"
+#include "Obbligato/IOStream.hpp"
+#include "Obbligato/Form.hpp"
+#include "Obbligato/DSP_Oscillator.hpp"
+
+#if __cplusplus >= 201103L
+
+namespace Obbligato
+{
+namespace DSP
+{
+
+using namespace SIMD;
+
+enum OscillatorWaveform
+{
+    oscillator_sine,
+    oscillator_saw,
+    oscillator_square,
+    oscillator_triangle
+};
+
+/// One cycle of a waveform at several levels of band limiting.
+///
+/// Level l holds the harmonics up to size / 4 >> l, so each level has
+/// half the bandwidth of the one before and the last is a pure sine.
+/// An oscillator reads the level with the most harmonics that all lie
+/// below half the sample rate at its frequency, so it does not alias.
+/// Each table has one extra point, a copy of the first, so that linear
+/// interpolation never has to wrap.
+class OscillatorWavetable
+{
+  public:
+    explicit OscillatorWavetable( OscillatorWaveform waveform,
+                                  size_t size = 2048 );
+
+    OscillatorWaveform waveform() const { return m_waveform; }
+
+    size_t size() const { return m_size; }
+
+    size_t levels() const { return m_levels; }
+
+    /// The highest harmonic held in level l
+    size_t harmonics( size_t l ) const { return ( m_size / 4 ) >> l; }
+
+    /// The level to read at a phase increment of increment cycles per
+    /// sample
+    size_t levelFor( double increment ) const;
+
+    /// The size() + 1 points of level l
+    float const *level( size_t l ) const
+    {
+        return &m_tables[l * ( m_size + 1 )];
+    }
+
+  private:
+    OscillatorWaveform m_waveform;
+    size_t m_size;
+    size_t m_levels;
+    std::vector<float> m_tables;
+};
+
+/// sin( 2 pi p ) for a phase p in cycles from 0 to 1, by a polynomial
+/// that works a whole SIMD_Vector at a time. The error is below 1e-7.
+template <typename T>
+T oscillator_sine_cycle( T const &p )
+{
+    typedef typename simd_flattened_type<T>::type item_type;
+    T quarter, half, s;
+    splat( quarter, 0.25 );
+    splat( half, 0.5 );
+
+    // sin( 2 pi p ) = cos( 2 pi x ) with x = p - 1/4 folded into
+    // -1/2 to 1/2, which is sin( 2 pi c ) with c from -1/4 to 1/4
+    T x = p - quarter;
+    x = x - greater_equal( x, half );
+    T c = quarter - abs( x );
+    T c2 = c * c;
+
+    splat( s, -15.094642576822984 );
+    s = s * c2 + item_type( 42.058693944897634 );
+    s = s * c2 + item_type( -76.70585975306136 );
+    s = s * c2 + item_type( 81.60524927607504 );
+    s = s * c2 + item_type( -41.341702240399755 );
+    s = s * c2 + item_type( 6.283185307179586 );
+    return s * c;
+}
+
+/// A bank of phase accumulator oscillators, for hundreds of voices or
+/// additive partials.
+///
+/// Each voice has a phase in cycles, an increment and an amplitude,
+/// held structure of arrays, and groups of Width voices are run one
+/// voice per lane of a SIMD_Vector<T,Width>. Without a wavetable the
+/// voices are sines from oscillator_sine_cycle(), computed entirely in
+/// registers. With one, every lane reads the band limited level that
+/// suits its own frequency and interpolates linearly between two
+/// points. Frequencies may be changed per voice at any time without a
+/// discontinuity, unlike the recursive Oscillator whose state has to
+/// be reset. Frequencies must lie from 0 to half the sample rate.
+template <typename T = float, size_t Width = simd_native_size<T>::value>
+class OscillatorBank
+{
+  public:
+    typedef T value_type;
+    typedef SIMD_Vector<T, Width> vector_type;
+
+    enum
+    {
+        width = Width,
+        /// The number of frames generated in registers at a time
+        chunk_frames = 64
+    };
+
+    /// A bank of voices sines, or voices readers of table, which must
+    /// outlive the bank
+    explicit OscillatorBank( size_t voices,
+                             OscillatorWavetable const *table = 0 )
+        : m_voices( voices )
+        , m_groups( ( voices + Width - 1 ) / Width )
+        , m_table( table )
+        , m_phase( m_groups * Width, T( 0 ) )
+        , m_increment( m_groups * Width, T( 0 ) )
+        , m_amplitude( m_groups * Width, T( 0 ) )
+        , m_level( m_groups * Width, 0 )
+    {
+    }
+
+    size_t voices() const { return m_voices; }
+
+    OscillatorWavetable const *table() const { return m_table; }
+
+    /// Set the frequency of a voice, keeping its phase
+    void setFrequency( size_t voice,
+                       double sample_rate_recip,
+                       double frequency )
+    {
+        double increment = frequency * sample_rate_recip;
+        m_increment.at( voice ) = T( increment );
+        if ( m_table )
+        {
+            m_level[voice] = m_table->levelFor( increment );
+        }
+    }
+
+    /// Set the frequency of a voice from a note and octave, as
+    /// Oscillator::State::setFrequencyNote() does
+    void setFrequencyNote( size_t voice,
+                           double sample_rate_recip,
+                           int octave,
+                           int note,
+                           double tuning_in_cents = 0.0,
+                           double tuning_of_a = 440.0 )
+    {
+        double tuning_multiplier
+            = pow( 2.0, tuning_in_cents * ( 1.0 / 1200.0 ) );
+        double octave_multiplier
+            = oscillator_octave_multiplier_table[octave];
+        double a_tuning_multipler = tuning_of_a * ( 1.0 / 440.0 );
+        double freq = oscillator_note_frequencies_a440[note]
+                      * tuning_multiplier * octave_multiplier
+                      * a_tuning_multipler;
+        setFrequency( voice, sample_rate_recip, freq );
+    }
+
+    /// Set the phase of a voice in radians
+    void setPhase( size_t voice, double phase_in_radians )
+    {
+        double cycles = phase_in_radians / OBBLIGATO_TWO_PI;
+        m_phase.at( voice ) = T( cycles - std::floor( cycles ) );
+    }
+
+    void setAmplitude( size_t voice, T amplitude )
+    {
+        m_amplitude.at( voice ) = amplitude;
+    }
+
+    T getAmplitude( size_t voice ) const
+    {
+        return m_amplitude.at( voice );
+    }
+
+    /// The phase increment of a voice in cycles per sample
+    T getIncrement( size_t voice ) const
+    {
+        return m_increment.at( voice );
+    }
+
+    /// Write frames samples of each voice to out[voice]
+    void process( T *const *out, size_t frames )
+    {
+        for ( size_t g = 0; g < m_groups; ++g )
+        {
+            for ( size_t pos = 0; pos < frames; pos += chunk_frames )
+            {
+                size_t n = frames - pos < size_t( chunk_frames )
+                               ? frames - pos
+                               : size_t( chunk_frames );
+                vector_type buf[chunk_frames];
+                generate( g, buf, n );
+                storeChunk( g, buf, out, pos, n );
+            }
+        }
+    }
+
+    /// Add frames samples of the sum of all voices to out
+    void processMix( T *out, size_t frames )
+    {
+        for ( size_t pos = 0; pos < frames; pos += chunk_frames )
+        {
+            size_t n = frames - pos < size_t( chunk_frames )
+                           ? frames - pos
+                           : size_t( chunk_frames );
+            vector_type sum[chunk_frames];
+            vector_type buf[chunk_frames];
+            for ( size_t i = 0; i < n; ++i )
+            {
+                zero( sum[i] );
+            }
+            for ( size_t g = 0; g < m_groups; ++g )
+            {
+                generate( g, buf, n );
+                for ( size_t i = 0; i < n; ++i )
+                {
+                    sum[i] += buf[i];
+                }
+            }
+            for ( size_t i = 0; i < n; ++i )
+            {
+                T v = out[pos + i];
+                for ( size_t lane = 0; lane < Width; ++lane )
+                {
+                    v += sum[i][lane];
+                }
+                out[pos + i] = v;
+            }
+        }
+    }
+
+    friend std::ostream &operator<<( std::ostream &o,
+                                     OscillatorBank const &v )
+    {
+        using namespace IOStream;
+        for ( size_t i = 0; i < v.m_voices; ++i )
+        {
+            o << label_fmt( form<128>( "voice %d", int( i ) ) ) << "{ "
+              << "phase=" << v.m_phase[i]
+              << " increment=" << v.m_increment[i]
+              << " amplitude=" << v.m_amplitude[i] << " }"
+              << std::endl;
+        }
+        return o;
+    }
+
+  private:
+    /// Generate frames samples of the voices of group g, one voice per
+    /// lane, advancing their phases. Unused lanes have no amplitude.
+    void generate( size_t g, vector_type *buf, size_t frames )
+    {
+        vector_type p, increment, amplitude, unity;
+        loadu( p, &m_phase[g * Width] );
+        loadu( increment, &m_increment[g * Width] );
+        loadu( amplitude, &m_amplitude[g * Width] );
+        one( unity );
+
+        if ( !m_table )
+        {
+            for ( size_t i = 0; i < frames; ++i )
+            {
+                buf[i] = oscillator_sine_cycle( p ) * amplitude;
+                p += increment;
+                p -= greater_equal( p, unity );
+            }
+        }
+        else
+        {
+            float const *tables[Width];
+            for ( size_t lane = 0; lane < Width; ++lane )
+            {
+                size_t l = m_level[g * Width + lane];
+                tables[lane] = m_table->level( l );
+            }
+            T const size = T( m_table->size() );
+
+            for ( size_t i = 0; i < frames; ++i )
+            {
+                T a[Width], b[Width], f[Width];
+                vector_type position = p * size;
+                for ( size_t lane = 0; lane < Width; ++lane )
+                {
+                    T x = position[lane];
+                    size_t index = size_t( x );
+                    a[lane] = tables[lane][index];
+                    b[lane] = tables[lane][index + 1];
+                    f[lane] = x - T( index );
+                }
+                vector_type va, vb, vf;
+                loadu( va, a );
+                loadu( vb, b );
+                loadu( vf, f );
+                buf[i] = ( va + ( vb - va ) * vf ) * amplitude;
+                p += increment;
+                p -= greater_equal( p, unity );
+            }
+        }
+
+        storeu( p, &m_phase[g * Width] );
+    }
+
+    /// Transpose frames vectors of group g back to the planar outputs
+    void storeChunk( size_t g,
+                     vector_type const *buf,
+                     T *const *out,
+                     size_t pos,
+                     size_t frames )
+    {
+        size_t const first = g * Width;
+        size_t const lanes
+            = m_voices - first < Width ? m_voices - first : Width;
+        size_t const full_frames
+            = lanes == Width ? frames - frames % Width : 0;
+
+        for ( size_t i = 0; i < full_frames; i += Width )
+        {
+            SIMD_Vector<vector_type, Width> m;
+            for ( size_t j = 0; j < Width; ++j )
+            {
+                m[j] = buf[i + j];
+            }
+            transpose( m );
+            for ( size_t lane = 0; lane < Width; ++lane )
+            {
+                storeu( m[lane], out[first + lane] + pos + i );
+            }
+        }
+        for ( size_t i = full_frames; i < frames; ++i )
+        {
+            for ( size_t lane = 0; lane < lanes; ++lane )
+            {
+                out[first + lane][pos + i] = buf[i][lane];
+            }
+        }
+    }
+
+    size_t m_voices;
+    size_t m_groups;
+    OscillatorWavetable const *m_table;
+    std::vector<T> m_phase;
+    std::vector<T> m_increment;
+    std::vector<T> m_amplitude;
+    std::vector<size_t> m_level;
+};
+}
+}
+
+#endif
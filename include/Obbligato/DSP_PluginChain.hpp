@@ -24,6 +24,8 @@
 #include "Obbligato/SIMD.hpp"
 #include "Obbligato/IOStream.hpp"
 #include "Obbligato/Form.hpp"
+#include "Obbligato/DSP_DenormalGuard.hpp"
+#include "Obbligato/DSP_Response.hpp"
 
 #if __cplusplus >= 201103L
 
@@ -54,22 +56,40 @@ struct PluginChain
 
     size_t size() const { return plugin_count; }
 
+    /// The response of the whole chain is the product of the responses
+    /// of its plugins
     template <typename ComplexType>
     ComplexType processZDomain( size_t channel, ComplexType z1 )
     {
-        ComplexType result = z1;
+        ComplexType result( 1.0, 0.0 );
 
         for ( size_t i = 0; i < plugin_count; ++i )
         {
-            result
-                = m_item[i].m_coeffs.processZDomain( channel, result );
+            result *= m_item[i].m_coeffs.processZDomain( channel, z1 );
         }
         return result;
     }
 
+    /// Multiply the response of every plugin at every point of grid
+    /// into the split complex arrays re and im
+    template <typename G>
+    void responseZDomain( size_t channel,
+                          FrequencyGrid<G> const &grid,
+                          G *re,
+                          G *im ) const
+    {
+        for ( size_t i = 0; i < plugin_count; ++i )
+        {
+            m_item[i].m_coeffs.responseZDomain( channel, grid, re, im );
+        }
+    }
+
+    /// Process a block of samples of another type with denormals
+    /// flushed to zero, converting each lane through every plugin
     template <typename U, size_t M>
     SIMD_Vector<U, M> operator()( SIMD_Vector<U, M> const &input_value )
     {
+        DenormalGuard guard;
         SIMD_Vector<U, M> r = input_value;
         for ( size_t i = 0; i < plugin_count; ++i )
         {
@@ -81,6 +101,39 @@ struct PluginChain
         return r;
     }
 
+    /// Process a block of samples with denormals flushed to zero
+    template <size_t M>
+    SIMD_Vector<T, M> operator()( SIMD_Vector<T, M> const &input_value )
+    {
+        SIMD_Vector<T, M> r;
+        process( input_value.data(), r.data(), M );
+        return r;
+    }
+
+    /// Process frames samples from in to out with denormals flushed to
+    /// zero. in and out may be the same buffer.
+    ///
+    /// Each sample goes through every plugin before the next one
+    /// starts. A plugin-major order, running each plugin over a
+    /// cache-sized sub-block in turn, was tried and measured about
+    /// twice as slow: every biquad is a serial recursion, so running
+    /// one at a time exposes its full latency, while sample order
+    /// lets the recursions of successive plugins overlap.
+    void process( T const *in, T *out, size_t frames )
+    {
+        DenormalGuard guard;
+        for ( size_t i = 0; i < frames; ++i )
+        {
+            out[i] = ( *this )( in[i] );
+        }
+    }
+
+    /// Process frames samples of buf in place
+    void processInPlace( T *buf, size_t frames )
+    {
+        process( buf, buf, frames );
+    }
+
     T operator()( T input_value )
     {
         T r = input_value;
@@ -0,0 +1,359 @@
+#pragma once
+/*
+ Copyright (c) 2013, J.D. Koftinoff Software, Ltd.
+ <jeffk@jdkoftinoff.com>
+ http://www.jdkoftinoff.com/
+ All rights reserved.
+
+ Permission to use, copy, modify, and/or distribute this software for
+ any
+ purpose with or without fee is hereby granted, provided that the above
+ copyright notice and this permission notice appear in all copies.
+
+ THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ WARRANTIES
+ WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "Obbligato/World.hpp"
+#include "Obbligato/SIMD.hpp"
+#include "Obbligato/IOStream.hpp"
+#include "Obbligato/DSP_DenormalGuard.hpp"
+#include "Obbligato/DSP_Fir.hpp"
+
+#if __cplusplus >= 201103L
+
+namespace Obbligato
+{
+namespace DSP
+{
+
+using namespace SIMD;
+
+/// Presets trading the quality of a Resampler against its cost
+enum ResamplerQuality
+{
+    /// 16 taps, about 60 dB of stop band rejection
+    resampler_fast,
+    /// 32 taps, about 90 dB
+    resampler_medium,
+    /// 64 taps, about 120 dB
+    resampler_best
+};
+
+/// The zeroth order modified Bessel function of the first kind, for
+/// Kaiser windows
+inline double resampler_bessel_i0( double x )
+{
+    double sum = 1.0, term = 1.0;
+    double const q = x * x / 4.0;
+    for ( int k = 1; k < 50 && term > sum * 1e-17; ++k )
+    {
+        term *= q / ( double( k ) * double( k ) );
+        sum += term;
+    }
+    return sum;
+}
+
+/// A polyphase sample rate converter with a streaming push and pull
+/// interface, for any block sizes on either side.
+///
+/// Each output is the inner product of the newest inputs with one
+/// phase of a Kaiser windowed sinc low pass, cut off below the lower of
+/// the two nyquist frequencies and normalized to unity gain at DC. The
+/// phases are computed once, each padded to a whole number of SIMD
+/// registers and stored reversed so that the product is one fir_dot()
+/// of contiguous memory.
+///
+/// A ratio of two whole sample rates, such as 44100 to 48000, reduces
+/// to out / in = L / M, and when L is small enough the table holds
+/// exactly L phases and each output uses one of them. Any other ratio
+/// uses a table of finely spaced phases and interpolates linearly
+/// between the two on either side of each output, at the cost of a
+/// second inner product.
+///
+/// push() appends input and pull() takes as many outputs as that input
+/// allows. The buffer grows to the largest amount of input pushed but
+/// not yet used, and is reused after that, so a steady stream of
+/// blocks does not allocate.
+template <typename T = float>
+class Resampler
+{
+  public:
+    typedef T value_type;
+
+    enum
+    {
+        width = simd_native_size<T>::value,
+        /// The most phases a rational ratio may need to use them
+        /// exactly
+        max_rational_phases = 1024
+    };
+
+    /// Convert from in_rate to out_rate, exactly when the reduced
+    /// ratio allows it
+    Resampler( size_t in_rate,
+               size_t out_rate,
+               ResamplerQuality quality = resampler_medium )
+    {
+        if ( in_rate == 0 || out_rate == 0 )
+        {
+            throw std::invalid_argument(
+                "Resampler sample rates must not be 0" );
+        }
+        size_t a = in_rate, b = out_rate;
+        while ( b != 0 )
+        {
+            size_t r = a % b;
+            a = b;
+            b = r;
+        }
+        size_t const up = out_rate / a, down = in_rate / a;
+        if ( up <= size_t( max_rational_phases ) )
+        {
+            design( double( up ) / double( down ), quality, up, down );
+        }
+        else
+        {
+            design( double( out_rate ) / double( in_rate ),
+                    quality,
+                    0,
+                    0 );
+        }
+    }
+
+    /// Convert by any ratio of output rate to input rate
+    explicit Resampler( double ratio,
+                        ResamplerQuality quality = resampler_medium )
+    {
+        if ( !( ratio > 0.0 ) )
+        {
+            throw std::invalid_argument(
+                "Resampler ratio must be positive" );
+        }
+        design( ratio, quality, 0, 0 );
+    }
+
+    /// The output rate divided by the input rate
+    double ratio() const { return m_ratio; }
+
+    /// True when each output uses one exact phase
+    bool isRational() const { return m_up != 0; }
+
+    /// The number of filter taps applied to the input per output
+    size_t taps() const { return m_taps; }
+
+    /// The delay of the filter, in input samples
+    double latency() const { return double( m_taps / 2 - 1 ); }
+
+    /// Clear the history and the input waiting to be used
+    void reset()
+    {
+        m_buffer.assign( m_padded - 1, T( 0 ) );
+        m_read = 0;
+        m_frac = 0;
+        m_time = 0.0;
+    }
+
+    /// Append frames samples of in to the input
+    void push( T const *in, size_t frames )
+    {
+        // drop the input that no output can need again. When
+        // decimating, the next output may start beyond the input.
+        if ( m_read > 0 && m_read >= m_buffer.size() / 2 )
+        {
+            size_t const drop = std::min( m_read, m_buffer.size() );
+            m_buffer.erase( m_buffer.begin(),
+                            m_buffer.begin() + drop );
+            m_read -= drop;
+        }
+        m_buffer.insert( m_buffer.end(), in, in + frames );
+    }
+
+    /// The number of outputs that the input pushed so far allows
+    size_t available() const
+    {
+        size_t read = m_read, frac = m_frac, count = 0;
+        double time = m_time;
+        while ( read + m_padded <= m_buffer.size() )
+        {
+            ++count;
+            advance( read, frac, time );
+        }
+        return count;
+    }
+
+    /// Write up to frames outputs to out with denormals flushed to
+    /// zero, returning the number written
+    size_t pull( T *out, size_t frames )
+    {
+        DenormalGuard guard;
+        size_t written = 0;
+        while ( written < frames
+                && m_read + m_padded <= m_buffer.size() )
+        {
+            T const *history = &m_buffer[m_read];
+            if ( m_up != 0 )
+            {
+                out[written] = fir_dot(
+                    &m_table[m_frac * m_padded], history, m_padded );
+            }
+            else
+            {
+                double const position = m_time * double( m_phases );
+                size_t const p = size_t( position );
+                T const mu = T( position - double( p ) );
+                T const *c = &m_table[p * m_padded];
+                T const y0 = fir_dot( c, history, m_padded );
+                T const y1 = fir_dot( c + m_padded, history, m_padded );
+                out[written] = y0 + ( y1 - y0 ) * mu;
+            }
+            ++written;
+            advance( m_read, m_frac, m_time );
+        }
+        return written;
+    }
+
+    /// Push in_frames samples of in and pull up to out_frames outputs
+    /// to out, returning the number written
+    size_t process( T const *in,
+                    size_t in_frames,
+                    T *out,
+                    size_t out_frames )
+    {
+        push( in, in_frames );
+        return pull( out, out_frames );
+    }
+
+    friend std::ostream &operator<<( std::ostream &o,
+                                     Resampler const &v )
+    {
+        o << "{ ratio=" << v.m_ratio << " taps=" << v.m_taps
+          << " phases=" << v.m_phases << " }";
+        return o;
+    }
+
+  private:
+    /// Make the phase table for ratio, with up phases stepping down
+    /// inputs per output when up is not 0
+    void design( double ratio,
+                 ResamplerQuality quality,
+                 size_t up,
+                 size_t down )
+    {
+        size_t base_taps = 32, fine_phases = 256;
+        double beta = 8.6, cutoff = 0.9;
+        if ( quality == resampler_fast )
+        {
+            base_taps = 16;
+            fine_phases = 128;
+            beta = 6.0;
+            cutoff = 0.85;
+        }
+        else if ( quality == resampler_best )
+        {
+            base_taps = 64;
+            fine_phases = 1024;
+            beta = 12.0;
+            cutoff = 0.95;
+        }
+
+        // when decimating the cut off falls with the output nyquist,
+        // and the filter is lengthened to keep the transition as sharp
+        double const scale = ratio < 1.0 ? ratio : 1.0;
+        m_ratio = ratio;
+        m_up = up;
+        m_down = down;
+        m_step = 1.0 / ratio;
+        m_taps = size_t( std::ceil( double( base_taps ) / scale / 2 ) )
+                 * 2;
+        m_padded = ( m_taps + width - 1 ) / width * width;
+        m_phases = up != 0 ? up : fine_phases;
+
+        // the fine table has one extra phase to interpolate towards
+        size_t const rows = up != 0 ? up : fine_phases + 1;
+        double const fc = cutoff * scale;
+        double const half = double( m_taps ) / 2.0;
+        double const norm = resampler_bessel_i0( beta );
+        m_table.assign( rows * m_padded, T( 0 ) );
+        std::vector<double> row( m_taps );
+        for ( size_t p = 0; p < rows; ++p )
+        {
+            double const f = double( p ) / double( m_phases );
+            double sum = 0.0;
+            for ( size_t m = 0; m < m_taps; ++m )
+            {
+                // the distance from the output to input m
+                double const t = half - double( m ) + f;
+                double const x = t / half;
+                double w = 0.0;
+                if ( x > -1.0 && x < 1.0 )
+                {
+                    w = resampler_bessel_i0(
+                            beta * std::sqrt( 1.0 - x * x ) ) / norm;
+                }
+                double s = 1.0;
+                if ( t != 0.0 )
+                {
+                    s = std::sin( OBBLIGATO_PI * fc * t )
+                        / ( OBBLIGATO_PI * fc * t );
+                }
+                row[m] = w * s;
+                sum += row[m];
+            }
+            for ( size_t m = 0; m < m_taps; ++m )
+            {
+                m_table[p * m_padded + m_padded - m_taps + m]
+                    = T( row[m] / sum );
+            }
+        }
+        reset();
+    }
+
+    /// Move read, frac and time on by one output
+    void advance( size_t &read, size_t &frac, double &time ) const
+    {
+        if ( m_up != 0 )
+        {
+            frac += m_down;
+            read += frac / m_up;
+            frac %= m_up;
+        }
+        else
+        {
+            time += m_step;
+            double const whole = std::floor( time );
+            read += size_t( whole );
+            time -= whole;
+        }
+    }
+
+    double m_ratio;
+    double m_step;
+    size_t m_up;
+    size_t m_down;
+    size_t m_taps;
+    size_t m_padded;
+    size_t m_phases;
+    std::vector<T> m_table;
+
+    /// The input, starting with m_padded - 1 samples of history
+    std::vector<T> m_buffer;
+
+    /// Where the inputs of the next output start in m_buffer
+    size_t m_read;
+
+    /// The position of the next output past m_read, in 1 / m_up input
+    /// samples when rational, otherwise in input samples
+    size_t m_frac;
+    double m_time;
+};
+}
+}
+
+#endif
@@ -0,0 +1,304 @@
+#pragma once
+/*
+ Copyright (c) 2013, J.D. Koftinoff Software, Ltd.
+ <jeffk@jdkoftinoff.com>
+ http://www.jdkoftinoff.com/
+ All rights reserved.
+
+ Permission to use, copy, modify, and/or distribute this software for
+ any
+ purpose with or without fee is hereby granted, provided that the above
+ copyright notice and this permission notice appear in all copies.
+
+ THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ WARRANTIES
+ WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "Obbligato/World.hpp"
+#include "Obbligato/SIMD.hpp"
+#include "Obbligato/Constants.hpp"
+
+#if __cplusplus >= 201103L
+
+#include <thread>
+
+namespace Obbligato
+{
+namespace DSP
+{
+
+using namespace SIMD;
+
+/// The points at which FrequencyResponse evaluates a chain, held as
+/// split complex arrays of z^-1 and z^-2, padded with repeats of the
+/// last point to a whole number of native SIMD registers.
+///
+/// The real parts are held as 1 - Re z^-n, computed as 2 sin^2 so that
+/// they keep their precision at low frequencies, where Re z^-n is close
+/// to 1 and a biquad's numerator and denominator nearly cancel.
+template <typename T = float>
+class FrequencyGrid
+{
+  public:
+    typedef T value_type;
+
+    enum
+    {
+        width = simd_native_size<T>::value
+    };
+
+    /// count frequencies in Hz at sample_rate
+    FrequencyGrid( double sample_rate,
+                   double const *freqs,
+                   size_t count )
+        : m_sample_rate( sample_rate )
+        , m_frequencies( freqs, freqs + count )
+    {
+        if ( count == 0 )
+        {
+            throw std::invalid_argument(
+                "FrequencyGrid needs at least one frequency" );
+        }
+        m_padded = ( count + width - 1 ) / width * width;
+        m_z1_re.resize( m_padded );
+        m_z1_im.resize( m_padded );
+        m_z2_re.resize( m_padded );
+        m_z2_im.resize( m_padded );
+        for ( size_t i = 0; i < m_padded; ++i )
+        {
+            double w = OBBLIGATO_TWO_PI
+                       * freqs[i < count ? i : count - 1] / sample_rate;
+            double const h1 = std::sin( w / 2 ), h2 = std::sin( w );
+            m_z1_re[i] = T( 2 * h1 * h1 );
+            m_z1_im[i] = T( -std::sin( w ) );
+            m_z2_re[i] = T( 2 * h2 * h2 );
+            m_z2_im[i] = T( -std::sin( 2 * w ) );
+        }
+    }
+
+    /// count frequencies spaced logarithmically from low to high Hz, as
+    /// an equalizer display draws them
+    static FrequencyGrid logarithmic( double sample_rate,
+                                      double low,
+                                      double high,
+                                      size_t count )
+    {
+        std::vector<double> freqs( count );
+        for ( size_t i = 0; i < count; ++i )
+        {
+            double x
+                = count > 1 ? double( i ) / double( count - 1 ) : 0.0;
+            freqs[i] = low * std::pow( high / low, x );
+        }
+        return FrequencyGrid( sample_rate, freqs.data(), count );
+    }
+
+    double sampleRate() const { return m_sample_rate; }
+
+    /// The number of frequencies
+    size_t size() const { return m_frequencies.size(); }
+
+    /// The length of the padded arrays
+    size_t padded() const { return m_padded; }
+
+    double frequency( size_t i ) const { return m_frequencies[i]; }
+
+    /// 1 - Re z^-1 at each point
+    T const *z1Versine() const { return &m_z1_re[0]; }
+
+    /// Im z^-1 at each point
+    T const *z1Imag() const { return &m_z1_im[0]; }
+
+    /// 1 - Re z^-2 at each point
+    T const *z2Versine() const { return &m_z2_re[0]; }
+
+    /// Im z^-2 at each point
+    T const *z2Imag() const { return &m_z2_im[0]; }
+
+  private:
+    double m_sample_rate;
+    std::vector<double> m_frequencies;
+    size_t m_padded;
+    std::vector<T> m_z1_re;
+    std::vector<T> m_z1_im;
+    std::vector<T> m_z2_re;
+    std::vector<T> m_z2_im;
+};
+
+/// Multiply the split complex response re, im at every point of grid by
+/// that of the biquad ( a0 + a1 z^-1 + a2 z^-2 ) / ( 1 + b1 z^-1 + b2
+/// z^-2 ), a register of points at a time
+template <typename T>
+inline void response_multiply_biquad( FrequencyGrid<T> const &grid,
+                                      double a0,
+                                      double a1,
+                                      double a2,
+                                      double b1,
+                                      double b2,
+                                      T *re,
+                                      T *im )
+{
+    typedef SIMD_Vector<T, simd_native_size<T>::value> vector_type;
+    size_t const w = simd_native_size<T>::value;
+    T const ta1 = T( a1 ), ta2 = T( a2 ), tb1 = T( b1 ), tb2 = T( b2 );
+
+    // the real parts are the responses at DC less the versine terms
+    vector_type dc_n, dc_d, unit;
+    splat( dc_n, T( a0 + a1 + a2 ) );
+    splat( dc_d, T( 1.0 + b1 + b2 ) );
+    one( unit );
+    for ( size_t i = 0; i < grid.padded(); i += w )
+    {
+        vector_type v1, s1, v2, s2, hr, hi;
+        loadu( v1, grid.z1Versine() + i );
+        loadu( s1, grid.z1Imag() + i );
+        loadu( v2, grid.z2Versine() + i );
+        loadu( s2, grid.z2Imag() + i );
+        loadu( hr, re + i );
+        loadu( hi, im + i );
+
+        vector_type nr = dc_n - v1 * ta1 - v2 * ta2;
+        vector_type ni = s1 * ta1 + s2 * ta2;
+        vector_type dr = dc_d - v1 * tb1 - v2 * tb2;
+        vector_type di = s1 * tb1 + s2 * tb2;
+
+        // n / d = n conj( d ) / |d|^2
+        vector_type scale = unit / ( dr * dr + di * di );
+        vector_type qr = ( nr * dr + ni * di ) * scale;
+        vector_type qi = ( ni * dr - nr * di ) * scale;
+
+        storeu( hr * qr - hi * qi, re + i );
+        storeu( hr * qi + hi * qr, im + i );
+    }
+}
+
+/// Multiply the response at every point of grid by a flat gain
+template <typename T>
+inline void response_multiply_gain( FrequencyGrid<T> const &grid,
+                                    double gain,
+                                    T *re,
+                                    T *im )
+{
+    T const g = T( gain );
+    for ( size_t i = 0; i < grid.padded(); ++i )
+    {
+        re[i] *= g;
+        im[i] *= g;
+    }
+}
+
+/// Evaluates the magnitude and phase responses of whole chains over a
+/// FrequencyGrid.
+///
+/// Any plugin or chain with a responseZDomain( channel, grid, re, im )
+/// method can be evaluated: Biquad, Gain and Oscillator coefficients,
+/// PluginChain, StaticChain, BiquadBank and BiquadLookahead. Each stage
+/// multiplies its response into split complex arrays a SIMD register
+/// of points at a time, instead of calling processZDomain() once per
+/// point per stage with scalar complex math, and the magnitudes and
+/// phases are taken once at the end.
+///
+/// evaluateChannels() spreads the channels of a multi channel chain
+/// across threads. Responses are for drawing, so none of this is meant
+/// for the audio thread.
+template <typename T = float>
+class FrequencyResponse
+{
+  public:
+    typedef T value_type;
+
+    explicit FrequencyResponse( FrequencyGrid<T> const &grid )
+        : m_grid( grid )
+    {
+    }
+
+    FrequencyGrid<T> const &grid() const { return m_grid; }
+
+    /// Write the magnitude and the phase in radians of channel of chain
+    /// at each point of the grid. phase may be null.
+    template <typename ChainType>
+    void evaluate( ChainType const &chain,
+                   size_t channel,
+                   T *magnitude,
+                   T *phase ) const
+    {
+        std::vector<T> re( m_grid.padded(), T( 1 ) );
+        std::vector<T> im( m_grid.padded(), T( 0 ) );
+        chain.responseZDomain( channel, m_grid, &re[0], &im[0] );
+        for ( size_t i = 0; i < m_grid.size(); ++i )
+        {
+            magnitude[i] = std::sqrt( re[i] * re[i] + im[i] * im[i] );
+            if ( phase )
+            {
+                phase[i] = std::atan2( im[i], re[i] );
+            }
+        }
+    }
+
+    /// Evaluate channels channels of chain, channel c to magnitude[c]
+    /// and phase[c], on up to threads threads. phase may be null.
+    template <typename ChainType>
+    void evaluateChannels( ChainType const &chain,
+                           size_t channels,
+                           T *const *magnitude,
+                           T *const *phase,
+                           size_t threads = 1 ) const
+    {
+        if ( threads > channels )
+        {
+            threads = channels;
+        }
+        if ( threads <= 1 )
+        {
+            evaluateRange( chain, 0, channels, magnitude, phase );
+            return;
+        }
+
+        std::vector<std::thread> workers;
+        size_t const per = ( channels + threads - 1 ) / threads;
+        for ( size_t first = per; first < channels; first += per )
+        {
+            size_t last
+                = first + per < channels ? first + per : channels;
+            workers.push_back( std::thread(
+                &FrequencyResponse::evaluateRange<ChainType>,
+                this,
+                std::cref( chain ),
+                first,
+                last,
+                magnitude,
+                phase ) );
+        }
+        evaluateRange( chain, 0, per, magnitude, phase );
+        for ( size_t i = 0; i < workers.size(); ++i )
+        {
+            workers[i].join();
+        }
+    }
+
+  private:
+    template <typename ChainType>
+    void evaluateRange( ChainType const &chain,
+                        size_t first,
+                        size_t last,
+                        T *const *magnitude,
+                        T *const *phase ) const
+    {
+        for ( size_t c = first; c < last; ++c )
+        {
+            evaluate( chain, c, magnitude[c], phase ? phase[c] : 0 );
+        }
+    }
+
+    FrequencyGrid<T> m_grid;
+};
+}
+}
+
+#endif
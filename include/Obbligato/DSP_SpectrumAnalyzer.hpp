@@ -0,0 +1,251 @@
+#pragma once
+/*
+ Copyright (c) 2013, J.D. Koftinoff Software, Ltd.
+ <jeffk@jdkoftinoff.com>
+ http://www.jdkoftinoff.com/
+ All rights reserved.
+
+ Permission to use, copy, modify, and/or distribute this software for
+ any
+ purpose with or without fee is hereby granted, provided that the above
+ copyright notice and this permission notice appear in all copies.
+
+ THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ WARRANTIES
+ WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "Obbligato/World.hpp"
+#include "Obbligato/SIMD.hpp"
+#include "Obbligato/Atomic.hpp"
+#include "Obbligato/IOStream.hpp"
+#include "Obbligato/DSP_FFT.hpp"
+
+#if __cplusplus >= 201103L
+
+namespace Obbligato
+{
+namespace DSP
+{
+
+using namespace SIMD;
+
+enum SpectrumWindow
+{
+    spectrum_rectangular,
+    /// Sidelobes 31 dB down, falling 18 dB per octave
+    spectrum_hann,
+    /// Four term Blackman-Harris, sidelobes 92 dB down
+    spectrum_blackman_harris
+};
+
+/// Write the n points of a periodic window to out, for transforms of
+/// size n
+template <typename T>
+void spectrum_window( SpectrumWindow window, size_t n, T *out )
+{
+    for ( size_t i = 0; i < n; ++i )
+    {
+        double x = OBBLIGATO_TWO_PI * double( i ) / double( n );
+        double w = 1.0;
+        if ( window == spectrum_hann )
+        {
+            w = 0.5 - 0.5 * std::cos( x );
+        }
+        else if ( window == spectrum_blackman_harris )
+        {
+            w = 0.35875 - 0.48829 * std::cos( x )
+                + 0.14128 * std::cos( 2.0 * x )
+                - 0.01168 * std::cos( 3.0 * x );
+        }
+        out[i] = T( w );
+    }
+}
+
+/// Magnitude spectra of a stream, for display by other threads.
+///
+/// The audio thread passes its input to process(), which keeps the
+/// last fftSize() samples and every hop() samples windows them,
+/// transforms them with a RealFFTPlan and publishes the magnitudes
+/// through an Atomic::TripleBuffer. The cost is one transform per hop
+/// whatever the block size, and process() never locks, waits or
+/// allocates. One reader thread, typically a user interface, calls
+/// update() and reads front() for the newest spectrum.
+///
+/// Magnitudes are scaled for the window so that a sine of amplitude A
+/// centred on a bin reads A.
+template <typename T = float>
+class SpectrumAnalyzer
+{
+  public:
+    typedef T value_type;
+
+    struct Spectrum
+    {
+        /// The number of the analysis, counting from 1, or 0 before
+        /// the first
+        uint64_t m_index;
+
+        /// The number of input samples processed at the end of the
+        /// analysed window
+        uint64_t m_frame;
+
+        /// The magnitude of each of the bins() bins
+        std::vector<T> m_magnitude;
+
+        Spectrum( size_t bins = 0 )
+            : m_index( 0 ), m_frame( 0 ), m_magnitude( bins, T( 0 ) )
+        {
+        }
+    };
+
+    /// Analyse every hop samples the last fft_size samples, a power of
+    /// 2 from 4 to 65536, through window. hop must be from 1 to
+    /// fft_size; fft_size / 4 gives 75% overlap.
+    SpectrumAnalyzer( size_t fft_size,
+                      size_t hop,
+                      SpectrumWindow window = spectrum_hann )
+        : m_plan( RealFFTPlan<T>::get( fft_size ) )
+        , m_size( fft_size )
+        , m_hop( hop )
+        , m_window( fft_size )
+        , m_history( fft_size * 2, T( 0 ) )
+        , m_scratch( fft_size )
+        , m_re( fft_size / 2 + 1 )
+        , m_im( fft_size / 2 + 1 )
+        , m_position( 0 )
+        , m_countdown( hop )
+        , m_index( 0 )
+        , m_frame( 0 )
+        , m_spectrum( Spectrum( fft_size / 2 + 1 ) )
+    {
+        if ( hop == 0 || hop > fft_size )
+        {
+            throw std::invalid_argument(
+                "SpectrumAnalyzer hop must be from 1 to the fft size" );
+        }
+        spectrum_window( window, fft_size, &m_window[0] );
+        double sum = 0.0;
+        for ( size_t i = 0; i < fft_size; ++i )
+        {
+            sum += m_window[i];
+        }
+        for ( size_t i = 0; i < fft_size; ++i )
+        {
+            m_window[i] = T( m_window[i] * 2.0 / sum );
+        }
+    }
+
+    size_t fftSize() const { return m_size; }
+
+    size_t hop() const { return m_hop; }
+
+    /// The number of bins, fftSize() / 2 + 1
+    size_t bins() const { return m_size / 2 + 1; }
+
+    /// The centre frequency of bin at sample_rate
+    double binFrequency( size_t bin, double sample_rate ) const
+    {
+        return double( bin ) * sample_rate / double( m_size );
+    }
+
+    /// Forget the input so far. Called from the audio thread.
+    void reset()
+    {
+        std::fill( m_history.begin(), m_history.end(), T( 0 ) );
+        m_position = 0;
+        m_countdown = m_hop;
+    }
+
+    /// Add frames samples of in to the stream, analysing and publishing
+    /// at every hop. Called from the audio thread.
+    void process( T const *in, size_t frames )
+    {
+        while ( frames > 0 )
+        {
+            size_t n = m_countdown < frames ? m_countdown : frames;
+            for ( size_t i = 0; i < n; ++i )
+            {
+                m_history[m_position] = in[i];
+                m_history[m_position + m_size] = in[i];
+                m_position = m_position + 1 == m_size ? 0
+                                                      : m_position + 1;
+            }
+            in += n;
+            frames -= n;
+            m_frame += n;
+            m_countdown -= n;
+            if ( m_countdown == 0 )
+            {
+                analyse();
+                m_countdown = m_hop;
+            }
+        }
+    }
+
+    /// Move the newest published spectrum to front(). Returns false
+    /// when there is none since the last update. Called from the
+    /// reader thread.
+    bool update() { return m_spectrum.update(); }
+
+    /// The reader thread's spectrum
+    Spectrum const &front() const { return m_spectrum.front(); }
+
+    friend std::ostream &operator<<( std::ostream &o,
+                                     SpectrumAnalyzer const &v )
+    {
+        o << "{ size=" << v.m_size << " hop=" << v.m_hop
+          << " analyses=" << v.m_index << " }";
+        return o;
+    }
+
+  private:
+    /// Window the last fftSize() samples, oldest first, transform
+    /// them and publish their magnitudes
+    void analyse()
+    {
+        T const *history = &m_history[m_position];
+        for ( size_t i = 0; i < m_size; ++i )
+        {
+            m_scratch[i] = history[i] * m_window[i];
+        }
+        m_plan->forward( &m_scratch[0], &m_re[0], &m_im[0] );
+
+        Spectrum &s = m_spectrum.back();
+        size_t const bins = m_size / 2 + 1;
+        for ( size_t k = 0; k < bins; ++k )
+        {
+            s.m_magnitude[k]
+                = std::sqrt( m_re[k] * m_re[k] + m_im[k] * m_im[k] );
+        }
+        // dc and nyquist have no negative frequency twin
+        s.m_magnitude[0] *= T( 0.5 );
+        s.m_magnitude[bins - 1] *= T( 0.5 );
+        s.m_index = ++m_index;
+        s.m_frame = m_frame;
+        m_spectrum.publish();
+    }
+
+    shared_ptr<RealFFTPlan<T> const> m_plan;
+    size_t m_size;
+    size_t m_hop;
+    std::vector<T> m_window;
+    std::vector<T> m_history;
+    std::vector<T> m_scratch;
+    std::vector<T> m_re;
+    std::vector<T> m_im;
+    size_t m_position;
+    size_t m_countdown;
+    uint64_t m_index;
+    uint64_t m_frame;
+    Atomic::TripleBuffer<Spectrum> m_spectrum;
+};
+}
+}
+
+#endif
@@ -0,0 +1,223 @@
+#pragma once
+/*
+ Copyright (c) 2013, J.D. Koftinoff Software, Ltd.
+ <jeffk@jdkoftinoff.com>
+ http://www.jdkoftinoff.com/
+ All rights reserved.
+
+ Permission to use, copy, modify, and/or distribute this software for
+ any
+ purpose with or without fee is hereby granted, provided that the above
+ copyright notice and this permission notice appear in all copies.
+
+ THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ WARRANTIES
+ WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "Obbligato/World.hpp"
+#include "Obbligato/SIMD.hpp"
+#include "Obbligato/IOStream.hpp"
+#include "Obbligato/Form.hpp"
+#include "Obbligato/DSP_DenormalGuard.hpp"
+#include "Obbligato/DSP_Response.hpp"
+
+#if __cplusplus >= 201103L
+
+namespace Obbligato
+{
+namespace DSP
+{
+
+using namespace SIMD;
+
+/// Stage I of a StaticChain with N stages. Each function handles
+/// plugin I and recurses to stage I + 1, so that a whole chain inlines
+/// into straight line code.
+template <size_t I, size_t N>
+struct StaticChainStage
+{
+    template <typename TupleT, typename T>
+    static T process( TupleT &items, T value )
+    {
+        return StaticChainStage<I + 1, N>::process(
+            items, std::get<I>( items )( value ) );
+    }
+
+    template <typename TupleT, typename ComplexType>
+    static ComplexType processZDomain( TupleT &items,
+                                       size_t channel,
+                                       ComplexType z1,
+                                       ComplexType result )
+    {
+        return StaticChainStage<I + 1, N>::processZDomain(
+            items,
+            channel,
+            z1,
+            result * std::get<I>( items ).m_coeffs.processZDomain(
+                         channel, z1 ) );
+    }
+
+    template <typename TupleT, typename G>
+    static void responseZDomain( TupleT const &items,
+                                 size_t channel,
+                                 FrequencyGrid<G> const &grid,
+                                 G *re,
+                                 G *im )
+    {
+        std::get<I>( items ).m_coeffs.responseZDomain(
+            channel, grid, re, im );
+        StaticChainStage<I + 1, N>::responseZDomain(
+            items, channel, grid, re, im );
+    }
+
+    template <typename TupleT>
+    static void print( std::ostream &o, TupleT const &items )
+    {
+        using namespace IOStream;
+        o << title_fmt( form<128>( "item[%d]", int( I ) ) )
+          << std::endl;
+        o << std::get<I>( items ) << std::endl;
+        StaticChainStage<I + 1, N>::print( o, items );
+    }
+};
+
+template <size_t N>
+struct StaticChainStage<N, N>
+{
+    template <typename TupleT, typename T>
+    static T process( TupleT &, T value )
+    {
+        return value;
+    }
+
+    template <typename TupleT, typename ComplexType>
+    static ComplexType processZDomain( TupleT &,
+                                       size_t,
+                                       ComplexType,
+                                       ComplexType result )
+    {
+        return result;
+    }
+
+    template <typename TupleT, typename G>
+    static void responseZDomain(
+        TupleT const &, size_t, FrequencyGrid<G> const &, G *, G * )
+    {
+    }
+
+    template <typename TupleT>
+    static void print( std::ostream &, TupleT const & )
+    {
+    }
+};
+
+/// A chain of different plugin types, such as a Gain followed by some
+/// Biquads and an Oscillator, held in a std::tuple. All plugins must
+/// process the same value_type.
+///
+/// process() runs every stage on each sample in one fused loop, on a
+/// local copy of the plugins that the compiler can keep in registers.
+template <typename... Plugins>
+struct StaticChain
+{
+    typedef std::tuple<Plugins...> tuple_type;
+    typedef typename std::tuple_element<0, tuple_type>::type first_type;
+    typedef typename first_type::value_type value_type;
+    typedef value_type T;
+
+    enum
+    {
+        plugin_count = sizeof...( Plugins )
+    };
+
+    tuple_type m_items;
+
+    /// Get plugin I
+    template <size_t I>
+    typename std::tuple_element<I, tuple_type>::type &get()
+    {
+        return std::get<I>( m_items );
+    }
+
+    /// Get plugin I (const)
+    template <size_t I>
+    typename std::tuple_element<I, tuple_type>::type const &get() const
+    {
+        return std::get<I>( m_items );
+    }
+
+    size_t size() const { return plugin_count; }
+
+    /// The response of the whole chain is the product of the responses
+    /// of its plugins
+    template <typename ComplexType>
+    ComplexType processZDomain( size_t channel, ComplexType z1 )
+    {
+        return StaticChainStage<0, plugin_count>::processZDomain(
+            m_items, channel, z1, ComplexType( 1.0, 0.0 ) );
+    }
+
+    /// Multiply the response of every plugin at every point of grid
+    /// into the split complex arrays re and im
+    template <typename G>
+    void responseZDomain( size_t channel,
+                          FrequencyGrid<G> const &grid,
+                          G *re,
+                          G *im ) const
+    {
+        StaticChainStage<0, plugin_count>::responseZDomain(
+            m_items, channel, grid, re, im );
+    }
+
+    T operator()( T input_value )
+    {
+        return StaticChainStage<0, plugin_count>::process(
+            m_items, input_value );
+    }
+
+    /// Process a block of samples with denormals flushed to zero
+    template <typename U, size_t M>
+    SIMD_Vector<U, M> operator()( SIMD_Vector<U, M> const &input_value )
+    {
+        SIMD_Vector<U, M> r;
+        process( input_value.data(), r.data(), M );
+        return r;
+    }
+
+    /// Process frames samples from in to out with denormals flushed to
+    /// zero. in and out may be the same buffer.
+    void process( T const *in, T *out, size_t frames )
+    {
+        DenormalGuard guard;
+        tuple_type items( m_items );
+        for ( size_t i = 0; i < frames; ++i )
+        {
+            out[i] = StaticChainStage<0, plugin_count>::process(
+                items, in[i] );
+        }
+        m_items = items;
+    }
+
+    /// Process frames samples of buf in place
+    void processInPlace( T *buf, size_t frames )
+    {
+        process( buf, buf, frames );
+    }
+
+    friend std::ostream &operator<<( std::ostream &o,
+                                     StaticChain const &v )
+    {
+        StaticChainStage<0, plugin_count>::print( o, v.m_items );
+        return o;
+    }
+};
+}
+}
+
+#endif
@@ -47,4 +47,8 @@ namespace SIMD
 #include "Obbligato/SIMD_VectorAVX32x8.hpp"
 #include "Obbligato/SIMD_VectorAVX64x4.hpp"
 #endif
+
+#include "Obbligato/SIMD_VectorComplex.hpp"
+#include "Obbligato/SIMD_Transpose.hpp"
+#include "Obbligato/SIMD_Span.hpp"
 #endif
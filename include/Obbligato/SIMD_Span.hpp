@@ -0,0 +1,207 @@
+#pragma once
+/*
+ Copyright (c) 2013, J.D. Koftinoff Software, Ltd.
+ <jeffk@jdkoftinoff.com>
+ http://www.jdkoftinoff.com/
+ All rights reserved.
+
+ Permission to use, copy, modify, and/or distribute this software for
+ any
+ purpose with or without fee is hereby granted, provided that the above
+ copyright notice and this permission notice appear in all copies.
+
+ THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ WARRANTIES
+ WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "Obbligato/World.hpp"
+#include "Obbligato/SIMD_Vector.hpp"
+
+#if defined( __ARM_NEON__ )
+#include "Obbligato/SIMD_VectorNEON32x4.hpp"
+#endif
+
+#if defined( __SSE2__ )
+#include "Obbligato/SIMD_VectorSSE32x4.hpp"
+#include "Obbligato/SIMD_VectorSSE64x2.hpp"
+#endif
+
+#if defined( __AVX__ )
+#include "Obbligato/SIMD_VectorAVX32x8.hpp"
+#include "Obbligato/SIMD_VectorAVX64x4.hpp"
+#endif
+
+namespace Obbligato
+{
+namespace SIMD
+{
+
+/** \addtogroup simd_span span
+ *
+ * Kernels over ordinary arrays of float or double. simd_for_each()
+ * walks a buffer with a partial head until the output is aligned to
+ * the vector size, an aligned body, and a masked tail, so that a
+ * vectorized kernel only has to be written for one SIMD_Vector.
+ */
+/**@{*/
+
+/// A non owning view of size contiguous items
+template <typename T>
+class SIMD_Span
+{
+  public:
+    typedef T value_type;
+    typedef T *pointer;
+    typedef T *iterator;
+
+    SIMD_Span() : m_data( 0 ), m_size( 0 ) {}
+
+    SIMD_Span( pointer data, size_t size )
+        : m_data( data ), m_size( size )
+    {
+    }
+
+    /// A span of non-const items converts to a span of const items
+    template <typename U>
+    SIMD_Span( SIMD_Span<U> const &other )
+        : m_data( other.data() ), m_size( other.size() )
+    {
+    }
+
+    pointer data() const { return m_data; }
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    iterator begin() const { return m_data; }
+    iterator end() const { return m_data + m_size; }
+    T &operator[]( size_t i ) const { return m_data[i]; }
+
+  private:
+    pointer m_data;
+    size_t m_size;
+};
+
+template <typename T>
+inline SIMD_Span<T> make_span( T *data, size_t size )
+{
+    return SIMD_Span<T>( data, size );
+}
+
+template <typename T>
+inline SIMD_Span<T const> make_span( std::vector<T> const &v )
+{
+    return SIMD_Span<T const>( v.data(), v.size() );
+}
+
+template <typename T>
+inline SIMD_Span<T> make_span( std::vector<T> &v )
+{
+    return SIMD_Span<T>( v.data(), v.size() );
+}
+
+/// Order preceding non-temporal stores before any following stores
+inline void stream_fence()
+{
+#if defined( __SSE__ )
+    _mm_sfence();
+#endif
+}
+
+/// True when p is aligned to the size of SimdT
+template <typename SimdT, typename T>
+inline bool is_simd_aligned( T const *p )
+{
+    return ( reinterpret_cast<uintptr_t>( p ) % sizeof( SimdT ) ) == 0;
+}
+
+/// out[i] = f(in[i]) for every vector of SimdT in the span. in and out
+/// must have the same size and may be the same buffer.
+template <typename SimdT, typename T, typename FuncT>
+inline void simd_for_each( SIMD_Span<T const> in,
+                           SIMD_Span<T> out,
+                           FuncT f )
+{
+    size_t const width = SimdT::vector_size;
+    size_t const count
+        = in.size() < out.size() ? in.size() : out.size();
+    T const *src = in.data();
+    T *dest = out.data();
+    size_t pos = 0;
+    SimdT v;
+
+    // items before the output reaches a vector boundary. An output
+    // that is not aligned to T never reaches one, so store unaligned
+    uintptr_t const misalign
+        = reinterpret_cast<uintptr_t>( dest ) % sizeof( SimdT );
+    bool const alignable = ( misalign % sizeof( T ) ) == 0;
+    size_t head = 0;
+    if ( alignable && misalign != 0 )
+    {
+        head = ( sizeof( SimdT ) - misalign ) / sizeof( T );
+        if ( head > count )
+        {
+            head = count;
+        }
+        load_partial( v, src, head );
+        store_partial( SimdT( f( v ) ), dest, head );
+        pos = head;
+    }
+
+    if ( !alignable )
+    {
+        for ( ; pos + width <= count; pos += width )
+        {
+            loadu( v, src + pos );
+            storeu( SimdT( f( v ) ), dest + pos );
+        }
+    }
+    else if ( is_simd_aligned<SimdT>( src + pos ) )
+    {
+        for ( ; pos + width <= count; pos += width )
+        {
+            load( v, src + pos );
+            store( SimdT( f( v ) ), dest + pos );
+        }
+    }
+    else
+    {
+        for ( ; pos + width <= count; pos += width )
+        {
+            loadu( v, src + pos );
+            store( SimdT( f( v ) ), dest + pos );
+        }
+    }
+
+    if ( pos < count )
+    {
+        load_partial( v, src + pos, count - pos );
+        store_partial( SimdT( f( v ) ), dest + pos, count - pos );
+    }
+}
+
+/// out[i] = f(in[i]) using the widest native SIMD_Vector for T
+template <typename T, typename FuncT>
+inline void simd_for_each( SIMD_Span<T const> in,
+                           SIMD_Span<T> out,
+                           FuncT f )
+{
+    simd_for_each<SIMD_Vector<T, simd_native_size<T>::value> >(
+        in, out, f );
+}
+
+/// io[i] = f(io[i]) in place using the widest native SIMD_Vector for T
+template <typename T, typename FuncT>
+inline void simd_for_each( SIMD_Span<T> io, FuncT f )
+{
+    simd_for_each<SIMD_Vector<T, simd_native_size<T>::value> >(
+        SIMD_Span<T const>( io ), io, f );
+}
+
+/**@}*/
+}
+}
@@ -0,0 +1,362 @@
+#pragma once
+/*
+ Copyright (c) 2013, J.D. Koftinoff Software, Ltd.
+ <jeffk@jdkoftinoff.com>
+ http://www.jdkoftinoff.com/
+ All rights reserved.
+
+ Permission to use, copy, modify, and/or distribute this software for
+ any
+ purpose with or without fee is hereby granted, provided that the above
+ copyright notice and this permission notice appear in all copies.
+
+ THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ WARRANTIES
+ WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "Obbligato/World.hpp"
+#include "Obbligato/SIMD_Vector.hpp"
+
+#if defined( __ARM_NEON__ )
+#include "Obbligato/SIMD_VectorNEON32x4.hpp"
+#endif
+
+#if defined( __SSE2__ )
+#include "Obbligato/SIMD_VectorSSE32x4.hpp"
+#include "Obbligato/SIMD_VectorSSE64x2.hpp"
+#endif
+
+#if defined( __AVX__ )
+#include "Obbligato/SIMD_VectorAVX32x8.hpp"
+#include "Obbligato/SIMD_VectorAVX64x4.hpp"
+#endif
+
+namespace Obbligato
+{
+namespace SIMD
+{
+
+/** \addtogroup simd_transpose transpose
+ *
+ * Register level transposes of square blocks, and the interleave /
+ * deinterleave kernels for multichannel audio that are built on them.
+ *
+ * An interleaved buffer holds frames one after the other, each frame
+ * holding one item per channel. A planar buffer holds one contiguous
+ * array per channel.
+ */
+/**@{*/
+
+/// Transpose an N x N matrix held as N rows of SIMD_Vector<T,N>
+template <typename T, size_t N>
+inline void transpose( SIMD_Vector<SIMD_Vector<T, N>, N> &m )
+{
+    for ( size_t i = 0; i < N; ++i )
+    {
+        for ( size_t j = i + 1; j < N; ++j )
+        {
+            std::swap( m[i][j], m[j][i] );
+        }
+    }
+}
+
+#if defined( __SSE__ )
+/// Transpose 4 x 4 floats in SSE registers
+inline void transpose( SIMD_Vector<SIMD_Vector<float, 4>, 4> &m )
+{
+    _MM_TRANSPOSE4_PS(
+        m[0].m_vec, m[1].m_vec, m[2].m_vec, m[3].m_vec );
+}
+#endif
+
+#if defined( __ARM_NEON__ )
+/// Transpose 4 x 4 floats in NEON registers
+inline void transpose( SIMD_Vector<SIMD_Vector<float, 4>, 4> &m )
+{
+    float32x4x2_t t01 = vtrnq_f32( m[0].m_vec, m[1].m_vec );
+    float32x4x2_t t23 = vtrnq_f32( m[2].m_vec, m[3].m_vec );
+    m[0].m_vec = vcombine_f32( vget_low_f32( t01.val[0] ),
+                               vget_low_f32( t23.val[0] ) );
+    m[1].m_vec = vcombine_f32( vget_low_f32( t01.val[1] ),
+                               vget_low_f32( t23.val[1] ) );
+    m[2].m_vec = vcombine_f32( vget_high_f32( t01.val[0] ),
+                               vget_high_f32( t23.val[0] ) );
+    m[3].m_vec = vcombine_f32( vget_high_f32( t01.val[1] ),
+                               vget_high_f32( t23.val[1] ) );
+}
+#endif
+
+#if defined( __SSE2__ )
+/// Transpose 2 x 2 doubles in SSE2 registers
+inline void transpose( SIMD_Vector<SIMD_Vector<double, 2>, 2> &m )
+{
+    __m128d t0 = _mm_unpacklo_pd( m[0].m_vec, m[1].m_vec );
+    __m128d t1 = _mm_unpackhi_pd( m[0].m_vec, m[1].m_vec );
+    m[0].m_vec = t0;
+    m[1].m_vec = t1;
+}
+#endif
+
+#if defined( __AVX__ )
+/// Transpose 8 x 8 floats in AVX registers
+inline void transpose( SIMD_Vector<SIMD_Vector<float, 8>, 8> &m )
+{
+    __m256 t0 = _mm256_unpacklo_ps( m[0].m_vec, m[1].m_vec );
+    __m256 t1 = _mm256_unpackhi_ps( m[0].m_vec, m[1].m_vec );
+    __m256 t2 = _mm256_unpacklo_ps( m[2].m_vec, m[3].m_vec );
+    __m256 t3 = _mm256_unpackhi_ps( m[2].m_vec, m[3].m_vec );
+    __m256 t4 = _mm256_unpacklo_ps( m[4].m_vec, m[5].m_vec );
+    __m256 t5 = _mm256_unpackhi_ps( m[4].m_vec, m[5].m_vec );
+    __m256 t6 = _mm256_unpacklo_ps( m[6].m_vec, m[7].m_vec );
+    __m256 t7 = _mm256_unpackhi_ps( m[6].m_vec, m[7].m_vec );
+
+    int const lo = _MM_SHUFFLE( 1, 0, 1, 0 );
+    int const hi = _MM_SHUFFLE( 3, 2, 3, 2 );
+    __m256 s0 = _mm256_shuffle_ps( t0, t2, lo );
+    __m256 s1 = _mm256_shuffle_ps( t0, t2, hi );
+    __m256 s2 = _mm256_shuffle_ps( t1, t3, lo );
+    __m256 s3 = _mm256_shuffle_ps( t1, t3, hi );
+    __m256 s4 = _mm256_shuffle_ps( t4, t6, lo );
+    __m256 s5 = _mm256_shuffle_ps( t4, t6, hi );
+    __m256 s6 = _mm256_shuffle_ps( t5, t7, lo );
+    __m256 s7 = _mm256_shuffle_ps( t5, t7, hi );
+
+    m[0].m_vec = _mm256_permute2f128_ps( s0, s4, 0x20 );
+    m[1].m_vec = _mm256_permute2f128_ps( s1, s5, 0x20 );
+    m[2].m_vec = _mm256_permute2f128_ps( s2, s6, 0x20 );
+    m[3].m_vec = _mm256_permute2f128_ps( s3, s7, 0x20 );
+    m[4].m_vec = _mm256_permute2f128_ps( s0, s4, 0x31 );
+    m[5].m_vec = _mm256_permute2f128_ps( s1, s5, 0x31 );
+    m[6].m_vec = _mm256_permute2f128_ps( s2, s6, 0x31 );
+    m[7].m_vec = _mm256_permute2f128_ps( s3, s7, 0x31 );
+}
+
+/// Transpose 4 x 4 doubles in AVX registers
+inline void transpose( SIMD_Vector<SIMD_Vector<double, 4>, 4> &m )
+{
+    __m256d t0 = _mm256_unpacklo_pd( m[0].m_vec, m[1].m_vec );
+    __m256d t1 = _mm256_unpackhi_pd( m[0].m_vec, m[1].m_vec );
+    __m256d t2 = _mm256_unpacklo_pd( m[2].m_vec, m[3].m_vec );
+    __m256d t3 = _mm256_unpackhi_pd( m[2].m_vec, m[3].m_vec );
+
+    m[0].m_vec = _mm256_permute2f128_pd( t0, t2, 0x20 );
+    m[1].m_vec = _mm256_permute2f128_pd( t1, t3, 0x20 );
+    m[2].m_vec = _mm256_permute2f128_pd( t0, t2, 0x31 );
+    m[3].m_vec = _mm256_permute2f128_pd( t1, t3, 0x31 );
+}
+#endif
+
+/// Deinterleave the channels [first_channel, first_channel+N*k) in
+/// blocks of N x N items, returning the first channel not handled
+template <typename T, size_t N>
+inline size_t deinterleave_blocks( T const *interleaved,
+                                   size_t channels,
+                                   size_t frames,
+                                   T *const *planar,
+                                   size_t first_channel )
+{
+    SIMD_Vector<SIMD_Vector<T, N>, N> m;
+    size_t c = first_channel;
+    size_t const whole_frames = frames - ( frames % N );
+
+    for ( ; c + N <= channels; c += N )
+    {
+        for ( size_t f = 0; f < whole_frames; f += N )
+        {
+            T const *src = interleaved + f * channels + c;
+            for ( size_t r = 0; r < N; ++r )
+            {
+                memcpy( m[r].data(),
+                        src + r * channels,
+                        sizeof( T ) * N );
+            }
+            transpose( m );
+            for ( size_t r = 0; r < N; ++r )
+            {
+                memcpy( planar[c + r] + f,
+                        m[r].data(),
+                        sizeof( T ) * N );
+            }
+        }
+        for ( size_t f = whole_frames; f < frames; ++f )
+        {
+            for ( size_t r = 0; r < N; ++r )
+            {
+                planar[c + r][f] = interleaved[f * channels + c + r];
+            }
+        }
+    }
+    return c;
+}
+
+/// Interleave the channels [first_channel, first_channel+N*k) in
+/// blocks of N x N items, returning the first channel not handled
+template <typename T, size_t N>
+inline size_t interleave_blocks( T const *const *planar,
+                                 size_t channels,
+                                 size_t frames,
+                                 T *interleaved,
+                                 size_t first_channel )
+{
+    SIMD_Vector<SIMD_Vector<T, N>, N> m;
+    size_t c = first_channel;
+    size_t const whole_frames = frames - ( frames % N );
+
+    for ( ; c + N <= channels; c += N )
+    {
+        for ( size_t f = 0; f < whole_frames; f += N )
+        {
+            for ( size_t r = 0; r < N; ++r )
+            {
+                memcpy( m[r].data(),
+                        planar[c + r] + f,
+                        sizeof( T ) * N );
+            }
+            transpose( m );
+            T *dest = interleaved + f * channels + c;
+            for ( size_t r = 0; r < N; ++r )
+            {
+                memcpy( dest + r * channels,
+                        m[r].data(),
+                        sizeof( T ) * N );
+            }
+        }
+        for ( size_t f = whole_frames; f < frames; ++f )
+        {
+            for ( size_t r = 0; r < N; ++r )
+            {
+                interleaved[f * channels + c + r] = planar[c + r][f];
+            }
+        }
+    }
+    return c;
+}
+
+/// Split an interleaved buffer of frames x channels items into one
+/// planar buffer per channel
+template <typename T>
+inline void deinterleave( T const *interleaved,
+                          size_t channels,
+                          size_t frames,
+                          T *const *planar )
+{
+    size_t const native = simd_native_size<T>::value;
+    size_t c = 0;
+
+    // use the widest register transpose first, then the 4 wide one for
+    // what is left when the native width is 8
+    c = deinterleave_blocks<T, native>(
+        interleaved, channels, frames, planar, c );
+    if ( native > 4 )
+    {
+        c = deinterleave_blocks<T, 4>(
+            interleaved, channels, frames, planar, c );
+    }
+
+    for ( ; c < channels; ++c )
+    {
+        T *dest = planar[c];
+        T const *src = interleaved + c;
+        for ( size_t f = 0; f < frames; ++f )
+        {
+            dest[f] = src[f * channels];
+        }
+    }
+}
+
+/// Merge one planar buffer per channel into an interleaved buffer of
+/// frames x channels items
+template <typename T>
+inline void interleave( T const *const *planar,
+                        size_t channels,
+                        size_t frames,
+                        T *interleaved )
+{
+    size_t const native = simd_native_size<T>::value;
+    size_t c = 0;
+
+    c = interleave_blocks<T, native>(
+        planar, channels, frames, interleaved, c );
+    if ( native > 4 )
+    {
+        c = interleave_blocks<T, 4>(
+            planar, channels, frames, interleaved, c );
+    }
+
+    for ( ; c < channels; ++c )
+    {
+        T *dest = interleaved + c;
+        T const *src = planar[c];
+        for ( size_t f = 0; f < frames; ++f )
+        {
+            dest[f * channels] = src[f];
+        }
+    }
+}
+
+/// Convert a frame major chunk such as SIMD_Vector<vec4float,16> into a
+/// channel major chunk such as SIMD_Vector<vec16float,4>
+template <typename T, size_t Channels, size_t Frames>
+inline void deinterleave(
+    SIMD_Vector<SIMD_Vector<T, Channels>, Frames> const &frame_major,
+    SIMD_Vector<SIMD_Vector<T, Frames>, Channels> &channel_major )
+{
+    if ( sizeof( SIMD_Vector<T, Channels> ) == sizeof( T ) * Channels )
+    {
+        T *planar[Channels];
+        for ( size_t c = 0; c < Channels; ++c )
+        {
+            planar[c] = channel_major[c].data();
+        }
+        deinterleave(
+            frame_major[0].data(), Channels, Frames, planar );
+    }
+    else
+    {
+        for ( size_t f = 0; f < Frames; ++f )
+        {
+            for ( size_t c = 0; c < Channels; ++c )
+            {
+                channel_major[c][f] = frame_major[f][c];
+            }
+        }
+    }
+}
+
+/// Convert a channel major chunk such as SIMD_Vector<vec16float,4> into
+/// a frame major chunk such as SIMD_Vector<vec4float,16>
+template <typename T, size_t Channels, size_t Frames>
+inline void interleave(
+    SIMD_Vector<SIMD_Vector<T, Frames>, Channels> const &channel_major,
+    SIMD_Vector<SIMD_Vector<T, Channels>, Frames> &frame_major )
+{
+    if ( sizeof( SIMD_Vector<T, Channels> ) == sizeof( T ) * Channels )
+    {
+        T const *planar[Channels];
+        for ( size_t c = 0; c < Channels; ++c )
+        {
+            planar[c] = channel_major[c].data();
+        }
+        interleave( planar, Channels, Frames, frame_major[0].data() );
+    }
+    else
+    {
+        for ( size_t f = 0; f < Frames; ++f )
+        {
+            for ( size_t c = 0; c < Channels; ++c )
+            {
+                frame_major[f][c] = channel_major[c][f];
+            }
+        }
+    }
+}
+
+/**@}*/
+}
+}
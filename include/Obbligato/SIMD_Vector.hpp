@@ -218,12 +218,12 @@ inline std::complex<T> less( std::complex<T> const &a,
 
 inline float less_equal( float a, float b )
 {
-    return a < b ? 1.0f : 0.0f;
+    return a <= b ? 1.0f : 0.0f;
 }
 
 inline double less_equal( double a, double b )
 {
-    return a < b ? 1.0 : 0.0;
+    return a <= b ? 1.0 : 0.0;
 }
 
 template <typename T>
@@ -488,6 +488,59 @@ class OBBLIGATO_PLATFORM_VECTOR_ALIGN SIMD_Vector
         return splat( v, t );
     }
 
+    /// Load all items from p, which is aligned to the vector size
+    friend simd_type load( simd_type &v, const_pointer p )
+    {
+        for ( size_t i = 0; i < vector_size; ++i )
+        {
+            v.m_item[i] = p[i];
+        }
+        return v;
+    }
+
+    /// Load all items from p, which may be unaligned
+    friend simd_type loadu( simd_type &v, const_pointer p )
+    {
+        return load( v, p );
+    }
+
+    /// Load the first count items from p and zero the rest
+    friend simd_type
+        load_partial( simd_type &v, const_pointer p, size_t count )
+    {
+        zero( v );
+        for ( size_t i = 0; i < count && i < vector_size; ++i )
+        {
+            v.m_item[i] = p[i];
+        }
+        return v;
+    }
+
+    /// Store all items to p, which is aligned to the vector size
+    friend void store( simd_type const &v, pointer p )
+    {
+        for ( size_t i = 0; i < vector_size; ++i )
+        {
+            p[i] = v.m_item[i];
+        }
+    }
+
+    /// Store all items to p, which may be unaligned
+    friend void storeu( simd_type const &v, pointer p ) { store( v, p ); }
+
+    /// Store all items to aligned p without polluting the cache
+    friend void stream( simd_type const &v, pointer p ) { store( v, p ); }
+
+    /// Store the first count items to p
+    friend void
+        store_partial( simd_type const &v, pointer p, size_t count )
+    {
+        for ( size_t i = 0; i < count && i < vector_size; ++i )
+        {
+            p[i] = v.m_item[i];
+        }
+    }
+
     friend simd_type sqrt( simd_type const &a )
     {
         simd_type r;
@@ -1835,6 +1888,50 @@ struct
     typedef T type;
 };
 
+/// The number of items of type T that fit in one native register of
+/// the instruction set that is being compiled for
+template <typename T>
+struct simd_native_size : public std::integral_constant<size_t, 1>
+{
+};
+
+template <>
+struct simd_native_size<float>
+#if defined( __AVX__ )
+    : public std::integral_constant<size_t, 8>
+#else
+    : public std::integral_constant<size_t, 4>
+#endif
+{
+};
+
+template <>
+struct simd_native_size<double>
+#if defined( __AVX__ )
+    : public std::integral_constant<size_t, 4>
+#else
+    : public std::integral_constant<size_t, 2>
+#endif
+{
+};
+
+/// True when the flattened items of T are laid out contiguously in
+/// memory with no padding between them
+template <typename T>
+struct simd_is_packed
+    : public std::integral_constant<bool, !is_simd<T>::value>
+{
+};
+
+template <typename T, size_t N>
+struct simd_is_packed<SIMD_Vector<T, N> >
+    : public std::integral_constant<bool,
+                                    simd_is_packed<T>::value
+                                    && sizeof( SIMD_Vector<T, N> )
+                                       == sizeof( T ) * N>
+{
+};
+
 /**@}*/
 
 #if __cplusplus >= 201103L
@@ -2093,6 +2190,13 @@ SimdT &set_flattened_item(
     typename simd_flattened_type<SimdT>::type const &a,
     size_t i )
 {
+    typedef typename SimdT::value_type item_type;
+    if ( !simd_is_packed<SimdT>::value && is_simd<item_type>::value )
+    {
+        size_t const n = simd_flattened_size<item_type>::value;
+        set_flattened_item( v[i / n], a, i % n );
+        return v;
+    }
     typename simd_flattened_type<SimdT>::type *f
         = (typename simd_flattened_type<SimdT>::type *)v.data();
     f[i] = a;
@@ -2130,11 +2234,173 @@ template <typename SimdT>
 typename simd_flattened_type<SimdT>::type const &
     get_flattened_item( SimdT const &v, size_t i )
 {
+    typedef typename SimdT::value_type item_type;
+    if ( !simd_is_packed<SimdT>::value && is_simd<item_type>::value )
+    {
+        size_t const n = simd_flattened_size<item_type>::value;
+        return get_flattened_item( v[i / n], i % n );
+    }
     typename simd_flattened_type<SimdT>::type const *f
         = (typename simd_flattened_type<SimdT>::type const *)v.data();
     return f[i];
 }
 
+/**@}*/
+
+/** \addtogroup simd_flatten flatten_to / unflatten_from
+ *
+ * Bulk copies between a possibly nested vector and a plain array of
+ * its flattened items, in the same order as get_flattened_item. When
+ * the vector has no padding the copy is a single memcpy.
+ */
+
+/**@{*/
+
+inline float *flatten_to( float const &v, float *p )
+{
+    *p = v;
+    return p + 1;
+}
+
+inline double *flatten_to( double const &v, double *p )
+{
+    *p = v;
+    return p + 1;
+}
+
+template <typename T>
+std::complex<T> *flatten_to( std::complex<T> const &v,
+                             std::complex<T> *p )
+{
+    *p = v;
+    return p + 1;
+}
+
+/// Copy all flattened items of v to p, returning the pointer just past
+/// the last item written
+template <typename SimdT,
+          typename std::enable_if<is_simd<SimdT>::value, bool>::type
+              sfinae = true>
+typename simd_flattened_type<SimdT>::type *
+    flatten_to( SimdT const &v,
+                typename simd_flattened_type<SimdT>::type *p )
+{
+    if ( simd_is_packed<SimdT>::value )
+    {
+        size_t const n = simd_flattened_size<SimdT>::value;
+        memcpy( p, v.data(), sizeof( *p ) * n );
+        return p + n;
+    }
+    for ( size_t i = 0; i < v.size(); ++i )
+    {
+        p = flatten_to( v[i], p );
+    }
+    return p;
+}
+
+inline float const *unflatten_from( float &v, float const *p )
+{
+    v = *p;
+    return p + 1;
+}
+
+inline double const *unflatten_from( double &v, double const *p )
+{
+    v = *p;
+    return p + 1;
+}
+
+template <typename T>
+std::complex<T> const *unflatten_from( std::complex<T> &v,
+                                       std::complex<T> const *p )
+{
+    v = *p;
+    return p + 1;
+}
+
+/// Copy all flattened items of v from p, returning the pointer just
+/// past the last item read
+template <typename SimdT,
+          typename std::enable_if<is_simd<SimdT>::value, bool>::type
+              sfinae = true>
+typename simd_flattened_type<SimdT>::type const *
+    unflatten_from( SimdT &v,
+                    typename simd_flattened_type<SimdT>::type const *p )
+{
+    if ( simd_is_packed<SimdT>::value )
+    {
+        size_t const n = simd_flattened_size<SimdT>::value;
+        memcpy(
+            static_cast<void *>( v.data() ), p, sizeof( *p ) * n );
+        return p + n;
+    }
+    for ( size_t i = 0; i < v.size(); ++i )
+    {
+        p = unflatten_from( v[i], p );
+    }
+    return p;
+}
+
+/// Copy flattened item channel of every item of v to out, so that a
+/// frame major chunk such as SIMD_Vector<vec4float,16> gives the 16
+/// samples of one of its 4 channels
+template <typename SimdT>
+void extract_channel( SimdT const &v,
+                      size_t channel,
+                      typename simd_flattened_type<SimdT>::type *out )
+{
+    typedef typename SimdT::value_type item_type;
+    typedef typename simd_flattened_type<SimdT>::type flattened_type;
+    size_t const stride = simd_flattened_size<item_type>::value;
+
+    if ( simd_is_packed<SimdT>::value )
+    {
+        flattened_type const *p
+            = reinterpret_cast<flattened_type const *>( v.data() )
+              + channel;
+        for ( size_t i = 0; i < v.size(); ++i, p += stride )
+        {
+            out[i] = *p;
+        }
+    }
+    else
+    {
+        for ( size_t i = 0; i < v.size(); ++i )
+        {
+            out[i] = get_flattened_item( v[i], channel );
+        }
+    }
+}
+
+/// Set flattened item channel of every item of v from in
+template <typename SimdT>
+void insert_channel(
+    SimdT &v,
+    size_t channel,
+    typename simd_flattened_type<SimdT>::type const *in )
+{
+    typedef typename SimdT::value_type item_type;
+    typedef typename simd_flattened_type<SimdT>::type flattened_type;
+    size_t const stride = simd_flattened_size<item_type>::value;
+
+    if ( simd_is_packed<SimdT>::value )
+    {
+        flattened_type *p
+            = reinterpret_cast<flattened_type *>( v.data() ) + channel;
+        for ( size_t i = 0; i < v.size(); ++i, p += stride )
+        {
+            *p = in[i];
+        }
+    }
+    else
+    {
+        for ( size_t i = 0; i < v.size(); ++i )
+        {
+            set_flattened_item( v[i], in[i], channel );
+        }
+    }
+}
+
 /**@}*/
 }
 }
@@ -230,6 +230,66 @@ class OBBLIGATO_PLATFORM_VECTOR_ALIGN SIMD_Vector<float, 8>
         return splat( v, t );
     }
 
+    /// Load all items from p, which is aligned to the vector size
+    friend simd_type load( simd_type &v, const_pointer p )
+    {
+        v.m_vec = _mm256_load_ps( p );
+        return v;
+    }
+
+    /// Load all items from p, which may be unaligned
+    friend simd_type loadu( simd_type &v, const_pointer p )
+    {
+        v.m_vec = _mm256_loadu_ps( p );
+        return v;
+    }
+
+    /// Load the first count items from p and zero the rest
+    friend simd_type
+        load_partial( simd_type &v, const_pointer p, size_t count )
+    {
+        v.m_vec = _mm256_maskload_ps( p, partial_mask( count ) );
+        return v;
+    }
+
+    /// Store all items to p, which is aligned to the vector size
+    friend void store( simd_type const &v, pointer p )
+    {
+        _mm256_store_ps( p, v.m_vec );
+    }
+
+    /// Store all items to p, which may be unaligned
+    friend void storeu( simd_type const &v, pointer p )
+    {
+        _mm256_storeu_ps( p, v.m_vec );
+    }
+
+    /// Store all items to aligned p without polluting the cache
+    friend void stream( simd_type const &v, pointer p )
+    {
+        _mm256_stream_ps( p, v.m_vec );
+    }
+
+    /// Store the first count items to p
+    friend void
+        store_partial( simd_type const &v, pointer p, size_t count )
+    {
+        _mm256_maskstore_ps( p, partial_mask( count ), v.m_vec );
+    }
+
+    /// The lane mask selecting the first count items
+    static __m256i partial_mask( size_t count )
+    {
+        static const int32_t mask_table[16]
+            = {-1, -1, -1, -1, -1, -1, -1, -1, 0, 0, 0, 0, 0, 0, 0, 0};
+        if ( count > vector_size )
+        {
+            count = vector_size;
+        }
+        return _mm256_loadu_si256( reinterpret_cast<__m256i const *>(
+            &mask_table[vector_size - count] ) );
+    }
+
     friend simd_type sqrt( simd_type const &a )
     {
         simd_type r;
@@ -253,10 +313,7 @@ class OBBLIGATO_PLATFORM_VECTOR_ALIGN SIMD_Vector<float, 8>
     friend simd_type abs( simd_type const &a )
     {
         simd_type r;
-        for ( size_t i = 0; i < vector_size; ++i )
-        {
-            r[i] = abs( a[i] );
-        }
+        r.m_vec = _mm256_andnot_ps( _mm256_set1_ps( -0.0f ), a.m_vec );
         return r;
     }
 
@@ -322,167 +379,125 @@ class OBBLIGATO_PLATFORM_VECTOR_ALIGN SIMD_Vector<float, 8>
 
     friend simd_type operator+=( simd_type &a, value_type const &b )
     {
-        for ( size_t i = 0; i < vector_size; ++i )
-        {
-            a[i] += b;
-        }
+        internal_type t = _mm256_set1_ps( b );
+        a.m_vec = _mm256_add_ps( a.m_vec, t );
         return a;
     }
 
     friend simd_type operator-=( simd_type &a, value_type const &b )
     {
-        for ( size_t i = 0; i < vector_size; ++i )
-        {
-            a[i] -= b;
-        }
+        internal_type t = _mm256_set1_ps( b );
+        a.m_vec = _mm256_sub_ps( a.m_vec, t );
         return a;
     }
 
     friend simd_type operator*=( simd_type &a, value_type const &b )
     {
-        for ( size_t i = 0; i < vector_size; ++i )
-        {
-            a[i] *= b;
-        }
+        internal_type t = _mm256_set1_ps( b );
+        a.m_vec = _mm256_mul_ps( a.m_vec, t );
         return a;
     }
 
     friend simd_type operator/=( simd_type &a, value_type const &b )
     {
-        for ( size_t i = 0; i < vector_size; ++i )
-        {
-            a[i] /= b;
-        }
+        internal_type t = _mm256_set1_ps( b );
+        a.m_vec = _mm256_div_ps( a.m_vec, t );
         return a;
     }
 
     friend simd_type operator+( simd_type const &a,
                                 value_type const &b )
     {
+        internal_type t = _mm256_set1_ps( b );
         simd_type r;
-        for ( size_t i = 0; i < vector_size; ++i )
-        {
-            r[i] = a[i] + b;
-        }
+        r.m_vec = _mm256_add_ps( a.m_vec, t );
         return r;
     }
 
     friend simd_type operator-( simd_type const &a,
                                 value_type const &b )
     {
+        internal_type t = _mm256_set1_ps( b );
         simd_type r;
-        for ( size_t i = 0; i < vector_size; ++i )
-        {
-            r[i] = a[i] - b;
-        }
+        r.m_vec = _mm256_sub_ps( a.m_vec, t );
         return r;
     }
 
     friend simd_type operator*( simd_type const &a,
                                 value_type const &b )
     {
+        internal_type t = _mm256_set1_ps( b );
         simd_type r;
-        for ( size_t i = 0; i < vector_size; ++i )
-        {
-            r[i] = a[i] * b;
-        }
+        r.m_vec = _mm256_mul_ps( a.m_vec, t );
         return r;
     }
 
     friend simd_type operator/( simd_type const &a,
                                 value_type const &b )
     {
+        internal_type t = _mm256_set1_ps( b );
         simd_type r;
-        for ( size_t i = 0; i < vector_size; ++i )
-        {
-            r[i] = a[i] / b;
-        }
+        r.m_vec = _mm256_div_ps( a.m_vec, t );
         return r;
     }
 
     friend simd_type operator+=( simd_type &a, simd_type const &b )
     {
-        for ( size_t i = 0; i < vector_size; ++i )
-        {
-            a[i] += b[i];
-        }
+        a.m_vec = _mm256_add_ps( a.m_vec, b.m_vec );
         return a;
     }
 
     friend simd_type operator-=( simd_type &a, simd_type const &b )
     {
-        for ( size_t i = 0; i < vector_size; ++i )
-        {
-            a[i] -= b[i];
-        }
+        a.m_vec = _mm256_sub_ps( a.m_vec, b.m_vec );
         return a;
     }
 
     friend simd_type operator*=( simd_type &a, simd_type const &b )
     {
-        for ( size_t i = 0; i < vector_size; ++i )
-        {
-            a[i] *= b[i];
-        }
+        a.m_vec = _mm256_mul_ps( a.m_vec, b.m_vec );
         return a;
     }
 
     friend simd_type operator/=( simd_type &a, simd_type const &b )
     {
-        for ( size_t i = 0; i < vector_size; ++i )
-        {
-            a[i] /= b[i];
-        }
+        a.m_vec = _mm256_div_ps( a.m_vec, b.m_vec );
         return a;
     }
 
     friend simd_type operator+( simd_type const &a, simd_type const &b )
     {
         simd_type r;
-        for ( size_t i = 0; i < vector_size; ++i )
-        {
-            r[i] = a[i] + b[i];
-        }
+        r.m_vec = _mm256_add_ps( a.m_vec, b.m_vec );
         return r;
     }
 
     friend simd_type operator-( simd_type const &a, simd_type const &b )
     {
         simd_type r;
-        for ( size_t i = 0; i < vector_size; ++i )
-        {
-            r[i] = a[i] - b[i];
-        }
+        r.m_vec = _mm256_sub_ps( a.m_vec, b.m_vec );
         return r;
     }
 
     friend simd_type operator*( simd_type const &a, simd_type const &b )
     {
         simd_type r;
-        for ( size_t i = 0; i < vector_size; ++i )
-        {
-            r[i] = a[i] * b[i];
-        }
+        r.m_vec = _mm256_mul_ps( a.m_vec, b.m_vec );
         return r;
     }
 
     friend simd_type operator/( simd_type const &a, simd_type const &b )
     {
         simd_type r;
-        for ( size_t i = 0; i < vector_size; ++i )
-        {
-            r[i] = a[i] / b[i];
-        }
+        r.m_vec = _mm256_div_ps( a.m_vec, b.m_vec );
         return r;
     }
 
     friend simd_type equal_to( simd_type const &a, simd_type const &b )
     {
         simd_type r;
-        for ( size_t i = 0; i < vector_size; ++i )
-        {
-            r[i] = equal_to( a[i], b[i] );
-        }
+        internal_type x = _mm256_cmp_ps( a.m_vec, b.m_vec, _CMP_EQ_OQ );
+        r.m_vec = _mm256_and_ps( x, _mm256_set1_ps( 1.0f ) );
         return r;
     }
 
@@ -490,20 +505,17 @@ class OBBLIGATO_PLATFORM_VECTOR_ALIGN SIMD_Vector<float, 8>
                                    simd_type const &b )
     {
         simd_type r;
-        for ( size_t i = 0; i < vector_size; ++i )
-        {
-            r[i] = not_equal_to( a[i], b[i] );
-        }
+        internal_type x
+            = _mm256_cmp_ps( a.m_vec, b.m_vec, _CMP_NEQ_UQ );
+        r.m_vec = _mm256_and_ps( x, _mm256_set1_ps( 1.0f ) );
         return r;
     }
 
     friend simd_type less( simd_type const &a, simd_type const &b )
     {
         simd_type r;
-        for ( size_t i = 0; i < vector_size; ++i )
-        {
-            r[i] = less( a[i], b[i] );
-        }
+        internal_type x = _mm256_cmp_ps( a.m_vec, b.m_vec, _CMP_LT_OQ );
+        r.m_vec = _mm256_and_ps( x, _mm256_set1_ps( 1.0f ) );
         return r;
     }
 
@@ -511,20 +523,16 @@ class OBBLIGATO_PLATFORM_VECTOR_ALIGN SIMD_Vector<float, 8>
                                  simd_type const &b )
     {
         simd_type r;
-        for ( size_t i = 0; i < vector_size; ++i )
-        {
-            r[i] = less_equal( a[i], b[i] );
-        }
+        internal_type x = _mm256_cmp_ps( a.m_vec, b.m_vec, _CMP_LE_OQ );
+        r.m_vec = _mm256_and_ps( x, _mm256_set1_ps( 1.0f ) );
         return r;
     }
 
     friend simd_type greater( simd_type const &a, simd_type const &b )
     {
         simd_type r;
-        for ( size_t i = 0; i < vector_size; ++i )
-        {
-            r[i] = greater( a[i], b[i] );
-        }
+        internal_type x = _mm256_cmp_ps( a.m_vec, b.m_vec, _CMP_GT_OQ );
+        r.m_vec = _mm256_and_ps( x, _mm256_set1_ps( 1.0f ) );
         return r;
     }
 
@@ -532,10 +540,8 @@ class OBBLIGATO_PLATFORM_VECTOR_ALIGN SIMD_Vector<float, 8>
                                     simd_type const &b )
     {
         simd_type r;
-        for ( size_t i = 0; i < vector_size; ++i )
-        {
-            r[i] = greater_equal( a[i], b[i] );
-        }
+        internal_type x = _mm256_cmp_ps( a.m_vec, b.m_vec, _CMP_GE_OQ );
+        r.m_vec = _mm256_and_ps( x, _mm256_set1_ps( 1.0f ) );
         return r;
     }
 };
@@ -0,0 +1,620 @@
+#pragma once
+/*
+ Copyright (c) 2013, J.D. Koftinoff Software, Ltd.
+ <jeffk@jdkoftinoff.com>
+ http://www.jdkoftinoff.com/
+ All rights reserved.
+
+ Permission to use, copy, modify, and/or distribute this software for
+ any
+ purpose with or without fee is hereby granted, provided that the above
+ copyright notice and this permission notice appear in all copies.
+
+ THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ WARRANTIES
+ WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "Obbligato/World.hpp"
+#include "Obbligato/Constants.hpp"
+#include "Obbligato/SIMD_Vector.hpp"
+
+#if defined( __ARM_NEON__ )
+#include "Obbligato/SIMD_VectorNEON32x4.hpp"
+#endif
+
+#if defined( __SSE2__ )
+#include "Obbligato/SIMD_VectorSSE32x4.hpp"
+#include "Obbligato/SIMD_VectorSSE64x2.hpp"
+#endif
+
+#if defined( __AVX__ )
+#include "Obbligato/SIMD_VectorAVX32x8.hpp"
+#include "Obbligato/SIMD_VectorAVX64x4.hpp"
+#endif
+
+namespace Obbligato
+{
+namespace SIMD
+{
+
+/// Four quadrant arctangent of y/x for every item, using a polynomial
+/// with a maximum error of about 1e-5 radians so that it stays in
+/// registers
+template <typename T, size_t N>
+inline SIMD_Vector<T, N> fast_atan2( SIMD_Vector<T, N> const &y,
+                                     SIMD_Vector<T, N> const &x )
+{
+    typedef SIMD_Vector<T, N> simd_type;
+    simd_type z;
+    zero( z );
+
+    // reduce to an argument in [0,1] by swapping when |y| > |x|
+    simd_type ax = abs( x );
+    simd_type ay = abs( y );
+    simd_type swapped = greater( ay, ax );
+    simd_type lo = ay + swapped * ( ax - ay );
+    simd_type hi = ax + swapped * ( ay - ax );
+    simd_type t = lo / ( hi + equal_to( hi, z ) );
+    simd_type s = t * t;
+
+    simd_type p = s * T( -0.01172120 ) + T( 0.05265332 );
+    p = p * s + T( -0.11643287 );
+    p = p * s + T( 0.19354346 );
+    p = p * s + T( -0.33262347 );
+    p = p * s + T( 0.99997726 );
+    simd_type a = p * t;
+
+    // undo the reduction and move the result to the right quadrant
+    a = a + swapped * ( -( a + a ) + T( OBBLIGATO_PI_OVER_TWO ) );
+    a = a + less( x, z ) * ( -( a + a ) + T( OBBLIGATO_PI ) );
+    a = a - less( y, z ) * ( a + a );
+    return a;
+}
+
+/** \addtogroup simd_complex complex vectors
+ *
+ * SIMD_Vector of std::complex keeps the real and the imaginary parts in
+ * two separate SIMD_Vector, so that each part fills native registers
+ * and complex arithmetic runs on whole vectors.
+ *
+ * As the items are not stored as std::complex, there is no data(),
+ * no iterators and non-const operator[] returns a proxy reference.
+ */
+/**@{*/
+
+template <typename T, size_t N>
+class OBBLIGATO_PLATFORM_VECTOR_ALIGN SIMD_Vector<std::complex<T>, N>
+{
+  public:
+    /// The type of the vector
+    typedef SIMD_Vector<std::complex<T>, N> simd_type;
+
+    /// The type that the vector contains
+    typedef std::complex<T> value_type;
+
+    /// The type of each of the real and imaginary parts
+    typedef T scalar_type;
+
+    /// The vector type holding the real or the imaginary parts
+    typedef SIMD_Vector<T, N> real_type;
+
+    typedef std::size_t size_type;
+    typedef std::ptrdiff_t difference_type;
+
+    enum
+    {
+        /// The static size of the vector
+        vector_size = N
+    };
+
+    /// Proxy returned by the non-const index operator
+    class reference
+    {
+      public:
+        reference( simd_type &v, size_t index )
+            : m_v( v ), m_index( index )
+        {
+        }
+
+        operator value_type() const { return m_v.get( m_index ); }
+
+        reference &operator=( value_type const &a )
+        {
+            m_v.set( m_index, a );
+            return *this;
+        }
+
+        reference &operator=( reference const &a )
+        {
+            m_v.set( m_index, value_type( a ) );
+            return *this;
+        }
+
+        scalar_type real() const { return m_v.m_real[m_index]; }
+        scalar_type imag() const { return m_v.m_imag[m_index]; }
+
+      private:
+        simd_type &m_v;
+        size_t m_index;
+    };
+
+    /// The real parts of the items
+    real_type m_real;
+
+    /// The imaginary parts of the items
+    real_type m_imag;
+
+    /// Default constructor does not initialize any values
+    SIMD_Vector() {}
+
+    /// Set every item to re + i*im
+    SIMD_Vector( scalar_type re, scalar_type im )
+    {
+        splat( m_real, re );
+        splat( m_imag, im );
+    }
+
+    /// Set every item to a
+    explicit SIMD_Vector( value_type const &a )
+    {
+        splat( m_real, a.real() );
+        splat( m_imag, a.imag() );
+    }
+
+    /// Construct from the real and imaginary parts
+    SIMD_Vector( real_type const &re, real_type const &im )
+        : m_real( re ), m_imag( im )
+    {
+    }
+
+#if __cplusplus >= 201103L
+    /// The Initializer list constructor sets the values
+    SIMD_Vector( std::initializer_list<value_type> list )
+    {
+        zero( *this );
+        size_t n = 0;
+        for ( auto v = std::begin( list );
+              v != std::end( list ) && n < vector_size;
+              ++v )
+        {
+            set( n++, *v );
+        }
+    }
+#endif
+
+    /// Get the vector size
+    size_type size() const { return vector_size; }
+
+    /// Get the vector maximum size
+    size_type max_size() const { return vector_size; }
+
+    /// Is it empty
+    bool empty() const { return false; }
+
+    /// Fill with a specific value
+    void fill( value_type const &a )
+    {
+        splat( m_real, a.real() );
+        splat( m_imag, a.imag() );
+    }
+
+    /// Swap values in container with the other
+    void swap( simd_type &other )
+    {
+        std::swap( m_real, other.m_real );
+        std::swap( m_imag, other.m_imag );
+    }
+
+    /// Get item index
+    value_type get( size_t index ) const
+    {
+        return value_type( m_real[index], m_imag[index] );
+    }
+
+    /// Set item index to a
+    void set( size_t index, value_type const &a )
+    {
+        m_real[index] = a.real();
+        m_imag[index] = a.imag();
+    }
+
+    /// array index operator returns a copy of the item
+    value_type operator[]( size_t index ) const { return get( index ); }
+
+    /// array index operator returns a proxy reference to the item
+    reference operator[]( size_t index )
+    {
+        return reference( *this, index );
+    }
+
+    /// at() returns a copy of the item, with range checking
+    value_type at( size_t index ) const
+    {
+        if ( index >= size() )
+        {
+            throw std::out_of_range( "SIMD_Vector" );
+        }
+        return get( index );
+    }
+
+    /// at() returns a proxy reference to the item, with range checking
+    reference at( size_t index )
+    {
+        if ( index >= size() )
+        {
+            throw std::out_of_range( "SIMD_Vector" );
+        }
+        return reference( *this, index );
+    }
+
+    /// Output the vector to the ostream
+    template <typename CharT, typename TraitsT>
+    friend std::basic_ostream<CharT, TraitsT> &
+        operator<<( std::basic_ostream<CharT, TraitsT> &str,
+                    simd_type const &a )
+    {
+        str << "{ ";
+        for ( size_t i = 0; i < vector_size; ++i )
+        {
+            str << a.get( i ) << " ";
+        }
+        str << " }";
+        return str;
+    }
+
+    friend simd_type splat( simd_type &v, value_type a )
+    {
+        v.fill( a );
+        return v;
+    }
+
+    friend simd_type zero( simd_type &v )
+    {
+        zero( v.m_real );
+        zero( v.m_imag );
+        return v;
+    }
+
+    friend simd_type one( simd_type &v )
+    {
+        one( v.m_real );
+        zero( v.m_imag );
+        return v;
+    }
+
+    /// Load the items from separate arrays of real and imaginary parts,
+    /// each aligned to the size of real_type
+    friend simd_type load( simd_type &v,
+                           scalar_type const *re,
+                           scalar_type const *im )
+    {
+        load( v.m_real, re );
+        load( v.m_imag, im );
+        return v;
+    }
+
+    /// Load the items from separate, possibly unaligned, arrays of real
+    /// and imaginary parts
+    friend simd_type loadu( simd_type &v,
+                            scalar_type const *re,
+                            scalar_type const *im )
+    {
+        loadu( v.m_real, re );
+        loadu( v.m_imag, im );
+        return v;
+    }
+
+    /// Store the items to separate arrays of real and imaginary parts,
+    /// each aligned to the size of real_type
+    friend void
+        store( simd_type const &v, scalar_type *re, scalar_type *im )
+    {
+        store( v.m_real, re );
+        store( v.m_imag, im );
+    }
+
+    /// Store the items to separate, possibly unaligned, arrays of real
+    /// and imaginary parts
+    friend void
+        storeu( simd_type const &v, scalar_type *re, scalar_type *im )
+    {
+        storeu( v.m_real, re );
+        storeu( v.m_imag, im );
+    }
+
+    /// Load the items from an array of std::complex
+    friend simd_type load_interleaved( simd_type &v,
+                                       value_type const *p )
+    {
+        for ( size_t i = 0; i < vector_size; ++i )
+        {
+            v.set( i, p[i] );
+        }
+        return v;
+    }
+
+    /// Store the items to an array of std::complex
+    friend void store_interleaved( simd_type const &v, value_type *p )
+    {
+        for ( size_t i = 0; i < vector_size; ++i )
+        {
+            p[i] = v.get( i );
+        }
+    }
+
+    /// Copy all items to p, returning the pointer just past the last
+    /// item written
+    friend value_type *flatten_to( simd_type const &v, value_type *p )
+    {
+        store_interleaved( v, p );
+        return p + vector_size;
+    }
+
+    /// Copy all items from p, returning the pointer just past the last
+    /// item read
+    friend value_type const *unflatten_from( simd_type &v,
+                                             value_type const *p )
+    {
+        load_interleaved( v, p );
+        return p + vector_size;
+    }
+
+    friend real_type real( simd_type const &a ) { return a.m_real; }
+
+    friend real_type imag( simd_type const &a ) { return a.m_imag; }
+
+    friend simd_type conj( simd_type const &a )
+    {
+        return simd_type( a.m_real, -a.m_imag );
+    }
+
+    /// The squared magnitude of each item
+    friend real_type norm( simd_type const &a )
+    {
+        return a.m_real * a.m_real + a.m_imag * a.m_imag;
+    }
+
+    /// The magnitude of each item
+    friend real_type abs( simd_type const &a )
+    {
+        return sqrt( norm( a ) );
+    }
+
+    /// The phase angle of each item, see fast_atan2()
+    friend real_type arg( simd_type const &a )
+    {
+        return fast_atan2( a.m_imag, a.m_real );
+    }
+
+    friend simd_type sqrt( simd_type const &a )
+    {
+        simd_type r;
+        for ( size_t i = 0; i < vector_size; ++i )
+        {
+            r.set( i, std::sqrt( a.get( i ) ) );
+        }
+        return r;
+    }
+
+    friend simd_type reciprocal( simd_type const &a )
+    {
+        real_type d = reciprocal( norm( a ) );
+        return simd_type( a.m_real * d, -a.m_imag * d );
+    }
+
+    friend simd_type operator-( simd_type const &a )
+    {
+        return simd_type( -a.m_real, -a.m_imag );
+    }
+
+    friend simd_type operator+( simd_type const &a ) { return a; }
+
+    friend simd_type operator+( simd_type const &a, simd_type const &b )
+    {
+        return simd_type( a.m_real + b.m_real, a.m_imag + b.m_imag );
+    }
+
+    friend simd_type operator-( simd_type const &a, simd_type const &b )
+    {
+        return simd_type( a.m_real - b.m_real, a.m_imag - b.m_imag );
+    }
+
+    friend simd_type operator*( simd_type const &a, simd_type const &b )
+    {
+        return simd_type( a.m_real * b.m_real - a.m_imag * b.m_imag,
+                          a.m_real * b.m_imag + a.m_imag * b.m_real );
+    }
+
+    friend simd_type operator/( simd_type const &a, simd_type const &b )
+    {
+        real_type d = reciprocal( norm( b ) );
+        return simd_type(
+            ( a.m_real * b.m_real + a.m_imag * b.m_imag ) * d,
+            ( a.m_imag * b.m_real - a.m_real * b.m_imag ) * d );
+    }
+
+    friend simd_type operator+( simd_type const &a,
+                                value_type const &b )
+    {
+        return simd_type( a.m_real + b.real(), a.m_imag + b.imag() );
+    }
+
+    friend simd_type operator-( simd_type const &a,
+                                value_type const &b )
+    {
+        return simd_type( a.m_real - b.real(), a.m_imag - b.imag() );
+    }
+
+    friend simd_type operator*( simd_type const &a,
+                                value_type const &b )
+    {
+        return simd_type( a.m_real * b.real() - a.m_imag * b.imag(),
+                          a.m_real * b.imag() + a.m_imag * b.real() );
+    }
+
+    friend simd_type operator/( simd_type const &a,
+                                value_type const &b )
+    {
+        return a * ( value_type( 1 ) / b );
+    }
+
+    friend simd_type operator+( value_type const &a,
+                                simd_type const &b )
+    {
+        return b + a;
+    }
+
+    friend simd_type operator-( value_type const &a,
+                                simd_type const &b )
+    {
+        return -b + a;
+    }
+
+    friend simd_type operator*( value_type const &a,
+                                simd_type const &b )
+    {
+        return b * a;
+    }
+
+    friend simd_type operator/( value_type const &a,
+                                simd_type const &b )
+    {
+        return reciprocal( b ) * a;
+    }
+
+    friend simd_type operator+( simd_type const &a,
+                                scalar_type const &b )
+    {
+        return simd_type( a.m_real + b, a.m_imag );
+    }
+
+    friend simd_type operator-( simd_type const &a,
+                                scalar_type const &b )
+    {
+        return simd_type( a.m_real - b, a.m_imag );
+    }
+
+    friend simd_type operator*( simd_type const &a,
+                                scalar_type const &b )
+    {
+        return simd_type( a.m_real * b, a.m_imag * b );
+    }
+
+    friend simd_type operator/( simd_type const &a,
+                                scalar_type const &b )
+    {
+        return a * ( scalar_type( 1 ) / b );
+    }
+
+    friend simd_type operator+( scalar_type const &a,
+                                simd_type const &b )
+    {
+        return b + a;
+    }
+
+    friend simd_type operator-( scalar_type const &a,
+                                simd_type const &b )
+    {
+        return -b + a;
+    }
+
+    friend simd_type operator*( scalar_type const &a,
+                                simd_type const &b )
+    {
+        return b * a;
+    }
+
+    friend simd_type operator/( scalar_type const &a,
+                                simd_type const &b )
+    {
+        return reciprocal( b ) * a;
+    }
+
+    friend simd_type operator+=( simd_type &a, simd_type const &b )
+    {
+        a = a + b;
+        return a;
+    }
+
+    friend simd_type operator-=( simd_type &a, simd_type const &b )
+    {
+        a = a - b;
+        return a;
+    }
+
+    friend simd_type operator*=( simd_type &a, simd_type const &b )
+    {
+        a = a * b;
+        return a;
+    }
+
+    friend simd_type operator/=( simd_type &a, simd_type const &b )
+    {
+        a = a / b;
+        return a;
+    }
+
+    friend simd_type operator*=( simd_type &a, scalar_type const &b )
+    {
+        a = a * b;
+        return a;
+    }
+
+    friend simd_type operator/=( simd_type &a, scalar_type const &b )
+    {
+        a = a / b;
+        return a;
+    }
+
+    friend simd_type equal_to( simd_type const &a, simd_type const &b )
+    {
+        real_type both = equal_to( a.m_real, b.m_real )
+                         * equal_to( a.m_imag, b.m_imag );
+        real_type z;
+        return simd_type( both, zero( z ) );
+    }
+
+    friend simd_type not_equal_to( simd_type const &a,
+                                   simd_type const &b )
+    {
+        real_type o;
+        real_type z;
+        one( o );
+        return simd_type( o - real( equal_to( a, b ) ), zero( z ) );
+    }
+};
+
+/// The items of a split complex vector are never contiguous
+template <typename T, size_t N>
+struct simd_is_packed<SIMD_Vector<std::complex<T>, N> >
+    : public std::false_type
+{
+};
+
+template <typename T, size_t N>
+SIMD_Vector<std::complex<T>, N> &
+    set_flattened_item( SIMD_Vector<std::complex<T>, N> &v,
+                        std::complex<T> const &a,
+                        size_t i )
+{
+    v.set( i, a );
+    return v;
+}
+
+template <typename T, size_t N>
+std::complex<T>
+    get_flattened_item( SIMD_Vector<std::complex<T>, N> const &v,
+                        size_t i )
+{
+    return v.get( i );
+}
+
+/**@}*/
+}
+}
@@ -226,6 +226,60 @@ class OBBLIGATO_PLATFORM_VECTOR_ALIGN SIMD_Vector<float, 4>
         return v;
     }
 
+    /// Load all items from p, which is aligned to the vector size
+    friend simd_type load( simd_type &v, const_pointer p )
+    {
+        v.m_vec = _mm_load_ps( p );
+        return v;
+    }
+
+    /// Load all items from p, which may be unaligned
+    friend simd_type loadu( simd_type &v, const_pointer p )
+    {
+        v.m_vec = _mm_loadu_ps( p );
+        return v;
+    }
+
+    /// Load the first count items from p and zero the rest
+    friend simd_type
+        load_partial( simd_type &v, const_pointer p, size_t count )
+    {
+        zero( v );
+        for ( size_t i = 0; i < count && i < vector_size; ++i )
+        {
+            v.m_item[i] = p[i];
+        }
+        return v;
+    }
+
+    /// Store all items to p, which is aligned to the vector size
+    friend void store( simd_type const &v, pointer p )
+    {
+        _mm_store_ps( p, v.m_vec );
+    }
+
+    /// Store all items to p, which may be unaligned
+    friend void storeu( simd_type const &v, pointer p )
+    {
+        _mm_storeu_ps( p, v.m_vec );
+    }
+
+    /// Store all items to aligned p without polluting the cache
+    friend void stream( simd_type const &v, pointer p )
+    {
+        _mm_stream_ps( p, v.m_vec );
+    }
+
+    /// Store the first count items to p
+    friend void
+        store_partial( simd_type const &v, pointer p, size_t count )
+    {
+        for ( size_t i = 0; i < count && i < vector_size; ++i )
+        {
+            p[i] = v.m_item[i];
+        }
+    }
+
     friend simd_type sqrt( simd_type const &a )
     {
         return reciprocal( reciprocal_sqrt( a ) );
@@ -473,7 +527,7 @@ class OBBLIGATO_PLATFORM_VECTOR_ALIGN SIMD_Vector<float, 4>
         internal_type t = _mm_set1_ps( 1.0f );
         internal_type f = _mm_setzero_ps();
 
-        internal_type x = _mm_cmpnlt_ps( a.m_vec, b.m_vec );
+        internal_type x = _mm_cmplt_ps( a.m_vec, b.m_vec );
         r.m_vec
             = _mm_or_ps( _mm_and_ps( x, t ), _mm_andnot_ps( x, f ) );
         return r;
@@ -486,7 +540,7 @@ class OBBLIGATO_PLATFORM_VECTOR_ALIGN SIMD_Vector<float, 4>
         internal_type t = _mm_set1_ps( 1.0f );
         internal_type f = _mm_setzero_ps();
 
-        internal_type x = _mm_cmpnle_ps( a.m_vec, b.m_vec );
+        internal_type x = _mm_cmple_ps( a.m_vec, b.m_vec );
         r.m_vec
             = _mm_or_ps( _mm_and_ps( x, t ), _mm_andnot_ps( x, f ) );
         return r;
@@ -498,7 +552,7 @@ class OBBLIGATO_PLATFORM_VECTOR_ALIGN SIMD_Vector<float, 4>
         internal_type t = _mm_set1_ps( 1.0f );
         internal_type f = _mm_setzero_ps();
 
-        internal_type x = _mm_cmpngt_ps( a.m_vec, b.m_vec );
+        internal_type x = _mm_cmpgt_ps( a.m_vec, b.m_vec );
         r.m_vec
             = _mm_or_ps( _mm_and_ps( x, t ), _mm_andnot_ps( x, f ) );
         return r;
@@ -511,7 +565,7 @@ class OBBLIGATO_PLATFORM_VECTOR_ALIGN SIMD_Vector<float, 4>
         internal_type t = _mm_set1_ps( 1.0f );
         internal_type f = _mm_setzero_ps();
 
-        internal_type x = _mm_cmpnge_ps( a.m_vec, b.m_vec );
+        internal_type x = _mm_cmpge_ps( a.m_vec, b.m_vec );
         r.m_vec
             = _mm_or_ps( _mm_and_ps( x, t ), _mm_andnot_ps( x, f ) );
         return r;
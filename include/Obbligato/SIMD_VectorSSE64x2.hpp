@@ -221,6 +221,60 @@ class OBBLIGATO_PLATFORM_VECTOR_ALIGN SIMD_Vector<double, 2>
         return v;
     }
 
+    /// Load all items from p, which is aligned to the vector size
+    friend simd_type load( simd_type &v, const_pointer p )
+    {
+        v.m_vec = _mm_load_pd( p );
+        return v;
+    }
+
+    /// Load all items from p, which may be unaligned
+    friend simd_type loadu( simd_type &v, const_pointer p )
+    {
+        v.m_vec = _mm_loadu_pd( p );
+        return v;
+    }
+
+    /// Load the first count items from p and zero the rest
+    friend simd_type
+        load_partial( simd_type &v, const_pointer p, size_t count )
+    {
+        zero( v );
+        for ( size_t i = 0; i < count && i < vector_size; ++i )
+        {
+            v.m_item[i] = p[i];
+        }
+        return v;
+    }
+
+    /// Store all items to p, which is aligned to the vector size
+    friend void store( simd_type const &v, pointer p )
+    {
+        _mm_store_pd( p, v.m_vec );
+    }
+
+    /// Store all items to p, which may be unaligned
+    friend void storeu( simd_type const &v, pointer p )
+    {
+        _mm_storeu_pd( p, v.m_vec );
+    }
+
+    /// Store all items to aligned p without polluting the cache
+    friend void stream( simd_type const &v, pointer p )
+    {
+        _mm_stream_pd( p, v.m_vec );
+    }
+
+    /// Store the first count items to p
+    friend void
+        store_partial( simd_type const &v, pointer p, size_t count )
+    {
+        for ( size_t i = 0; i < count && i < vector_size; ++i )
+        {
+            p[i] = v.m_item[i];
+        }
+    }
+
     friend simd_type sqrt( simd_type const &a )
     {
         simd_type r;
@@ -45,6 +45,7 @@
 #include <memory>
 #include <iterator>
 #include <climits>
+#include <limits>
 #include <cfloat>
 #include <complex>
 #include <valarray>
@@ -0,0 +1,223 @@
+/*
+ Copyright (c) 2013, J.D. Koftinoff Software, Ltd.
+ <jeffk@jdkoftinoff.com>
+ http://www.jdkoftinoff.com/
+ All rights reserved.
+
+ Permission to use, copy, modify, and/or distribute this software for
+ any
+ purpose with or without fee is hereby granted, provided that the above
+ copyright notice and this permission notice appear in all copies.
+
+ THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ WARRANTIES
+ WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "Obbligato/World.hpp"
+#include "Obbligato/DSP_BiquadDesign.hpp"
+
+#if __cplusplus >= 201103L
+
+namespace Obbligato
+{
+namespace DSP
+{
+
+uint32_t const BiquadDesignCache::none;
+
+BiquadDesignCache::BiquadDesignCache( size_t capacity,
+                                      int octave_bits,
+                                      double gain_steps )
+    : m_shift( 52 - std::min( std::max( octave_bits, 0 ), 51 ) )
+    , m_gain_steps( gain_steps )
+    , m_entries( std::max( capacity, size_t( 1 ) ) )
+    , m_size( 0 )
+    , m_newest( none )
+    , m_oldest( none )
+    , m_hits( 0 )
+    , m_misses( 0 )
+{
+    size_t table_size = 2;
+    while ( table_size < m_entries.size() * 2 )
+    {
+        table_size *= 2;
+    }
+    m_table.assign( table_size, none );
+    m_mask = table_size - 1;
+}
+
+uint64_t BiquadDesignCache::quantize( double v ) const
+{
+    // the sign, exponent and top mantissa bits of a positive double
+    // step evenly through each octave
+    uint64_t bits;
+    memcpy( &bits, &v, sizeof( bits ) );
+    return bits >> m_shift;
+}
+
+double BiquadDesignCache::unquantize( uint64_t key ) const
+{
+    // the middle of the step
+    uint64_t half_step = uint64_t( 1 ) << ( m_shift - 1 );
+    uint64_t bits = ( key << m_shift ) | half_step;
+    double v;
+    memcpy( &v, &bits, sizeof( v ) );
+    return v;
+}
+
+size_t BiquadDesignCache::slotOf( Key const &key ) const
+{
+    uint64_t h = uint64_t( key.m_sample_rate );
+    h = h * 31 + uint64_t( key.m_type );
+    h = h * 1000003 + key.m_freq;
+    h = h * 1000003 + key.m_q;
+    h = h * 1000003 + uint64_t( key.m_gain );
+    h ^= h >> 29;
+    h *= 0x9e3779b97f4a7c15ULL;
+    return size_t( h >> 32 ) & m_mask;
+}
+
+void BiquadDesignCache::unlink( uint32_t i )
+{
+    Entry &e = m_entries[i];
+    if ( e.m_newer != none )
+    {
+        m_entries[e.m_newer].m_older = e.m_older;
+    }
+    else
+    {
+        m_newest = e.m_older;
+    }
+    if ( e.m_older != none )
+    {
+        m_entries[e.m_older].m_newer = e.m_newer;
+    }
+    else
+    {
+        m_oldest = e.m_newer;
+    }
+}
+
+void BiquadDesignCache::linkNewest( uint32_t i )
+{
+    Entry &e = m_entries[i];
+    e.m_newer = none;
+    e.m_older = m_newest;
+    if ( m_newest != none )
+    {
+        m_entries[m_newest].m_newer = i;
+    }
+    m_newest = i;
+    if ( m_oldest == none )
+    {
+        m_oldest = i;
+    }
+}
+
+void BiquadDesignCache::erase( Key const &key )
+{
+    size_t slot = slotOf( key );
+    while ( !( m_entries[m_table[slot]].m_key == key ) )
+    {
+        slot = ( slot + 1 ) & m_mask;
+    }
+
+    // shift later members of the probe run back over the hole
+    size_t hole = slot;
+    for ( size_t next = ( hole + 1 ) & m_mask; m_table[next] != none;
+          next = ( next + 1 ) & m_mask )
+    {
+        size_t home = slotOf( m_entries[m_table[next]].m_key );
+        size_t from_home = ( next - home ) & m_mask;
+        size_t from_hole = ( next - hole ) & m_mask;
+        if ( from_home >= from_hole )
+        {
+            m_table[hole] = m_table[next];
+            hole = next;
+        }
+    }
+    m_table[hole] = none;
+}
+
+BiquadDesign BiquadDesignCache::design( BiquadType type,
+                                        double sample_rate,
+                                        double freq,
+                                        double q,
+                                        double gain )
+{
+    Key key;
+    key.m_type = int( type );
+    key.m_sample_rate = sample_rate;
+    key.m_freq = quantize( freq );
+    key.m_q = quantize( q );
+    key.m_gain = std::lround( gain * m_gain_steps );
+
+    size_t slot = slotOf( key );
+    for ( ; m_table[slot] != none; slot = ( slot + 1 ) & m_mask )
+    {
+        uint32_t i = m_table[slot];
+        if ( m_entries[i].m_key == key )
+        {
+            ++m_hits;
+            if ( i != m_newest )
+            {
+                unlink( i );
+                linkNewest( i );
+            }
+            return m_entries[i].m_design;
+        }
+    }
+
+    ++m_misses;
+    uint32_t i;
+    if ( m_size < m_entries.size() )
+    {
+        i = uint32_t( m_size++ );
+    }
+    else
+    {
+        // reuse the least recently used entry
+        i = m_oldest;
+        unlink( i );
+        erase( m_entries[i].m_key );
+        slot = slotOf( key );
+        while ( m_table[slot] != none )
+        {
+            slot = ( slot + 1 ) & m_mask;
+        }
+    }
+
+    Entry &entry = m_entries[i];
+    entry.m_key = key;
+    double quantized_freq = unquantize( key.m_freq );
+    double quantized_q = unquantize( key.m_q );
+    double quantized_gain = key.m_gain / m_gain_steps;
+    entry.m_design = biquad_design( type,
+                                    sample_rate,
+                                    quantized_freq,
+                                    quantized_q,
+                                    quantized_gain );
+    linkNewest( i );
+    m_table[slot] = i;
+    return entry.m_design;
+}
+
+void BiquadDesignCache::clear()
+{
+    std::fill( m_table.begin(), m_table.end(), none );
+    m_size = 0;
+    m_newest = none;
+    m_oldest = none;
+    m_hits = 0;
+    m_misses = 0;
+}
+}
+}
+
+#endif
@@ -0,0 +1,396 @@
+/*
+ Copyright (c) 2013, J.D. Koftinoff Software, Ltd.
+ <jeffk@jdkoftinoff.com>
+ http://www.jdkoftinoff.com/
+ All rights reserved.
+
+ Permission to use, copy, modify, and/or distribute this software for
+ any
+ purpose with or without fee is hereby granted, provided that the above
+ copyright notice and this permission notice appear in all copies.
+
+ THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ WARRANTIES
+ WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "Obbligato/World.hpp"
+#include "Obbligato/DSP_GraphScheduler.hpp"
+
+#if __cplusplus >= 201103L
+
+#if defined( __linux__ )
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace Obbligato
+{
+namespace DSP
+{
+
+/// How many times an idle worker yields, waiting for the next block,
+/// before it sleeps
+static size_t const graph_scheduler_spin_limit = 1000;
+
+GraphScheduler::GraphScheduler( size_t num_workers, bool pin_threads )
+    : m_num_workers( num_workers )
+    , m_prepared( false )
+    , m_epoch( 0 )
+    , m_stop( false )
+    , m_remaining( 0 )
+    , m_finished( 0 )
+    , m_deadline( 0 )
+    , m_block_time( 0 )
+    , m_work_time( 0 )
+    , m_critical_path_time( 0 )
+    , m_deadline_misses( 0 )
+{
+    size_t hardware_threads = std::thread::hardware_concurrency();
+    if ( hardware_threads == 0 )
+    {
+        hardware_threads = 1;
+    }
+    if ( m_num_workers == 0 )
+    {
+        m_num_workers = hardware_threads;
+    }
+
+    m_deques.reset( new WorkDeque[m_num_workers] );
+
+    for ( size_t i = 1; i < m_num_workers; ++i )
+    {
+        m_threads.push_back(
+            std::thread( &GraphScheduler::workerThread, this, i ) );
+
+#if defined( __linux__ )
+        if ( pin_threads )
+        {
+            cpu_set_t cpus;
+            CPU_ZERO( &cpus );
+            CPU_SET( int( i % hardware_threads ), &cpus );
+            pthread_setaffinity_np( m_threads.back().native_handle(),
+                                    sizeof( cpus ),
+                                    &cpus );
+        }
+#else
+        (void)pin_threads;
+#endif
+    }
+}
+
+GraphScheduler::~GraphScheduler()
+{
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for ( size_t i = 0; i < m_threads.size(); ++i )
+    {
+        m_threads[i].join();
+    }
+}
+
+size_t GraphScheduler::addTask( GraphTask *task )
+{
+    Node node;
+    node.m_task = task;
+    node.m_num_inputs = 0;
+    node.m_start = 0;
+    node.m_finish = 0;
+    node.m_rank = 0;
+    m_nodes.push_back( node );
+    m_prepared = false;
+    return m_nodes.size() - 1;
+}
+
+void GraphScheduler::addEdge( size_t from, size_t to )
+{
+    if ( from >= m_nodes.size() || to >= m_nodes.size() )
+    {
+        throw std::out_of_range( "GraphScheduler::addEdge" );
+    }
+    m_nodes[from].m_successors.push_back( to );
+    m_nodes[to].m_num_inputs++;
+    m_prepared = false;
+}
+
+void GraphScheduler::prepare()
+{
+    size_t const count = m_nodes.size();
+
+    // topological order
+    std::vector<size_t> inputs( count );
+    m_order.clear();
+    m_sources.clear();
+    for ( size_t i = 0; i < count; ++i )
+    {
+        inputs[i] = m_nodes[i].m_num_inputs;
+        if ( inputs[i] == 0 )
+        {
+            m_order.push_back( i );
+            m_sources.push_back( i );
+        }
+    }
+    for ( size_t i = 0; i < m_order.size(); ++i )
+    {
+        Node const &node = m_nodes[m_order[i]];
+        for ( size_t j = 0; j < node.m_successors.size(); ++j )
+        {
+            if ( --inputs[node.m_successors[j]] == 0 )
+            {
+                m_order.push_back( node.m_successors[j] );
+            }
+        }
+    }
+    if ( m_order.size() != count )
+    {
+        throw std::logic_error( "GraphScheduler graph has a cycle" );
+    }
+
+    // until the tasks have been timed every task counts as 1
+    for ( size_t i = count; i > 0; --i )
+    {
+        Node &node = m_nodes[m_order[i - 1]];
+        node.m_rank = 0;
+        for ( size_t j = 0; j < node.m_successors.size(); ++j )
+        {
+            node.m_rank = std::max(
+                node.m_rank, m_nodes[node.m_successors[j]].m_rank );
+        }
+        node.m_rank += 1;
+    }
+
+    m_critical_path.reserve( count );
+    m_pending.reset( new std::atomic<size_t>[count] );
+    for ( size_t i = 0; i < m_num_workers; ++i )
+    {
+        m_deques[i].m_items.assign( count, 0 );
+        m_deques[i].m_head = 0;
+        m_deques[i].m_tail = 0;
+    }
+    m_prepared = true;
+}
+
+void GraphScheduler::push( size_t worker, size_t node )
+{
+    WorkDeque &d = m_deques[worker];
+    d.lock();
+    d.m_items[d.m_tail % d.m_items.size()] = node;
+    d.m_tail++;
+    d.unlock();
+}
+
+bool GraphScheduler::popOrSteal( size_t worker, size_t &node )
+{
+    // the newest task of our own deque
+    WorkDeque &own = m_deques[worker];
+    own.lock();
+    bool found = own.m_tail != own.m_head;
+    if ( found )
+    {
+        own.m_tail--;
+        node = own.m_items[own.m_tail % own.m_items.size()];
+    }
+    own.unlock();
+
+    // or the oldest task of somebody else's
+    for ( size_t i = 1; !found && i < m_num_workers; ++i )
+    {
+        WorkDeque &victim = m_deques[( worker + i ) % m_num_workers];
+        victim.lock();
+        found = victim.m_tail != victim.m_head;
+        if ( found )
+        {
+            size_t capacity = victim.m_items.size();
+            node = victim.m_items[victim.m_head % capacity];
+            victim.m_head++;
+        }
+        victim.unlock();
+    }
+    return found;
+}
+
+void GraphScheduler::work( size_t worker )
+{
+    while ( m_remaining.load( std::memory_order_acquire ) > 0 )
+    {
+        size_t n;
+        if ( !popOrSteal( worker, n ) )
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        Node &node = m_nodes[n];
+        node.m_start = std::chrono::duration<double>(
+                           std::chrono::steady_clock::now()
+                           - m_block_start ).count();
+        node.m_task->run();
+        node.m_finish = std::chrono::duration<double>(
+                            std::chrono::steady_clock::now()
+                            - m_block_start ).count();
+
+        // successors are sorted by rank, so the most critical one is
+        // pushed last and runs next on this worker
+        for ( size_t j = 0; j < node.m_successors.size(); ++j )
+        {
+            size_t s = node.m_successors[j];
+            if ( m_pending[s].fetch_sub( 1, std::memory_order_acq_rel )
+                 == 1 )
+            {
+                push( worker, s );
+            }
+        }
+        m_remaining.fetch_sub( 1, std::memory_order_acq_rel );
+    }
+}
+
+void GraphScheduler::workerThread( size_t worker )
+{
+    DenormalGuard guard;
+    size_t seen = 0;
+    for ( ;; )
+    {
+        for ( size_t spin = 0;
+              spin < graph_scheduler_spin_limit
+              && m_epoch.load( std::memory_order_acquire ) == seen
+              && !m_stop.load();
+              ++spin )
+        {
+            std::this_thread::yield();
+        }
+
+        {
+            std::unique_lock<std::mutex> lock( m_mutex );
+            while ( !m_stop && m_epoch == seen )
+            {
+                m_wake.wait( lock );
+            }
+            if ( m_stop )
+            {
+                return;
+            }
+            seen = m_epoch;
+        }
+
+        work( worker );
+        m_finished.fetch_add( 1, std::memory_order_acq_rel );
+    }
+}
+
+bool GraphScheduler::run()
+{
+    if ( !m_prepared )
+    {
+        prepare();
+    }
+
+    DenormalGuard guard;
+    for ( size_t i = 0; i < m_nodes.size(); ++i )
+    {
+        m_pending[i].store( m_nodes[i].m_num_inputs,
+                            std::memory_order_relaxed );
+    }
+    m_finished.store( 0, std::memory_order_relaxed );
+    m_block_start = std::chrono::steady_clock::now();
+    m_remaining.store( m_nodes.size(), std::memory_order_release );
+
+    // sources are sorted by rank, so dealing them out in order leaves
+    // the most critical one at the back of each deque
+    for ( size_t i = 0; i < m_sources.size(); ++i )
+    {
+        push( i % m_num_workers, m_sources[i] );
+    }
+
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        ++m_epoch;
+    }
+    m_wake.notify_all();
+
+    work( 0 );
+
+    // no worker may still be looking at this block's state when the
+    // graph is changed or the next block starts
+    while ( m_finished.load( std::memory_order_acquire )
+            != m_num_workers - 1 )
+    {
+        std::this_thread::yield();
+    }
+
+    m_block_time = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now()
+                       - m_block_start ).count();
+    measure();
+
+    bool met = m_deadline <= 0 || m_block_time <= m_deadline;
+    if ( !met )
+    {
+        ++m_deadline_misses;
+    }
+    return met;
+}
+
+void GraphScheduler::measure()
+{
+    m_work_time = 0;
+    m_critical_path_time = 0;
+    m_critical_path.clear();
+
+    // the rank of a node is the run time of the longest path from its
+    // start to the end of the graph
+    for ( size_t i = m_order.size(); i > 0; --i )
+    {
+        Node &node = m_nodes[m_order[i - 1]];
+        double duration = node.m_finish - node.m_start;
+        m_work_time += duration;
+
+        double longest = 0;
+        for ( size_t j = 0; j < node.m_successors.size(); ++j )
+        {
+            longest = std::max( longest,
+                                m_nodes[node.m_successors[j]].m_rank );
+        }
+        node.m_rank = duration + longest;
+    }
+
+    std::vector<Node> &nodes = m_nodes;
+    auto by_rank = [&nodes]( size_t a, size_t b )
+    {
+        return nodes[a].m_rank < nodes[b].m_rank;
+    };
+    for ( size_t i = 0; i < m_nodes.size(); ++i )
+    {
+        std::sort( m_nodes[i].m_successors.begin(),
+                   m_nodes[i].m_successors.end(),
+                   by_rank );
+    }
+    std::sort( m_sources.begin(), m_sources.end(), by_rank );
+
+    // follow the highest ranks from the most critical source
+    if ( !m_sources.empty() )
+    {
+        size_t n = m_sources.back();
+        m_critical_path_time = m_nodes[n].m_rank;
+        for ( ;; )
+        {
+            m_critical_path.push_back( n );
+            if ( m_nodes[n].m_successors.empty() )
+            {
+                break;
+            }
+            n = m_nodes[n].m_successors.back();
+        }
+    }
+}
+}
+}
+
+#endif
@@ -0,0 +1,114 @@
+/*
+ Copyright (c) 2013, J.D. Koftinoff Software, Ltd.
+ <jeffk@jdkoftinoff.com>
+ http://www.jdkoftinoff.com/
+ All rights reserved.
+
+ Permission to use, copy, modify, and/or distribute this software for
+ any
+ purpose with or without fee is hereby granted, provided that the above
+ copyright notice and this permission notice appear in all copies.
+
+ THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ WARRANTIES
+ WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include "Obbligato/World.hpp"
+#include "Obbligato/DSP_OscillatorBank.hpp"
+
+#if __cplusplus >= 201103L
+
+namespace Obbligato
+{
+namespace DSP
+{
+
+OscillatorWavetable::OscillatorWavetable( OscillatorWaveform waveform,
+                                          size_t size )
+    : m_waveform( waveform ), m_size( size ), m_levels( 0 )
+{
+    if ( size < 4 || ( size & ( size - 1 ) ) != 0 )
+    {
+        throw std::invalid_argument(
+            "OscillatorWavetable size must be a power of 2" );
+    }
+    while ( harmonics( m_levels ) > 0 )
+    {
+        ++m_levels;
+    }
+    m_tables.assign( m_levels * ( m_size + 1 ), 0.0f );
+
+    // one cycle of sine, indexed by harmonic * point modulo size
+    std::vector<double> sine( m_size );
+    for ( size_t i = 0; i < m_size; ++i )
+    {
+        sine[i] = std::sin( OBBLIGATO_TWO_PI * double( i ) / m_size );
+    }
+
+    std::vector<double> sum( m_size );
+    for ( size_t l = 0; l < m_levels; ++l )
+    {
+        std::fill( sum.begin(), sum.end(), 0.0 );
+        size_t const top
+            = m_waveform == oscillator_sine ? 1 : harmonics( l );
+        for ( size_t h = 1; h <= top; ++h )
+        {
+            double const pi_h = OBBLIGATO_PI * double( h );
+            double weight = 0.0;
+            switch ( m_waveform )
+            {
+            case oscillator_sine:
+                weight = 1.0;
+                break;
+            case oscillator_saw:
+                weight = ( h & 1 ? 2.0 : -2.0 ) / pi_h;
+                break;
+            case oscillator_square:
+                weight = h & 1 ? 4.0 / pi_h : 0.0;
+                break;
+            case oscillator_triangle:
+                weight = h & 1 ? 8.0 / ( pi_h * pi_h ) : 0.0;
+                weight = h & 2 ? -weight : weight;
+                break;
+            }
+            if ( weight == 0.0 )
+            {
+                continue;
+            }
+            for ( size_t i = 0; i < m_size; ++i )
+            {
+                sum[i] += weight * sine[( h * i ) & ( m_size - 1 )];
+            }
+        }
+
+        float *table = &m_tables[l * ( m_size + 1 )];
+        for ( size_t i = 0; i < m_size; ++i )
+        {
+            table[i] = float( sum[i] );
+        }
+        table[m_size] = table[0];
+    }
+}
+
+size_t OscillatorWavetable::levelFor( double increment ) const
+{
+    for ( size_t l = 0; l + 1 < m_levels; ++l )
+    {
+        if ( harmonics( l ) * increment <= 0.5 )
+        {
+            return l;
+        }
+    }
+    return m_levels - 1;
+}
+}
+}
+
+#endif
@@ -45,6 +45,8 @@ Pool::Pool( size_t num_elements,
     m_element_storage_size = num_elements * element_size;
     m_low_level_allocation_function = low_level_allocation_function;
     m_low_level_free_function = low_level_free_function;
+    m_allocated_flags = 0;
+    m_element_storage = 0;
 
     if ( m_element_storage_size > 0 )
     {
@@ -75,7 +77,7 @@ Pool::Pool( size_t num_elements,
         r = false;
     }
 
-    if ( r == false )
+    if ( r )
     {
         throw std::bad_alloc();
     }
@@ -25,6 +25,8 @@
 #include "Obbligato/IOStream.hpp"
 #include "Obbligato/Test.hpp"
 #include "Obbligato/DSP.hpp"
+#include <chrono>
+#include <cstdlib>
 
 #if __cplusplus >= 201103L
 
@@ -104,6 +106,2660 @@ bool test_dsp_biquad()
     return true;
 }
 
+bool test_dsp_biquad_response()
+{
+    Biquad<float>::Coeffs coeffs;
+    coeffs.calculatePeak( 0, 96000.0, 1000.0, 0.707, 10.0 );
+
+    // evaluate four frequencies at once in split complex vectors
+    vec4complex z;
+    for ( size_t i = 0; i < z.size(); ++i )
+    {
+        z[i] = std::polar( 1.0f, float( OBBLIGATO_PI * i / 4.0 ) );
+    }
+
+    vec4complex response = coeffs.processZDomain( 0, z );
+    ob_log_info( label_fmt( "biquad response" ), response );
+
+    for ( size_t i = 0; i < z.size(); ++i )
+    {
+        std::complex<float> expected
+            = coeffs.processZDomain( 0, z.get( i ) );
+        if ( std::abs( response.get( i ) - expected ) > 1e-4f )
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// The response of float coefficients at z^-1 = exp( -i w ), in double
+std::complex<double>
+test_dsp_biquad_at( Biquad<float>::Coeffs const &c, double w )
+{
+    std::complex<double> z1 = std::polar( 1.0, -w ), z2 = z1 * z1;
+    return ( double( c.m_a0 ) + double( c.m_a1 ) * z1
+             + double( c.m_a2 ) * z2 )
+           / ( 1.0 + double( c.m_b1 ) * z1 + double( c.m_b2 ) * z2 );
+}
+
+bool test_dsp_frequency_response()
+{
+    // a chain's response is the product of its plugins', not each
+    // plugin evaluated at the one before's response
+    PluginChain<Biquad<float>, float, 3> chain;
+    chain[0].m_coeffs.calculateLowpass( 0, 48000.0, 8000.0, 0.707 );
+    chain[1].m_coeffs.calculatePeak( 0, 48000.0, 1000.0, 2.0, 6.0 );
+    chain[2].m_coeffs.calculateHighshelf( 0, 48000.0, 4000.0, -3.0 );
+    std::complex<float> z = std::polar( 1.0f, -0.1f );
+    std::complex<float> product
+        = chain[0].m_coeffs.processZDomain( 0, z )
+          * chain[1].m_coeffs.processZDomain( 0, z )
+          * chain[2].m_coeffs.processZDomain( 0, z );
+    if ( std::abs( chain.processZDomain( 0, z ) - product ) > 1e-5f )
+    {
+        ob_log_error( "plugin chain response is not the product" );
+        return false;
+    }
+
+    // the batched response matches the exact response of the chain
+    size_t const points = 1024;
+    FrequencyResponse<float> response(
+        FrequencyGrid<float>::logarithmic(
+            48000.0, 20.0, 20000.0, points ) );
+    std::vector<float> magnitude( points ), phase( points );
+    response.evaluate( chain, 0, &magnitude[0], &phase[0] );
+    for ( size_t i = 0; i < points; ++i )
+    {
+        double w = OBBLIGATO_TWO_PI * response.grid().frequency( i )
+                   / 48000.0;
+        std::complex<double> expected
+            = test_dsp_biquad_at( chain[0].m_coeffs, w )
+              * test_dsp_biquad_at( chain[1].m_coeffs, w )
+              * test_dsp_biquad_at( chain[2].m_coeffs, w );
+        std::complex<double> got
+            = std::polar( double( magnitude[i] ), double( phase[i] ) );
+        if ( std::abs( got - expected ) > 1e-5 * std::abs( expected ) )
+        {
+            ob_log_error( "frequency response mismatch at ", i );
+            return false;
+        }
+    }
+
+    // 64 channels of 8 stage equalizers, on one thread and on four,
+    // against processZDomain() one point at a time
+    size_t const channels = 64;
+    size_t const stages = 8;
+    BiquadBank<float> bank( channels, stages );
+    for ( size_t c = 0; c < channels; ++c )
+    {
+        for ( size_t s = 0; s < stages; ++s )
+        {
+            Biquad<float>::Coeffs coeffs;
+            coeffs.calculatePeak( 0,
+                                  48000.0,
+                                  50.0 * ( s + 1 ) * ( s + 1 ) + c,
+                                  1.0,
+                                  double( int( c % 7 ) - 3 ) );
+            bank.setCoeffs( c, s, coeffs );
+        }
+    }
+    std::vector<std::vector<float> > one( channels ), four( channels );
+    std::vector<float *> one_ptrs( channels ), four_ptrs( channels );
+    for ( size_t c = 0; c < channels; ++c )
+    {
+        one[c].resize( points );
+        four[c].resize( points );
+        one_ptrs[c] = &one[c][0];
+        four_ptrs[c] = &four[c][0];
+    }
+
+    std::chrono::steady_clock::time_point start
+        = std::chrono::steady_clock::now();
+    std::vector<float> scalar( points );
+    for ( size_t c = 0; c < channels; ++c )
+    {
+        for ( size_t i = 0; i < points; ++i )
+        {
+            float w = float( OBBLIGATO_TWO_PI
+                             * response.grid().frequency( i )
+                             / 48000.0 );
+            std::complex<float> z1 = std::polar( 1.0f, -w );
+            std::complex<float> h( 1.0f, 0.0f );
+            for ( size_t s = 0; s < stages; ++s )
+            {
+                h *= bank.getCoeffs( c, s ).processZDomain( 0, z1 );
+            }
+            scalar[i] = std::abs( h );
+        }
+    }
+    std::chrono::steady_clock::time_point middle
+        = std::chrono::steady_clock::now();
+    response.evaluateChannels( bank, channels, &one_ptrs[0], 0 );
+    std::chrono::steady_clock::time_point end
+        = std::chrono::steady_clock::now();
+    response.evaluateChannels( bank, channels, &four_ptrs[0], 0, 4 );
+
+    if ( one != four )
+    {
+        ob_log_error( "threaded frequency responses differ" );
+        return false;
+    }
+    for ( size_t i = 0; i < points; ++i )
+    {
+        double w = OBBLIGATO_TWO_PI * response.grid().frequency( i )
+                   / 48000.0;
+        std::complex<double> expected( 1.0, 0.0 );
+        for ( size_t s = 0; s < stages; ++s )
+        {
+            expected *= test_dsp_biquad_at(
+                bank.getCoeffs( channels - 1, s ), w );
+        }
+        if ( std::abs( one[channels - 1][i] - std::abs( expected ) )
+             > 5e-5 * std::abs( expected ) )
+        {
+            ob_log_error( "bank frequency response mismatch at ", i );
+            return false;
+        }
+    }
+
+    volatile float sink = scalar[points / 2];
+    (void)sink;
+    double scalar_time
+        = std::chrono::duration<double>( middle - start ).count();
+    double batch_time
+        = std::chrono::duration<double>( end - middle ).count();
+    ob_log_info( "64 channel 1024 point response, processZDomain: ",
+                 scalar_time,
+                 " s, FrequencyResponse: ",
+                 batch_time,
+                 " s" );
+    return true;
+}
+
+bool test_dsp_biquad_snapshot()
+{
+    typedef Biquad<vec4float> BiquadType;
+    BiquadType a, b;
+
+    for ( size_t i = 0; i < BiquadType::flattened_size; ++i )
+    {
+        a.m_coeffs.calculateLowpass(
+            i, 96000.0, 1000.0 * ( i + 1 ), 0.7 );
+    }
+
+    vec4float impulse;
+    one( impulse );
+    a( impulse );
+
+    // copy the coefficients and the state of all channels at once
+    float coeffs[BiquadType::flattened_size * 5];
+    float state[BiquadType::flattened_size * 2];
+    a.m_coeffs.flattenTo( coeffs );
+    a.m_state.flattenTo( state );
+    b.m_coeffs.unflattenFrom( coeffs );
+    b.m_state.unflattenFrom( state );
+
+    vec4float silence;
+    zero( silence );
+    for ( size_t n = 0; n < 16; ++n )
+    {
+        vec4float x = a( silence );
+        vec4float y = b( silence );
+        for ( size_t i = 0; i < x.size(); ++i )
+        {
+            if ( x[i] != y[i] )
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool test_dsp_biquad_design()
+{
+    // the branch free approximations behind the batch designer
+    double tan_error = 0.0, amplitude_error = 0.0;
+    for ( int i = 1; i < 1000; ++i )
+    {
+        double x = OBBLIGATO_PI_OVER_TWO * i / 1000.0;
+        double t = std::tan( x );
+        double e = std::abs( biquad_fast_tan( x ) - t ) / t;
+        tan_error = std::max( tan_error, e );
+        double db = 96.0 * i / 1000.0;
+        double a = pow( 10.0, db / 20.0 );
+        amplitude_error = std::max(
+            amplitude_error,
+            std::abs( biquad_fast_db_to_amplitude( db ) - a ) / a );
+    }
+    ob_log_info( "relative error of biquad_fast_tan: ",
+                 tan_error,
+                 " biquad_fast_db_to_amplitude: ",
+                 amplitude_error );
+    if ( tan_error > 1e-12 || amplitude_error > 1e-12 )
+    {
+        return false;
+    }
+
+    // a batch of designs matches the one at a time designs
+    size_t const channels = 64;
+    std::vector<double> freq( channels );
+    std::vector<double> q( channels );
+    std::vector<double> gain( channels );
+    for ( size_t c = 0; c < channels; ++c )
+    {
+        freq[c] = 20.0 * pow( 1000.0, c / double( channels ) );
+        q[c] = 0.5 + 0.1 * c;
+        gain[c] = -24.0 + 0.75 * c;
+    }
+    std::vector<float> a0( channels ), a1( channels ), a2( channels );
+    std::vector<float> b1( channels ), b2( channels );
+    BiquadType const types[] = {biquad_lowpass,
+                                biquad_highpass,
+                                biquad_bandpass,
+                                biquad_notch,
+                                biquad_peak,
+                                biquad_lowshelf,
+                                biquad_highshelf};
+    for ( size_t t = 0; t < sizeof( types ) / sizeof( types[0] ); ++t )
+    {
+        biquad_design_batch( types[t],
+                             48000.0,
+                             freq.data(),
+                             q.data(),
+                             gain.data(),
+                             channels,
+                             a0.data(),
+                             a1.data(),
+                             a2.data(),
+                             b1.data(),
+                             b2.data() );
+        for ( size_t c = 0; c < channels; ++c )
+        {
+            BiquadDesign d = biquad_design(
+                types[t], 48000.0, freq[c], q[c], gain[c] );
+            if ( std::abs( a0[c] - float( d.m_a0 ) ) > 1e-6f
+                 || std::abs( a1[c] - float( d.m_a1 ) ) > 1e-6f
+                 || std::abs( a2[c] - float( d.m_a2 ) ) > 1e-6f
+                 || std::abs( b1[c] - float( d.m_b1 ) ) > 1e-6f
+                 || std::abs( b2[c] - float( d.m_b2 ) ) > 1e-6f )
+            {
+                ob_log_error( "batch design differs, type ",
+                              int( types[t] ),
+                              " channel ",
+                              c );
+                return false;
+            }
+        }
+    }
+
+    // the cache quantizes, remembers and evicts the oldest design
+    BiquadDesignCache cache( 2 );
+    BiquadDesign first
+        = cache.design( biquad_peak, 48000.0, 1000.0, 0.7, 3.0 );
+    BiquadDesign near
+        = cache.design( biquad_peak, 48000.0, 1000.01, 0.7, 3.001 );
+    cache.design( biquad_peak, 48000.0, 2000.0, 0.7, 3.0 );
+    cache.design( biquad_peak, 48000.0, 4000.0, 0.7, 3.0 );
+    cache.design( biquad_peak, 48000.0, 1000.0, 0.7, 3.0 );
+    BiquadDesign exact
+        = biquad_design( biquad_peak, 48000.0, 1000.0, 0.7, 3.0 );
+    if ( near.m_a0 != first.m_a0 || cache.hits() != 1
+         || cache.misses() != 4 || cache.size() != 2
+         || std::abs( first.m_a0 - exact.m_a0 ) > 1e-3 )
+    {
+        ob_log_error( "design cache hits ",
+                      cache.hits(),
+                      " misses ",
+                      cache.misses() );
+        return false;
+    }
+
+    // a small cache evicting all the time agrees with a large one
+    BiquadDesignCache small( 16 ), large( 1024 );
+    for ( size_t i = 0; i < 5000; ++i )
+    {
+        double f = 100.0 * ( 1 + ( i * 7919 ) % 40 );
+        BiquadDesign a
+            = small.design( biquad_lowpass, 48000.0, f, 0.7, 0 );
+        BiquadDesign b
+            = large.design( biquad_lowpass, 48000.0, f, 0.7, 0 );
+        if ( a.m_a0 != b.m_a0 || a.m_b1 != b.m_b1 )
+        {
+            ob_log_error( "evicting design cache differs at ", i );
+            return false;
+        }
+    }
+    if ( small.size() != 16 || large.size() != 40 )
+    {
+        return false;
+    }
+
+    // sweep 64 peak filters through 100 frequencies, 10 times over
+    size_t const steps = 100;
+    size_t const sweeps = 10;
+    std::vector<Biquad<float> > biquads( channels );
+    std::chrono::steady_clock::time_point start
+        = std::chrono::steady_clock::now();
+    for ( size_t s = 0; s < sweeps * steps; ++s )
+    {
+        for ( size_t c = 0; c < channels; ++c )
+        {
+            biquads[c].m_coeffs.calculatePeak(
+                0, 48000.0, freq[c] * ( 1 + s % steps ), 1.0, 6.0 );
+        }
+    }
+    std::chrono::steady_clock::time_point direct_end
+        = std::chrono::steady_clock::now();
+
+    BiquadDesignCache sweep_cache( channels * steps );
+    for ( size_t s = 0; s < sweeps * steps; ++s )
+    {
+        for ( size_t c = 0; c < channels; ++c )
+        {
+            biquads[c].m_coeffs.set(
+                0,
+                sweep_cache.design( biquad_peak,
+                                    48000.0,
+                                    freq[c] * ( 1 + s % steps ),
+                                    1.0,
+                                    6.0 ) );
+        }
+    }
+    std::chrono::steady_clock::time_point cache_end
+        = std::chrono::steady_clock::now();
+
+    std::vector<double> swept( channels );
+    std::vector<double> ones( channels, 1.0 );
+    std::vector<double> six( channels, 6.0 );
+    for ( size_t s = 0; s < sweeps * steps; ++s )
+    {
+        for ( size_t c = 0; c < channels; ++c )
+        {
+            swept[c] = freq[c] * ( 1 + s % steps );
+        }
+        biquad_design_batch( biquad_peak,
+                             48000.0,
+                             swept.data(),
+                             ones.data(),
+                             six.data(),
+                             channels,
+                             a0.data(),
+                             a1.data(),
+                             a2.data(),
+                             b1.data(),
+                             b2.data() );
+    }
+    std::chrono::steady_clock::time_point batch_end
+        = std::chrono::steady_clock::now();
+
+    ob_log_info(
+        "64 channel sweeps, calculatePeak: ",
+        std::chrono::duration<double>( direct_end - start ).count(),
+        " s, BiquadDesignCache: ",
+        std::chrono::duration<double>( cache_end - direct_end ).count(),
+        " s, biquad_design_batch: ",
+        std::chrono::duration<double>( batch_end - cache_end ).count(),
+        " s" );
+    return true;
+}
+
+template <size_t Width>
+bool test_dsp_biquad_bank_one( size_t channels,
+                               size_t stages,
+                               size_t frames )
+{
+    BiquadBank<float, Width> bank( channels, stages );
+    std::vector<Biquad<float> > reference( channels * stages );
+    for ( size_t c = 0; c < channels; ++c )
+    {
+        for ( size_t s = 0; s < stages; ++s )
+        {
+            Biquad<float> &b = reference[c * stages + s];
+            if ( s == 0 )
+            {
+                b.m_coeffs.calculateLowpass(
+                    0, 48000.0, 2000.0 + 500.0 * c, 0.7 );
+            }
+            else
+            {
+                b.m_coeffs.calculatePeak(
+                    0, 48000.0, 300.0 * ( s + c ), 1.5, -4.0 );
+            }
+            bank.setCoeffs( c, s, b.m_coeffs );
+        }
+    }
+
+    std::vector<std::vector<float> > audio( channels );
+    std::vector<std::vector<float> > expected( channels );
+    std::vector<float *> pointers( channels );
+    for ( size_t c = 0; c < channels; ++c )
+    {
+        audio[c].resize( frames );
+        for ( size_t i = 0; i < frames; ++i )
+        {
+            audio[c][i] = float( ( i * 7919 + c * 31 ) % 101 ) / 50.0f
+                          - 1.0f;
+        }
+        expected[c] = audio[c];
+        for ( size_t s = 0; s < stages; ++s )
+        {
+            reference[c * stages + s].processInPlace(
+                expected[c].data(), frames );
+        }
+        pointers[c] = audio[c].data();
+    }
+
+    // two calls, so the state carries across blocks
+    size_t half = frames / 2 + 3;
+    bank.processInPlace( pointers.data(), half );
+    for ( size_t c = 0; c < channels; ++c )
+    {
+        pointers[c] += half;
+    }
+    bank.processInPlace( pointers.data(), frames - half );
+
+    for ( size_t c = 0; c < channels; ++c )
+    {
+        for ( size_t i = 0; i < frames; ++i )
+        {
+            if ( std::abs( audio[c][i] - expected[c][i] ) > 1e-5f )
+            {
+                ob_log_error( "biquad bank width ",
+                              Width,
+                              " differs at channel ",
+                              c,
+                              " frame ",
+                              i );
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool test_dsp_biquad_bank()
+{
+    size_t const native = simd_native_size<float>::value;
+    if ( !test_dsp_biquad_bank_one<native>( 13, 3, 1001 )
+         || !test_dsp_biquad_bank_one<16>( 37, 2, 300 )
+         || !test_dsp_biquad_bank_one<1>( 3, 2, 100 ) )
+    {
+        return false;
+    }
+
+    // 128 channels of 4 stages, one Biquad<float> per stage or a bank
+    size_t const channels = 128;
+    size_t const stages = 4;
+    size_t const frames = 256;
+    size_t const blocks = 100;
+    BiquadBank<float> bank( channels, stages );
+    std::vector<Biquad<float> > biquads( channels * stages );
+    std::vector<std::vector<float> > audio(
+        channels, std::vector<float>( frames, 0.25f ) );
+    std::vector<float *> pointers( channels );
+    for ( size_t c = 0; c < channels; ++c )
+    {
+        for ( size_t s = 0; s < stages; ++s )
+        {
+            biquads[c * stages + s].m_coeffs.calculatePeak(
+                0, 48000.0, 100.0 * ( c + s + 1 ), 0.7, 3.0 );
+            bank.setCoeffs( c, s, biquads[c * stages + s].m_coeffs );
+        }
+        pointers[c] = audio[c].data();
+    }
+
+    std::chrono::steady_clock::time_point start
+        = std::chrono::steady_clock::now();
+    for ( size_t b = 0; b < blocks; ++b )
+    {
+        for ( size_t c = 0; c < channels; ++c )
+        {
+            for ( size_t s = 0; s < stages; ++s )
+            {
+                biquads[c * stages + s].processInPlace( pointers[c],
+                                                        frames );
+            }
+        }
+    }
+    std::chrono::steady_clock::time_point middle
+        = std::chrono::steady_clock::now();
+    for ( size_t b = 0; b < blocks; ++b )
+    {
+        bank.processInPlace( pointers.data(), frames );
+    }
+    std::chrono::steady_clock::time_point end
+        = std::chrono::steady_clock::now();
+
+    ob_log_info(
+        "128 channels x 4 biquads, one channel at a time: ",
+        std::chrono::duration<double>( middle - start ).count(),
+        " s, BiquadBank<float,",
+        native,
+        ">: ",
+        std::chrono::duration<double>( end - middle ).count(),
+        " s" );
+    return true;
+}
+
+template <size_t K>
+bool test_dsp_biquad_lookahead_one( size_t frames, float &largest )
+{
+    size_t const stages = 16;
+    BiquadLookahead<float, K> lookahead( stages );
+    std::vector<Biquad<float> > reference( stages );
+    for ( size_t s = 0; s < stages; ++s )
+    {
+        double freq = 60.0 * ( s + 1 ) * ( s + 1 );
+        reference[s].m_coeffs.calculatePeak(
+            0, 48000.0, freq, 1.0 + 0.25 * s, s % 2 ? -6.0 : 6.0 );
+        lookahead.setCoeffs( s, reference[s].m_coeffs );
+    }
+
+    std::vector<float> audio( frames );
+    for ( size_t i = 0; i < frames; ++i )
+    {
+        audio[i] = float( ( i * 7919 ) % 101 ) / 50.0f - 1.0f;
+    }
+    std::vector<float> expected( audio );
+    for ( size_t i = 0; i < frames; ++i )
+    {
+        for ( size_t s = 0; s < stages; ++s )
+        {
+            expected[i] = reference[s]( expected[i] );
+        }
+    }
+
+    size_t half = frames / 2 + 1;
+    lookahead.processInPlace( audio.data(), half );
+    lookahead.processInPlace( audio.data() + half, frames - half );
+
+    largest = 0.0f;
+    for ( size_t i = 0; i < frames; ++i )
+    {
+        largest
+            = std::max( largest, std::abs( audio[i] - expected[i] ) );
+    }
+    return largest < 1e-3f;
+}
+
+bool test_dsp_biquad_lookahead()
+{
+    size_t const native = simd_native_size<float>::value;
+    float native_error = 0.0f, wide_error = 0.0f;
+    bool native_ok
+        = test_dsp_biquad_lookahead_one<native>( 4001, native_error );
+    bool wide_ok
+        = test_dsp_biquad_lookahead_one<16>( 4001, wide_error );
+    ob_log_info( "16 stage lookahead, largest difference K=",
+                 native,
+                 ": ",
+                 native_error,
+                 " K=16: ",
+                 wide_error );
+    if ( !native_ok || !wide_ok )
+    {
+        return false;
+    }
+
+    // compare the throughput with a cascade of Biquad<float>
+    size_t const stages = 16;
+    size_t const frames = 256;
+    size_t const blocks = 1000;
+    BiquadLookahead<float> lookahead( stages );
+    std::vector<Biquad<float> > biquads( stages );
+    for ( size_t s = 0; s < stages; ++s )
+    {
+        biquads[s].m_coeffs.calculatePeak(
+            0, 48000.0, 100.0 * ( s + 1 ), 0.7, 3.0 );
+        lookahead.setCoeffs( s, biquads[s].m_coeffs );
+    }
+    std::vector<float> audio( frames, 0.25f );
+
+    std::chrono::steady_clock::time_point start
+        = std::chrono::steady_clock::now();
+    for ( size_t b = 0; b < blocks; ++b )
+    {
+        for ( size_t s = 0; s < stages; ++s )
+        {
+            biquads[s].processInPlace( audio.data(), frames );
+        }
+    }
+    std::chrono::steady_clock::time_point middle
+        = std::chrono::steady_clock::now();
+    for ( size_t b = 0; b < blocks; ++b )
+    {
+        lookahead.processInPlace( audio.data(), frames );
+    }
+    std::chrono::steady_clock::time_point end
+        = std::chrono::steady_clock::now();
+
+    ob_log_info(
+        "16 biquads on one channel, Biquad<float>: ",
+        std::chrono::duration<double>( middle - start ).count(),
+        " s, BiquadLookahead<float,",
+        native,
+        ">: ",
+        std::chrono::duration<double>( end - middle ).count(),
+        " s" );
+    return true;
+}
+
+/// The discrete Fourier transform of re and im, computed directly
+void test_dsp_dft( std::vector<double> const &re,
+                   std::vector<double> const &im,
+                   std::vector<double> &out_re,
+                   std::vector<double> &out_im )
+{
+    size_t const n = re.size();
+    out_re.assign( n, 0.0 );
+    out_im.assign( n, 0.0 );
+    for ( size_t k = 0; k < n; ++k )
+    {
+        for ( size_t j = 0; j < n; ++j )
+        {
+            double w = -OBBLIGATO_TWO_PI * double( k * j % n ) / n;
+            double c = std::cos( w ), s = std::sin( w );
+            out_re[k] += re[j] * c - im[j] * s;
+            out_im[k] += re[j] * s + im[j] * c;
+        }
+    }
+}
+
+/// Compare the complex and real FFTs of every size up to 2048 with the
+/// direct DFT, and transform them back
+template <typename T>
+bool test_dsp_fft_one( char const *name, double tolerance )
+{
+    for ( size_t bits = 1; bits <= 11; ++bits )
+    {
+        size_t const n = size_t( 1 ) << bits;
+        std::vector<double> re( n ), im( n ), zero( n, 0.0 );
+        std::vector<double> ref_re, ref_im, real_re, real_im;
+        for ( size_t i = 0; i < n; ++i )
+        {
+            re[i] = std::sin( i * 0.37 ) + ( i * 7919 % 101 ) / 101.0;
+            im[i] = std::cos( i * 1.3 ) * 0.5;
+        }
+        test_dsp_dft( re, im, ref_re, ref_im );
+        test_dsp_dft( re, zero, real_re, real_im );
+
+        std::vector<T> in_re( re.begin(), re.end() );
+        std::vector<T> in_im( im.begin(), im.end() );
+        std::vector<T> out_re( n + 1 ), out_im( n + 1 );
+        double peak = 0.0;
+        for ( size_t k = 0; k < n; ++k )
+        {
+            peak = std::max( peak, std::abs( ref_re[k] ) );
+            peak = std::max( peak, std::abs( ref_im[k] ) );
+        }
+        double const limit = tolerance * peak;
+
+        shared_ptr<FFTPlan<T> const> plan = FFTPlan<T>::get( n );
+        plan->forward( &in_re[0], &in_im[0], &out_re[0], &out_im[0] );
+        for ( size_t k = 0; k < n; ++k )
+        {
+            if ( std::abs( out_re[k] - ref_re[k] ) > limit
+                 || std::abs( out_im[k] - ref_im[k] ) > limit )
+            {
+                ob_log_error( name, " fft ", n, " mismatch at ", k );
+                return false;
+            }
+        }
+
+        plan->inverse( &out_re[0], &out_im[0] );
+        for ( size_t i = 0; i < n; ++i )
+        {
+            if ( std::abs( out_re[i] - in_re[i] ) > tolerance
+                 || std::abs( out_im[i] - in_im[i] ) > tolerance )
+            {
+                ob_log_error(
+                    name, " inverse fft ", n, " mismatch at ", i );
+                return false;
+            }
+        }
+
+        if ( n < 4 )
+        {
+            continue;
+        }
+        RealFFTPlan<T> real( n );
+        real.forward( &in_re[0], &out_re[0], &out_im[0] );
+        for ( size_t k = 0; k < real.bins(); ++k )
+        {
+            if ( std::abs( out_re[k] - real_re[k] ) > limit
+                 || std::abs( out_im[k] - real_im[k] ) > limit )
+            {
+                ob_log_error(
+                    name, " real fft ", n, " mismatch at ", k );
+                return false;
+            }
+        }
+        std::vector<T> back( n );
+        real.inverse( &out_re[0], &out_im[0], &back[0] );
+        for ( size_t i = 0; i < n; ++i )
+        {
+            if ( std::abs( back[i] - in_re[i] ) > tolerance )
+            {
+                ob_log_error( name, " inverse real fft ", n,
+                              " mismatch at ", i );
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool test_dsp_fft()
+{
+    if ( !test_dsp_fft_one<float>( "float", 1e-5 )
+         || !test_dsp_fft_one<double>( "double", 1e-12 ) )
+    {
+        return false;
+    }
+
+    // plans are shared per size, and sizes must be powers of 2
+    if ( FFTPlan<float>::get( 1024 ) != FFTPlan<float>::get( 1024 ) )
+    {
+        ob_log_error( "fft plans are not shared" );
+        return false;
+    }
+    bool threw = false;
+    try
+    {
+        FFTPlan<float> plan( 1000 );
+    }
+    catch ( std::invalid_argument const & )
+    {
+        threw = true;
+    }
+    if ( !threw )
+    {
+        ob_log_error( "fft of size 1000 did not throw" );
+        return false;
+    }
+
+    // real plans check their own size before making the half size plan
+    size_t const bad_sizes[] = {2, 1000, 1026, 131072};
+    for ( size_t i = 0; i < 4; ++i )
+    {
+        std::string message;
+        try
+        {
+            RealFFTPlan<float> plan( bad_sizes[i] );
+        }
+        catch ( std::invalid_argument const &e )
+        {
+            message = e.what();
+        }
+        if ( message.compare( 0, 11, "RealFFTPlan" ) != 0 )
+        {
+            ob_log_error( "real fft of size ", bad_sizes[i],
+                          " threw \"", message, "\"" );
+            return false;
+        }
+    }
+
+    // the largest size goes there and back
+    size_t const largest = FFTPlan<float>::max_size;
+    std::vector<float> re( largest ), im( largest );
+    for ( size_t i = 0; i < largest; ++i )
+    {
+        re[i] = float( ( i * 7919 ) % 101 ) / 50 - 1;
+        im[i] = float( ( i * 104729 ) % 97 ) / 48 - 1;
+    }
+    std::vector<float> re2( re ), im2( im );
+    shared_ptr<FFTPlan<float> const> plan
+        = FFTPlan<float>::get( largest );
+    plan->forward( &re2[0], &im2[0] );
+    plan->inverse( &re2[0], &im2[0] );
+    for ( size_t i = 0; i < largest; ++i )
+    {
+        if ( std::abs( re2[i] - re[i] ) > 1e-4
+             || std::abs( im2[i] - im[i] ) > 1e-4 )
+        {
+            ob_log_error( "fft 65536 round trip mismatch at ", i );
+            return false;
+        }
+    }
+
+    // a batch is the same as one channel at a time
+    size_t const n = 1024;
+    size_t const channels = 8;
+    std::vector<std::vector<float> > batch_re( channels ),
+        batch_im( channels );
+    std::vector<float *> re_ptrs( channels ), im_ptrs( channels );
+    for ( size_t c = 0; c < channels; ++c )
+    {
+        batch_re[c].assign( &re[c * n], &re[c * n] + n );
+        batch_im[c].assign( &im[c * n], &im[c * n] + n );
+        re_ptrs[c] = &batch_re[c][0];
+        im_ptrs[c] = &batch_im[c][0];
+    }
+    shared_ptr<FFTPlan<float> const> plan_n = FFTPlan<float>::get( n );
+    plan_n->forwardBatch( &re_ptrs[0], &im_ptrs[0], channels );
+    for ( size_t c = 0; c < channels; ++c )
+    {
+        std::vector<float> one_re( &re[c * n], &re[c * n] + n );
+        std::vector<float> one_im( &im[c * n], &im[c * n] + n );
+        plan_n->forward( &one_re[0], &one_im[0] );
+        if ( one_re != batch_re[c] || one_im != batch_im[c] )
+        {
+            ob_log_error( "fft batch channel ", c, " differs" );
+            return false;
+        }
+    }
+
+    // compare the throughput of the direct DFT and the FFT
+    std::vector<double> dre( n ), dim( n ), dout_re, dout_im;
+    for ( size_t i = 0; i < n; ++i )
+    {
+        dre[i] = re[i];
+        dim[i] = im[i];
+    }
+    size_t const repeats = 1000;
+    std::chrono::steady_clock::time_point start
+        = std::chrono::steady_clock::now();
+    test_dsp_dft( dre, dim, dout_re, dout_im );
+    std::chrono::steady_clock::time_point middle
+        = std::chrono::steady_clock::now();
+    for ( size_t r = 0; r < repeats; ++r )
+    {
+        plan_n->forward( &re_ptrs[0][0], &im_ptrs[0][0] );
+    }
+    std::chrono::steady_clock::time_point end
+        = std::chrono::steady_clock::now();
+
+    volatile float sink = re_ptrs[0][1];
+    (void)sink;
+    double dft_time
+        = std::chrono::duration<double>( middle - start ).count();
+    double fft_time
+        = std::chrono::duration<double>( end - middle ).count()
+          / repeats;
+    ob_log_info( "1024 point DFT: ",
+                 dft_time,
+                 " s, FFT: ",
+                 fft_time,
+                 " s" );
+    return true;
+}
+
+/// Convolve input with impulse directly, in double precision
+std::vector<double>
+test_dsp_convolve( std::vector<double> const &input,
+                   std::vector<double> const &impulse )
+{
+    std::vector<double> out( input.size(), 0.0 );
+    for ( size_t n = 0; n < input.size(); ++n )
+    {
+        for ( size_t k = 0; k < impulse.size() && k <= n; ++k )
+        {
+            out[n] += impulse[k] * input[n - k];
+        }
+    }
+    return out;
+}
+
+template <typename T>
+bool test_dsp_fir_one( char const *name, double tolerance )
+{
+    size_t const frames = 1000;
+    std::vector<double> input( frames );
+    for ( size_t i = 0; i < frames; ++i )
+    {
+        input[i] = std::sin( i * 0.05 )
+                   + ( i * 7919 % 101 ) / 101.0 - 0.5;
+    }
+
+    size_t const lengths[] = {1, 8, 13, 64, 100, 256};
+    for ( size_t l = 0; l < sizeof( lengths ) / sizeof( lengths[0] );
+          ++l )
+    {
+        std::vector<double> kernel( lengths[l] );
+        for ( size_t k = 0; k < kernel.size(); ++k )
+        {
+            kernel[k] = ( k * 104729 % 97 ) / 48.0 - 1;
+        }
+        std::vector<double> expected
+            = test_dsp_convolve( input, kernel );
+        std::vector<T> tkernel( kernel.begin(), kernel.end() );
+
+        // at the input rate, in place in uneven pieces
+        Fir<T> fir( &tkernel[0], tkernel.size() );
+        std::vector<T> buf( input.begin(), input.end() );
+        for ( size_t pos = 0, piece = 1; pos < frames;
+              piece = piece * 3 % 157 )
+        {
+            size_t n = std::min( piece, frames - pos );
+            fir.processInPlace( &buf[pos], n );
+            pos += n;
+        }
+        for ( size_t i = 0; i < frames; ++i )
+        {
+            if ( std::abs( buf[i] - expected[i] ) > tolerance )
+            {
+                ob_log_error( name, " fir of ", kernel.size(),
+                              " taps mismatch at ", i );
+                return false;
+            }
+        }
+
+        // keeping every third output, across odd sized calls
+        Fir<T> decimator( &tkernel[0], tkernel.size(), 3 );
+        std::vector<T> in( input.begin(), input.end() );
+        std::vector<T> decimated( frames );
+        size_t written
+            = decimator.decimate( &in[0], &decimated[0], 500 );
+        written += decimator.decimate(
+            &in[500], &decimated[written], frames - 500 );
+        if ( written != ( frames + 2 ) / 3 )
+        {
+            ob_log_error( name, " fir decimated to ", written );
+            return false;
+        }
+        for ( size_t i = 0; i < written; ++i )
+        {
+            if ( std::abs( decimated[i] - expected[i * 3] )
+                 > tolerance )
+            {
+                ob_log_error( name, " fir of ", kernel.size(),
+                              " taps decimation mismatch at ", i );
+                return false;
+            }
+        }
+
+        // against the zero stuffed input filtered at the output rate
+        size_t const factor = 4;
+        std::vector<double> stuffed( frames * factor, 0.0 );
+        for ( size_t i = 0; i < frames; ++i )
+        {
+            stuffed[i * factor] = input[i];
+        }
+        std::vector<double> stuffed_expected
+            = test_dsp_convolve( stuffed, kernel );
+        Fir<T> interpolator( &tkernel[0], tkernel.size(), factor );
+        std::vector<T> interpolated( frames * factor );
+        interpolator.interpolate( &in[0], &interpolated[0], frames );
+        for ( size_t i = 0; i < frames * factor; ++i )
+        {
+            if ( std::abs( interpolated[i] - stuffed_expected[i] )
+                 > tolerance )
+            {
+                ob_log_error( name, " fir of ", kernel.size(),
+                              " taps interpolation mismatch at ", i );
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool test_dsp_fir()
+{
+    if ( !test_dsp_fir_one<float>( "float", 1e-4 )
+         || !test_dsp_fir_one<double>( "double", 1e-10 ) )
+    {
+        return false;
+    }
+
+    // compare the throughput of a naive loop and Fir
+    size_t const taps = 64;
+    size_t const frames = 48000;
+    std::vector<float> kernel( taps ), audio( frames );
+    for ( size_t k = 0; k < taps; ++k )
+    {
+        kernel[k] = float( ( k * 104729 % 97 ) / 48.0 - 1 ) / taps;
+    }
+    for ( size_t i = 0; i < frames; ++i )
+    {
+        audio[i] = float( ( i * 7919 ) % 101 ) / 50 - 1;
+    }
+    std::vector<float> naive( frames ), history( taps, 0.0f );
+    Fir<float> fir( &kernel[0], taps );
+    std::vector<float> fast( frames );
+
+    std::chrono::steady_clock::time_point start
+        = std::chrono::steady_clock::now();
+    for ( size_t i = 0; i < frames; ++i )
+    {
+        for ( size_t k = taps - 1; k > 0; --k )
+        {
+            history[k] = history[k - 1];
+        }
+        history[0] = audio[i];
+        float y = 0.0f;
+        for ( size_t k = 0; k < taps; ++k )
+        {
+            y += kernel[k] * history[k];
+        }
+        naive[i] = y;
+    }
+    std::chrono::steady_clock::time_point middle
+        = std::chrono::steady_clock::now();
+    fir.process( &audio[0], &fast[0], frames );
+    std::chrono::steady_clock::time_point end
+        = std::chrono::steady_clock::now();
+
+    for ( size_t i = 0; i < frames; ++i )
+    {
+        if ( std::abs( fast[i] - naive[i] ) > 1e-5 )
+        {
+            ob_log_error( "fir differs from the naive loop at ", i );
+            return false;
+        }
+    }
+    volatile float sink = fast[frames - 1] + naive[frames - 1];
+    (void)sink;
+    double naive_time
+        = std::chrono::duration<double>( middle - start ).count();
+    double fir_time
+        = std::chrono::duration<double>( end - middle ).count();
+    ob_log_info( "64 tap fir, one second at 48 kHz, naive: ",
+                 naive_time,
+                 " s, Fir: ",
+                 fir_time,
+                 " s" );
+    return true;
+}
+
+template <typename T>
+bool test_dsp_convolver_one( char const *name, double tolerance )
+{
+    size_t const frames = 3000;
+    std::vector<double> input( frames );
+    for ( size_t i = 0; i < frames; ++i )
+    {
+        input[i] = std::sin( i * 0.05 )
+                   + ( i * 7919 % 101 ) / 101.0 - 0.5;
+    }
+
+    // shorter than, equal to and much longer than a block, and one
+    // that ends part way through a partition
+    size_t const lengths[] = {1, 10, 64, 65, 1000, 2500};
+    for ( size_t l = 0; l < sizeof( lengths ) / sizeof( lengths[0] );
+          ++l )
+    {
+        std::vector<double> impulse( lengths[l] );
+        for ( size_t k = 0; k < impulse.size(); ++k )
+        {
+            impulse[k] = std::exp( -double( k ) / 300 )
+                         * ( ( k * 104729 % 97 ) / 48.0 - 1 );
+        }
+        std::vector<double> expected
+            = test_dsp_convolve( input, impulse );
+
+        std::vector<T> timpulse( impulse.begin(), impulse.end() );
+        Convolver<T> convolver( &timpulse[0], timpulse.size(), 64 );
+
+        // in uneven pieces, in place
+        std::vector<T> buf( input.begin(), input.end() );
+        size_t pos = 0;
+        for ( size_t piece = 1; pos < frames; piece = piece * 3 % 157 )
+        {
+            size_t n = std::min( piece, frames - pos );
+            convolver.processInPlace( &buf[pos], n );
+            pos += n;
+        }
+        for ( size_t i = 0; i < frames; ++i )
+        {
+            if ( std::abs( buf[i] - expected[i] ) > tolerance )
+            {
+                ob_log_error( name, " convolver of ", impulse.size(),
+                              " taps mismatch at ", i, ": ", buf[i],
+                              " expected ", expected[i] );
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool test_dsp_convolver()
+{
+    if ( !test_dsp_convolver_one<float>( "float", 1e-4 )
+         || !test_dsp_convolver_one<double>( "double", 1e-10 ) )
+    {
+        return false;
+    }
+
+    bool threw = false;
+    try
+    {
+        ConvolverResponse<float> response( 0, 0, 64 );
+    }
+    catch ( std::invalid_argument const & )
+    {
+        threw = true;
+    }
+    if ( !threw )
+    {
+        ob_log_error( "convolver with no taps did not throw" );
+        return false;
+    }
+
+    // a room correction sized response on a stereo pair sharing one
+    // response, then one second of audio for timing
+    size_t const taps = 65536;
+    size_t const block = 256;
+    size_t const frames = 48000;
+    std::vector<float> impulse( taps );
+    for ( size_t k = 0; k < taps; ++k )
+    {
+        impulse[k] = float( std::exp( -double( k ) / 8000 )
+                            * ( ( k * 104729 % 97 ) / 48.0 - 1 ) );
+    }
+    shared_ptr<ConvolverResponse<float> const> response(
+        new ConvolverResponse<float>( &impulse[0], taps, block ) );
+    ConvolverBank<float> bank( 2, response );
+
+    // an impulse on each channel plays the response back
+    std::vector<float> left( taps + block, 0.0f ),
+        right( taps + block, 0.0f );
+    left[0] = 1.0f;
+    right[block / 2] = 0.5f;
+    float *channels[2] = {&left[0], &right[0]};
+    bank.processInPlace( channels, taps + block );
+    for ( size_t k = 0; k < taps; ++k )
+    {
+        if ( std::abs( left[k] - impulse[k] ) > 1e-5
+             || std::abs( right[k + block / 2] - impulse[k] * 0.5f )
+                    > 1e-5 )
+        {
+            ob_log_error( "convolver bank impulse mismatch at ", k );
+            return false;
+        }
+    }
+
+    std::vector<float> audio( frames );
+    for ( size_t i = 0; i < frames; ++i )
+    {
+        audio[i] = float( ( i * 7919 ) % 101 ) / 50 - 1;
+    }
+    Convolver<float> convolver( response );
+    std::chrono::steady_clock::time_point start
+        = std::chrono::steady_clock::now();
+    for ( size_t pos = 0; pos < frames; pos += 64 )
+    {
+        convolver.processInPlace( &audio[pos], 64 );
+    }
+    std::chrono::steady_clock::time_point end
+        = std::chrono::steady_clock::now();
+
+    volatile float sink = audio[frames - 1];
+    (void)sink;
+    double convolver_time
+        = std::chrono::duration<double>( end - start ).count();
+    ob_log_info( "65536 tap convolver, one second at 48 kHz: ",
+                 convolver_time,
+                 " s" );
+    return true;
+}
+
+/// Resample a sine of freq Hz at in_rate to out_rate through r in
+/// uneven blocks and return the largest error against the ideal sine
+/// at each output's time, skipping the start up
+template <typename T>
+double test_dsp_resampler_error( Resampler<T> &r,
+                                 double freq,
+                                 double in_rate,
+                                 double out_rate,
+                                 size_t in_frames )
+{
+    std::vector<T> in( in_frames ), out;
+    for ( size_t i = 0; i < in_frames; ++i )
+    {
+        in[i] = T( std::sin( OBBLIGATO_TWO_PI * freq * i / in_rate ) );
+    }
+    T buf[300];
+    for ( size_t pos = 0, piece = 1; pos < in_frames;
+          piece = piece * 3 % 157 )
+    {
+        size_t n = std::min( piece, in_frames - pos );
+        r.push( &in[pos], n );
+        pos += n;
+        for ( size_t got = r.pull( buf, 7 ); got > 0;
+              got = r.pull( buf, 7 ) )
+        {
+            out.insert( out.end(), buf, buf + got );
+        }
+    }
+
+    double worst = 0.0;
+    for ( size_t n = r.taps() * 2; n + r.taps() * 2 < out.size(); ++n )
+    {
+        double t = n / out_rate - r.latency() / in_rate;
+        double expected = std::sin( OBBLIGATO_TWO_PI * freq * t );
+        worst = std::max( worst, std::abs( out[n] - expected ) );
+    }
+    return worst;
+}
+
+bool test_dsp_resampler()
+{
+    // rational ratios use exact phases, and the outputs keep up with
+    // the inputs
+    size_t const rates[][2]
+        = {{44100, 48000}, {48000, 44100}, {48000, 96000},
+           {96000, 44100}};
+    for ( size_t i = 0; i < 4; ++i )
+    {
+        Resampler<float> r( rates[i][0], rates[i][1] );
+        if ( !r.isRational() )
+        {
+            ob_log_error( "resampler ", rates[i][0], " to ",
+                          rates[i][1], " is not rational" );
+            return false;
+        }
+        double error = test_dsp_resampler_error(
+            r, 1000.0, rates[i][0], rates[i][1], 20000 );
+        if ( error > 1e-3 )
+        {
+            ob_log_error( "resampler ", rates[i][0], " to ",
+                          rates[i][1], " error ", error );
+            return false;
+        }
+    }
+
+    // an arbitrary ratio interpolates between phases, and the best
+    // preset is more accurate than the fast one
+    double const ratio = 1.0 / 1.37;
+    Resampler<double> fast( ratio, resampler_fast );
+    Resampler<double> best( ratio, resampler_best );
+    double fast_error = test_dsp_resampler_error(
+        fast, 440.0, 48000.0, 48000.0 * ratio, 20000 );
+    double best_error = test_dsp_resampler_error(
+        best, 440.0, 48000.0, 48000.0 * ratio, 20000 );
+    if ( fast.isRational() || fast_error > 1e-2 || best_error > 1e-5
+         || best_error > fast_error )
+    {
+        ob_log_error( "resampler by ", ratio, " fast error ",
+                      fast_error, " best error ", best_error );
+        return false;
+    }
+
+    // pushing and pulling in pieces gives the same output as all at
+    // once, and as many outputs as the ratio implies
+    size_t const frames = 4410;
+    std::vector<float> in( frames );
+    for ( size_t i = 0; i < frames; ++i )
+    {
+        in[i] = float( ( i * 7919 ) % 101 ) / 50 - 1;
+    }
+    Resampler<float> whole( 44100, 48000 ), pieces( 44100, 48000 );
+    std::vector<float> whole_out( frames * 2 ), pieces_out;
+    whole.push( &in[0], frames );
+    size_t available = whole.available();
+    size_t written = whole.pull( &whole_out[0], whole_out.size() );
+    if ( written != available || written < 4800 - whole.taps()
+         || written > 4800 )
+    {
+        ob_log_error( "resampler wrote ", written, " of ", available );
+        return false;
+    }
+    for ( size_t pos = 0; pos < frames; pos += 90 )
+    {
+        float buf[200];
+        size_t got = pieces.process( &in[pos], 90, buf, 200 );
+        pieces_out.insert( pieces_out.end(), buf, buf + got );
+    }
+    if ( pieces_out.size() != written
+         || !std::equal( pieces_out.begin(),
+                         pieces_out.end(),
+                         whole_out.begin() ) )
+    {
+        ob_log_error( "resampler in pieces differs" );
+        return false;
+    }
+
+    // tones above the output nyquist are rejected
+    Resampler<float> down( 96000, 44100 );
+    std::vector<float> tone( 20000 ), toned( 20000 );
+    for ( size_t i = 0; i < tone.size(); ++i )
+    {
+        tone[i] = float( std::sin( OBBLIGATO_TWO_PI * 30000.0 * i
+                                   / 96000.0 ) );
+    }
+    size_t toned_frames = down.process(
+        &tone[0], tone.size(), &toned[0], toned.size() );
+    double leak = 0.0;
+    for ( size_t i = down.taps(); i < toned_frames; ++i )
+    {
+        leak = std::max( leak, double( std::abs( toned[i] ) ) );
+    }
+    if ( leak > 1e-3 )
+    {
+        ob_log_error( "resampler leaks ", leak, " above nyquist" );
+        return false;
+    }
+
+    // the cost of one second of 44.1 kHz to 48 kHz
+    std::vector<float> second( 44100 ), converted( 48100 );
+    for ( size_t i = 0; i < second.size(); ++i )
+    {
+        second[i] = in[i % frames];
+    }
+    Resampler<float> timed( 44100, 48000 );
+    std::chrono::steady_clock::time_point start
+        = std::chrono::steady_clock::now();
+    size_t converted_frames = 0;
+    for ( size_t pos = 0; pos < second.size(); pos += 441 )
+    {
+        converted_frames += timed.process( &second[pos],
+                                           441,
+                                           &converted[converted_frames],
+                                           converted.size()
+                                           - converted_frames );
+    }
+    std::chrono::steady_clock::time_point end
+        = std::chrono::steady_clock::now();
+
+    volatile float sink = converted[converted_frames / 2];
+    (void)sink;
+    double resampler_time
+        = std::chrono::duration<double>( end - start ).count();
+    ob_log_info( "resampler, one second of 44.1 kHz to 48 kHz: ",
+                 resampler_time,
+                 " s" );
+    return true;
+}
+
+bool test_dsp_delay_line()
+{
+    Pools pools( "delay_line", malloc, free );
+    pools.add( 65536, 8 );
+
+    // more channels than a register holds, and not a multiple of one
+    size_t const channels = 6;
+    size_t const block = 64;
+    size_t const blocks = 40;
+    DelayLine<float> delay( pools, channels, 100, block );
+    std::vector<std::vector<float> > in( channels ), out( channels );
+    std::vector<float const *> in_ptrs( channels );
+    std::vector<float *> out_ptrs( channels );
+    for ( size_t c = 0; c < channels; ++c )
+    {
+        in[c].resize( block );
+        out[c].resize( block );
+        in_ptrs[c] = &in[c][0];
+        out_ptrs[c] = &out[c][0];
+    }
+
+    DelayInterpolation const modes[]
+        = {delay_integer, delay_linear, delay_cubic, delay_allpass};
+    double const tolerances[] = {1e-6, 1e-3, 1e-5, 1e-3};
+    std::vector<float> delays( block );
+    for ( size_t m = 0; m < 4; ++m )
+    {
+        delay.reset();
+        for ( size_t b = 0; b < blocks; ++b )
+        {
+            // integer delays are exact for any signal, the others are
+            // checked on slow sines against the exact delayed sine
+            for ( size_t i = 0; i < block; ++i )
+            {
+                double t = double( b * block + i );
+                for ( size_t c = 0; c < channels; ++c )
+                {
+                    in[c][i] = float(
+                        std::sin( t * ( 0.02 + 0.01 * c ) ) );
+                }
+                delays[i]
+                    = float( 20.0 + 10.0 * std::sin( t * 0.001 ) );
+                if ( modes[m] == delay_integer )
+                {
+                    delays[i] = 17.0f;
+                }
+            }
+            delay.write( &in_ptrs[0], block );
+            delay.readModulated(
+                &out_ptrs[0], block, &delays[0], modes[m] );
+            if ( b < 2 )
+            {
+                continue;
+            }
+            for ( size_t i = 0; i < block; ++i )
+            {
+                double t = double( b * block + i ) - delays[i];
+                for ( size_t c = 0; c < channels; ++c )
+                {
+                    double expected
+                        = std::sin( t * ( 0.02 + 0.01 * c ) );
+                    if ( std::abs( out[c][i] - expected )
+                         > tolerances[m] )
+                    {
+                        ob_log_error( "delay line mode ", m,
+                                      " mismatch at block ", b,
+                                      " frame ", i, " channel ", c );
+                        return false;
+                    }
+                }
+            }
+        }
+    }
+
+    // a frame at a time is the same as a block at one delay
+    DelayLine<float> frames( pools, channels, 100, block );
+    delay.reset();
+    delay.write( &in_ptrs[0], block );
+    delay.read( &out_ptrs[0], block, 12.5, delay_cubic );
+    for ( size_t i = 0; i < block; ++i )
+    {
+        float frame[channels];
+        for ( size_t c = 0; c < channels; ++c )
+        {
+            frame[c] = in[c][i];
+        }
+        frames.writeFrame( frame );
+        frames.readFrame( frame, 12.5, delay_cubic );
+        for ( size_t c = 0; c < channels; ++c )
+        {
+            if ( frame[c] != out[c][i] )
+            {
+                ob_log_error( "delay line frame ", i, " differs" );
+                return false;
+            }
+        }
+    }
+
+    // a delay of 0 gives back the block just written
+    delay.read( &out_ptrs[0], block, 0, delay_linear );
+    for ( size_t c = 0; c < channels; ++c )
+    {
+        if ( out[c] != in[c] )
+        {
+            ob_log_error( "delay line delay 0 differs in channel ", c );
+            return false;
+        }
+    }
+
+    bool threw = false;
+    try
+    {
+        std::vector<float const *> big( channels, &delays[0] );
+        delay.write( &big[0], block + 1 );
+    }
+    catch ( std::out_of_range const & )
+    {
+        threw = true;
+    }
+    if ( !threw )
+    {
+        ob_log_error( "delay line write past maxFrames did not throw" );
+        return false;
+    }
+
+    // reads of more frames than a block, or than were written, throw
+    DelayLine<float> fresh( pools, channels, 100, block );
+    size_t const bad_frames[] = {block + 1, 1};
+    DelayLine<float> *lines[] = {&delay, &fresh};
+    for ( size_t k = 0; k < 2; ++k )
+    {
+        threw = false;
+        try
+        {
+            lines[k]->read(
+                &out_ptrs[0], bad_frames[k], 3.0, delay_linear );
+        }
+        catch ( std::out_of_range const & )
+        {
+            threw = true;
+        }
+        if ( !threw )
+        {
+            ob_log_error( "delay line bad read ", k, " did not throw" );
+            return false;
+        }
+    }
+
+    // two allpass taps read a frame at a time at different delays
+    // match two lines with one tap each
+    DelayLine<float> two( pools, channels, 100, block, 2 );
+    DelayLine<float> one_a( pools, channels, 100, block );
+    DelayLine<float> one_b( pools, channels, 100, block );
+    for ( size_t i = 0; i < 200; ++i )
+    {
+        float frame[channels], a[channels], b[channels];
+        float two_a[channels], two_b[channels];
+        for ( size_t c = 0; c < channels; ++c )
+        {
+            frame[c] = float( std::sin( i * ( 0.05 + 0.01 * c ) ) );
+        }
+        two.writeFrame( frame );
+        one_a.writeFrame( frame );
+        one_b.writeFrame( frame );
+        double da = 10.3 + 2.0 * std::sin( i * 0.01 );
+        double db = 31.7 - 3.0 * std::sin( i * 0.02 );
+        two.readFrame( two_a, da, delay_allpass, 0 );
+        two.readFrame( two_b, db, delay_allpass, 1 );
+        one_a.readFrame( a, da, delay_allpass );
+        one_b.readFrame( b, db, delay_allpass );
+        for ( size_t c = 0; c < channels; ++c )
+        {
+            if ( two_a[c] != a[c] || two_b[c] != b[c] )
+            {
+                ob_log_error( "delay line allpass taps interfere at ",
+                              i );
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool test_dsp_noise()
+{
+    size_t const count = 1 << 18;
+    NoiseGenerator generator( 1234 );
+    std::vector<float> a( count ), b( count );
+
+    // uniform in [-1, 1) with variance 1/3, triangular with 1/6
+    generator.white( &a[0], count );
+    generator.tpdf( &b[0], count );
+    double mean_a = 0, var_a = 0, mean_b = 0, var_b = 0, cross = 0;
+    for ( size_t i = 0; i < count; ++i )
+    {
+        if ( a[i] < -1.0f || a[i] >= 1.0f || b[i] <= -1.0f
+             || b[i] >= 1.0f )
+        {
+            ob_log_error( "noise out of range at ", i );
+            return false;
+        }
+        mean_a += a[i];
+        var_a += a[i] * a[i];
+        mean_b += b[i];
+        var_b += b[i] * b[i];
+        // neighbouring lanes of the same step
+        if ( i % NoiseGenerator::lanes != 0 )
+        {
+            cross += a[i] * a[i - 1];
+        }
+    }
+    mean_a /= count;
+    var_a /= count;
+    mean_b /= count;
+    var_b /= count;
+    cross /= count;
+    if ( std::abs( mean_a ) > 0.01 || std::abs( var_a - 1.0 / 3 ) > 0.01
+         || std::abs( mean_b ) > 0.01
+         || std::abs( var_b - 1.0 / 6 ) > 0.01
+         || std::abs( cross ) > 0.01 )
+    {
+        ob_log_error( "noise statistics: white ", mean_a, " ", var_a,
+                      " tpdf ", mean_b, " ", var_b, " lanes ", cross );
+        return false;
+    }
+
+    // pink falls 3 dB per octave: 4 times the frequency, a quarter of
+    // the power, averaged over many transforms
+    size_t const n = 1024;
+    PluginChain<Noise<float>, float, 1> chain;
+    chain[0].m_coeffs.m_type = noise_pink;
+    chain[0].m_coeffs.setAmplitude( 1.0f, 0 );
+    RealFFTPlan<float> plan( n );
+    std::vector<float> frame( n, 0.0f ), re( n ), im( n );
+    std::vector<double> power( n / 2 + 1, 0.0 );
+    for ( size_t t = 0; t < 256; ++t )
+    {
+        std::fill( frame.begin(), frame.end(), 0.0f );
+        chain.processInPlace( &frame[0], n );
+        plan.forward( &frame[0], &re[0], &im[0] );
+        for ( size_t k = 0; k <= n / 2; ++k )
+        {
+            power[k] += re[k] * re[k] + im[k] * im[k];
+        }
+    }
+    double low = 0, high = 0;
+    for ( size_t k = 16; k < 32; ++k )
+    {
+        low += power[k];
+        high += power[k * 4];
+    }
+    double ratio = low / high;
+    if ( ratio < 3.0 || ratio > 5.5 )
+    {
+        ob_log_error( "pink noise power ratio over two octaves ",
+                      ratio );
+        return false;
+    }
+
+    // separately made plugins are uncorrelated, and reset() repeats
+    Noise<float> left, right;
+    left.m_coeffs.setAmplitude( 1.0f, 0 );
+    right.m_coeffs.setAmplitude( 1.0f, 0 );
+    left.process( &a[0], count );
+    right.process( &b[0], count );
+    double pair = 0;
+    for ( size_t i = 0; i < count; ++i )
+    {
+        pair += a[i] * b[i];
+    }
+    left.m_state.reset();
+    left.process( &b[0], 1000 );
+    if ( std::abs( pair / count ) > 0.01
+         || !std::equal( b.begin(), b.begin() + 1000, a.begin() ) )
+    {
+        ob_log_error( "noise plugins correlate by ", pair / count );
+        return false;
+    }
+
+    // dithered 16 bit conversion is within 1.5 bits, unbiased, and
+    // keeps a sine smaller than one bit
+    std::vector<int16_t> pcm( count );
+    for ( size_t i = 0; i < count; ++i )
+    {
+        a[i] = float( 0.4 * std::sin( i * 0.01 )
+                      + 0.4 / 32768.0 * std::sin( i * 0.3 ) );
+    }
+    dither_to_int16( &a[0], &pcm[0], count, generator );
+    double error_mean = 0, small = 0;
+    for ( size_t i = 0; i < count; ++i )
+    {
+        double error = pcm[i] - a[i] * 32768.0;
+        if ( std::abs( error ) > 1.5 )
+        {
+            ob_log_error( "dither error ", error, " at ", i );
+            return false;
+        }
+        error_mean += error;
+        small += ( pcm[i] - 0.4 * 32768.0 * std::sin( i * 0.01 ) )
+                 * std::sin( i * 0.3 );
+    }
+    error_mean /= count;
+    small = small * 2.0 / count;
+    if ( std::abs( error_mean ) > 0.01
+         || std::abs( small - 0.4 ) > 0.05 )
+    {
+        ob_log_error( "dither mean error ", error_mean,
+                      " sub bit sine amplitude ", small );
+        return false;
+    }
+
+    // 24 bit packing, with full scale clipped
+    float const edges[] = {1.0f, -1.0f, 0.5f};
+    int32_t const expected[] = {8388607, -8388608, 4194304};
+    uint8_t packed[9];
+    dither_to_int24( edges, packed, 3, generator );
+    for ( size_t i = 0; i < 3; ++i )
+    {
+        int32_t v = int32_t( uint32_t( packed[i * 3] ) << 8
+                             | uint32_t( packed[i * 3 + 1] ) << 16
+                             | uint32_t( packed[i * 3 + 2] ) << 24 )
+                    >> 8;
+        if ( std::abs( v - expected[i] ) > 1 )
+        {
+            ob_log_error( "dither 24 bit sample ", i, " is ", v );
+            return false;
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for ( size_t t = 0; t < 16; ++t )
+    {
+        generator.white( &a[0], count );
+    }
+    double seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start )
+                         .count();
+    volatile float sink = a[count / 2];
+    (void)sink;
+    ob_log_info( "white noise: ", 16.0 * count / seconds / 1e9,
+                 " gigasamples per second" );
+    return true;
+}
+
+bool test_dsp_goertzel_bank()
+{
+    // every note of seven octaves at 48 kHz, in blocks of 100 ms
+    double const sample_rate = 48000.0;
+    size_t const block = 4800;
+    size_t const detectors = 7 * 12;
+    GoertzelBank<float> bank( detectors, block );
+    for ( size_t d = 0; d < detectors; ++d )
+    {
+        bank.setFrequencyNote(
+            d, 1.0 / sample_rate, int( d / 12 ), int( d % 12 ) );
+    }
+
+    // two notes and some noise, against a direct transform
+    size_t const blocks = 3;
+    std::vector<float> in( block * blocks );
+    NoiseGenerator generator( 7 );
+    generator.white( &in[0], in.size() );
+    for ( size_t i = 0; i < in.size(); ++i )
+    {
+        double t = double( i ) / sample_rate;
+        in[i] = float( 0.5 * std::sin( OBBLIGATO_TWO_PI * 440.0 * t )
+                       + 0.25 * std::sin( OBBLIGATO_TWO_PI * 1568.0 * t
+                                          + 1.0 )
+                       + 0.01 * in[i] );
+    }
+
+    // fed in uneven pieces, reported per block
+    std::vector<float> magnitudes( detectors * blocks );
+    size_t done = 0;
+    for ( size_t pos = 0; pos < in.size(); pos += 1000 )
+    {
+        size_t n = in.size() - pos < 1000 ? in.size() - pos : 1000;
+        done += bank.process(
+            &in[pos], n, &magnitudes[done * detectors] );
+    }
+    if ( done != blocks )
+    {
+        ob_log_error( "goertzel reported ", done, " blocks" );
+        return false;
+    }
+
+    for ( size_t b = 0; b < blocks; ++b )
+    {
+        for ( size_t d = 0; d < detectors; ++d )
+        {
+            double freq = oscillator_note_frequencies_a440[d % 12]
+                          * oscillator_octave_multiplier_table[d / 12];
+            double w = OBBLIGATO_TWO_PI * freq / sample_rate;
+            std::complex<double> sum( 0.0, 0.0 );
+            for ( size_t i = 0; i < block; ++i )
+            {
+                sum += double( in[b * block + i] )
+                       * std::polar( 1.0, -w * double( i ) );
+            }
+            double expected = std::abs( sum ) * 2.0 / double( block );
+            double got = magnitudes[b * detectors + d];
+            if ( std::abs( got - expected ) > 2e-3 )
+            {
+                ob_log_error( "goertzel block ", b, " detector ", d,
+                              " is ", got, " not ", expected );
+                return false;
+            }
+        }
+    }
+
+    // A440 and the G two octaves above are found at their amplitudes
+    if ( std::abs( bank.magnitude( 3 * 12 ) - 0.5 ) > 0.01
+         || std::abs( bank.magnitude( 4 * 12 + 10 ) - 0.25 ) > 0.01 )
+    {
+        ob_log_error( "goertzel tones read ", bank.magnitude( 36 ),
+                      " and ", bank.magnitude( 58 ) );
+        return false;
+    }
+
+    // a frequency changed part way through a block applies from the
+    // next one
+    bank.reset();
+    bank.process( &in[0], block / 2 );
+    bank.setFrequency( 3 * 12, 1.0 / sample_rate, 1000.0 );
+    bank.process( &in[block / 2], block - block / 2 );
+    float const before = bank.magnitude( 3 * 12 );
+    bank.process( &in[block], block );
+    if ( std::abs( before - 0.5 ) > 0.01
+         || bank.magnitude( 3 * 12 ) > 0.01 )
+    {
+        ob_log_error( "goertzel retuned detector read ", before,
+                      " and ", bank.magnitude( 3 * 12 ) );
+        return false;
+    }
+
+    bool threw = false;
+    try
+    {
+        bank.setFrequency( detectors, 1.0 / sample_rate, 440.0 );
+    }
+    catch ( std::out_of_range const & )
+    {
+        threw = true;
+    }
+    if ( !threw )
+    {
+        ob_log_error( "goertzel padding detector did not throw" );
+        return false;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    size_t const seconds_of_audio = 10;
+    for ( size_t t = 0; t < seconds_of_audio * 10 / blocks; ++t )
+    {
+        bank.process( &in[0], in.size() );
+    }
+    double seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start )
+                         .count();
+    volatile float sink = bank.magnitude( 0 );
+    (void)sink;
+    ob_log_info( "goertzel bank of ", detectors, " detectors: ",
+                 seconds / seconds_of_audio,
+                 " s per second of audio" );
+    return true;
+}
+
+/// Feed a sine to analyzer from another thread, as an audio thread
+/// would
+void test_dsp_spectrum_writer( SpectrumAnalyzer<float> *analyzer,
+                               std::atomic<bool> *done )
+{
+    std::vector<float> block( 256 );
+    for ( size_t b = 0; b < 2000; ++b )
+    {
+        for ( size_t i = 0; i < block.size(); ++i )
+        {
+            double t = double( b * block.size() + i );
+            block[i] = float(
+                0.5 * std::sin( OBBLIGATO_TWO_PI / 16.0 * t ) );
+        }
+        analyzer->process( &block[0], block.size() );
+    }
+    *done = true;
+}
+
+bool test_dsp_spectrum_analyzer()
+{
+    size_t const n = 1024;
+
+    // a sine centred on bin 64 reads its amplitude there, with nothing
+    // away from its neighbours
+    SpectrumAnalyzer<float> hann( n, n / 4, spectrum_hann );
+    std::vector<float> in( n * 10 + 300 );
+    for ( size_t i = 0; i < in.size(); ++i )
+    {
+        in[i] = float( 0.5
+                       * std::sin( OBBLIGATO_TWO_PI * 64.0 / n
+                                   * double( i ) ) );
+    }
+    for ( size_t pos = 0; pos < in.size(); pos += 1000 )
+    {
+        size_t frames = in.size() - pos < 1000 ? in.size() - pos : 1000;
+        hann.process( &in[pos], frames );
+    }
+    if ( !hann.update() || hann.update() )
+    {
+        ob_log_error( "spectrum analyzer did not publish once" );
+        return false;
+    }
+    SpectrumAnalyzer<float>::Spectrum const &s = hann.front();
+    if ( s.m_index != in.size() / ( n / 4 )
+         || s.m_frame != s.m_index * ( n / 4 )
+         || s.m_magnitude.size() != hann.bins() )
+    {
+        ob_log_error( "spectrum analysis ", s.m_index, " at frame ",
+                      s.m_frame );
+        return false;
+    }
+    for ( size_t k = 0; k < hann.bins(); ++k )
+    {
+        double expected = k == 64 ? 0.5 : k == 63 || k == 65 ? 0.25 : 0;
+        if ( std::abs( s.m_magnitude[k] - expected ) > 1e-4 )
+        {
+            ob_log_error( "hann spectrum bin ", k, " is ",
+                          s.m_magnitude[k] );
+            return false;
+        }
+    }
+
+    // between bins, blackman-harris keeps the leakage 90 dB down
+    SpectrumAnalyzer<float> bh( n, n, spectrum_blackman_harris );
+    for ( size_t i = 0; i < n; ++i )
+    {
+        in[i] = float( 0.5
+                       * std::sin( OBBLIGATO_TWO_PI * 100.5 / n
+                                   * double( i ) ) );
+    }
+    bh.process( &in[0], n );
+    bh.update();
+    float peak = bh.front().m_magnitude[100];
+    if ( peak < 0.5f * 0.9f || peak > 0.5f )
+    {
+        ob_log_error( "blackman-harris peak ", peak );
+        return false;
+    }
+    for ( size_t k = 0; k < bh.bins(); ++k )
+    {
+        if ( ( k < 96 || k > 105 )
+             && bh.front().m_magnitude[k] > 0.5f * 3.2e-5f )
+        {
+            ob_log_error( "blackman-harris leakage at bin ", k, " ",
+                          bh.front().m_magnitude[k] );
+            return false;
+        }
+    }
+
+    // a reader thread always sees whole spectra, in order
+    SpectrumAnalyzer<float> shared( n, n / 4 );
+    std::atomic<bool> done( false );
+    std::thread writer( test_dsp_spectrum_writer, &shared, &done );
+    size_t updates = 0, torn = 0;
+    uint64_t last = 0;
+    bool backwards = false;
+    for ( ;; )
+    {
+        bool finished = done;
+        if ( shared.update() )
+        {
+            SpectrumAnalyzer<float>::Spectrum const &r = shared.front();
+            ++updates;
+            backwards |= r.m_index < last;
+            last = r.m_index;
+            // once the window is full the sine is steady
+            if ( r.m_frame >= n
+                 && std::abs( r.m_magnitude[64] - 0.5f ) > 1e-3f )
+            {
+                ++torn;
+            }
+        }
+        else if ( finished )
+        {
+            break;
+        }
+    }
+    writer.join();
+    if ( torn || backwards || last != 2000 * 256 / ( n / 4 ) )
+    {
+        ob_log_error( "spectrum reader: ", updates, " updates, ", torn,
+                      " torn, last ", last );
+        return false;
+    }
+
+    // the cost follows the hop, not the block size
+    std::vector<float> noise( 48000 );
+    NoiseGenerator generator;
+    generator.white( &noise[0], noise.size() );
+    double times[2];
+    size_t const hops[2] = {256, 1024};
+    for ( size_t h = 0; h < 2; ++h )
+    {
+        SpectrumAnalyzer<float> analyzer( 2048, hops[h] );
+        auto start = std::chrono::steady_clock::now();
+        for ( size_t t = 0; t < 10; ++t )
+        {
+            for ( size_t pos = 0; pos < noise.size(); pos += 64 )
+            {
+                analyzer.process( &noise[pos], 64 );
+            }
+        }
+        times[h] = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start )
+                       .count()
+                   / 10.0;
+        analyzer.update();
+        volatile float sink = analyzer.front().m_magnitude[1];
+        (void)sink;
+    }
+    ob_log_info( "spectrum analyzer 2048 points: hop 256: ", times[0],
+                 " s, hop 1024: ", times[1], " s per second of audio" );
+    return true;
+}
+
+/// Run samples of input through chain, returning the time taken and
+/// counting the outputs that were denormal
+template <typename ChainType>
+double test_dsp_denormals_run( ChainType &chain,
+                               float input,
+                               size_t samples,
+                               size_t &subnormals )
+{
+    // the volatile store keeps the loop between the two clock reads
+    volatile float sink = 0.0f;
+    std::chrono::steady_clock::time_point start
+        = std::chrono::steady_clock::now();
+    for ( size_t i = 0; i < samples; ++i )
+    {
+        float y = chain( input );
+        sink = y;
+        if ( std::fpclassify( y ) == FP_SUBNORMAL )
+        {
+            ++subnormals;
+        }
+    }
+    (void)sink;
+    return std::chrono::duration<double>(
+               std::chrono::steady_clock::now() - start ).count();
+}
+
+bool test_dsp_denormals()
+{
+    typedef PluginChain<Biquad<float>, float, 4> ChainType;
+    size_t const decay_samples = 25000;
+    size_t const tail_samples = 100000;
+    ChainType normal, plain, guarded;
+
+    for ( size_t i = 0; i < normal.size(); ++i )
+    {
+        normal[i].m_coeffs.calculateLowpass( 0, 96000.0, 100.0, 0.7 );
+        plain[i].m_coeffs.calculateLowpass( 0, 96000.0, 100.0, 0.7 );
+        guarded[i].m_coeffs.calculateLowpass( 0, 96000.0, 100.0, 0.7 );
+    }
+
+    // a constant input keeps every value in the normal range
+    size_t normal_subnormals = 0;
+    test_dsp_denormals_run(
+        normal, 1.0f, decay_samples, normal_subnormals );
+    double normal_time = test_dsp_denormals_run(
+        normal, 1.0f, tail_samples, normal_subnormals );
+
+    // an impulse followed by silence decays into denormals
+    size_t plain_subnormals = 0;
+    plain( 1.0f );
+    test_dsp_denormals_run(
+        plain, 0.0f, decay_samples, plain_subnormals );
+    double plain_time = test_dsp_denormals_run(
+        plain, 0.0f, tail_samples, plain_subnormals );
+
+    size_t guarded_subnormals = 0;
+    double guarded_time = 0.0;
+    {
+        DenormalGuard guard;
+        guarded( 1.0f );
+        test_dsp_denormals_run(
+            guarded, 0.0f, decay_samples, guarded_subnormals );
+        guarded_time = test_dsp_denormals_run(
+            guarded, 0.0f, tail_samples, guarded_subnormals );
+    }
+
+    ob_log_info( "normal range: ", normal_time, " s" );
+    ob_log_info( "silent tail: ",
+                 plain_time,
+                 " s with ",
+                 plain_subnormals,
+                 " denormal outputs" );
+    ob_log_info( "silent tail with DenormalGuard: ",
+                 guarded_time,
+                 " s with ",
+                 guarded_subnormals,
+                 " denormal outputs" );
+
+    // the block entry point flushes on its own
+    SIMD_Vector<float, 64> block;
+    zero( block );
+    for ( size_t i = 0; i < 100; ++i )
+    {
+        block = plain( block );
+        for ( size_t s = 0; s < block.size(); ++s )
+        {
+            if ( DenormalGuard::isSupported()
+                 && std::fpclassify( block[s] ) == FP_SUBNORMAL )
+            {
+                ob_log_error( "denormal in block output" );
+                return false;
+            }
+        }
+    }
+
+    if ( !DenormalGuard::isSupported() )
+    {
+        return true;
+    }
+    return !DenormalGuard::isActive() && guarded_subnormals == 0
+           && guarded_time < normal_time * 2.0 + 0.001;
+}
+
+template <typename ChainType>
+bool test_dsp_process_one( ChainType chain, char const *name )
+{
+    typedef typename ChainType::value_type T;
+    typedef typename simd_flattened_type<T>::type item_type;
+    size_t const frames = 1000;
+    ChainType reference = chain;
+
+    std::vector<T> input( frames );
+    std::vector<T> expected( frames );
+    std::vector<T> output( frames );
+    for ( size_t i = 0; i < frames; ++i )
+    {
+        splat( input[i], item_type( ( i * 7919 ) % 101 ) / 50 - 1 );
+        expected[i] = reference( input[i] );
+    }
+
+    // the first half out of place and the second half in place
+    chain.process( input.data(), output.data(), frames / 2 );
+    std::copy( input.begin() + frames / 2,
+               input.end(),
+               output.begin() + frames / 2 );
+    chain.processInPlace( output.data() + frames / 2, frames / 2 );
+
+    for ( size_t i = 0; i < frames; ++i )
+    {
+        for ( size_t c = 0; c < simd_flattened_size<T>::value; ++c )
+        {
+            item_type a = get_flattened_item( expected[i], c );
+            item_type b = get_flattened_item( output[i], c );
+            if ( std::abs( a - b ) > 1e-5 * ( 1 + std::abs( a ) ) )
+            {
+                ob_log_error( name, " process mismatch at frame ", i );
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+template <typename T>
+bool test_dsp_process_plugins( char const *name )
+{
+    PluginChain<Biquad<T>, T, 3> biquads;
+    PluginChain<Gain<T>, T, 2> gains;
+    PluginChain<Oscillator<T>, T, 2> oscillators;
+
+    for ( size_t i = 0; i < simd_flattened_size<T>::value; ++i )
+    {
+        biquads[0].m_coeffs.calculateLowpass(
+            i, 96000.0, 1000.0 * ( i + 1 ), 0.7 );
+        biquads[1].m_coeffs.calculatePeak(
+            i, 96000.0, 3000.0, 0.7, 6.0 );
+        biquads[2].m_coeffs.calculateHighpass( i, 96000.0, 20.0, 0.7 );
+        gains[0].m_coeffs.setAmplitude( 0.5f, i );
+        gains[1].m_coeffs.setTimeConstant( 96000.0, 0.001, i );
+        gains[1].m_coeffs.setAmplitude( 2.0f, i );
+    }
+    for ( size_t i = 0; i < simd_size<T>::value; ++i )
+    {
+        oscillators[0].m_coeffs.setAmplitude( 0.25f, i );
+        oscillators[0].m_state.setFrequency(
+            1.0 / 96000.0, 440.0 * ( i + 1 ), 0.0, i );
+        oscillators[1].m_coeffs.setAmplitude( 0.5f, i );
+        oscillators[1].m_state.setFrequency(
+            1.0 / 96000.0, 1000.0, 0.0, i );
+    }
+
+    return test_dsp_process_one( biquads, name )
+           && test_dsp_process_one( gains, name )
+           && test_dsp_process_one( oscillators, name );
+}
+
+bool test_dsp_process()
+{
+    if ( !test_dsp_process_plugins<float>( "float" )
+         || !test_dsp_process_plugins<double>( "double" )
+         || !test_dsp_process_plugins<vec4float>( "vec4float" ) )
+    {
+        return false;
+    }
+
+    // a block of another sample type still goes through each plugin
+    // a lane at a time
+    PluginChain<Gain<double>, double, 2> gains, reference;
+    for ( size_t i = 0; i < gains.size(); ++i )
+    {
+        gains[i].m_coeffs.setAmplitude( 0.5, 0 );
+        reference[i].m_coeffs.setAmplitude( 0.5, 0 );
+    }
+    SIMD_Vector<float, 4> x, y;
+    splat( x, 1.0f );
+    y = gains( x );
+    for ( size_t s = 0; s < 4; ++s )
+    {
+        if ( std::fabs( y[s] - float( reference( double( x[s] ) ) ) )
+             > 1e-6f )
+        {
+            ob_log_error( "converted block mismatch at lane ", s );
+            return false;
+        }
+    }
+
+    // compare the throughput of the per sample and the block api
+    typedef PluginChain<Biquad<float>, float, 4> ChainType;
+    size_t const frames = 1 << 18;
+    ChainType per_sample, block;
+    for ( size_t i = 0; i < per_sample.size(); ++i )
+    {
+        per_sample[i].m_coeffs.calculatePeak(
+            0, 96000.0, 1000.0 * ( i + 1 ), 0.7, 3.0 );
+        block[i] = per_sample[i];
+    }
+    std::vector<float> buf( frames, 0.25f );
+
+    // the fastest of several runs of each, so that a busy machine does
+    // not skew the logged timings
+    double per_sample_time = 0, block_time = 0;
+    for ( size_t run = 0; run < 5; ++run )
+    {
+        std::chrono::steady_clock::time_point start
+            = std::chrono::steady_clock::now();
+        for ( size_t i = 0; i < frames; ++i )
+        {
+            buf[i] = per_sample( buf[i] );
+        }
+        std::chrono::steady_clock::time_point middle
+            = std::chrono::steady_clock::now();
+        block.processInPlace( buf.data(), frames );
+        std::chrono::steady_clock::time_point end
+            = std::chrono::steady_clock::now();
+
+        double t1
+            = std::chrono::duration<double>( middle - start ).count();
+        double t2
+            = std::chrono::duration<double>( end - middle ).count();
+        per_sample_time
+            = run == 0 ? t1 : std::min( per_sample_time, t1 );
+        block_time = run == 0 ? t2 : std::min( block_time, t2 );
+    }
+    ob_log_info( "4 biquads per sample: ",
+                 per_sample_time,
+                 " s, process(): ",
+                 block_time,
+                 " s" );
+    return true;
+}
+
+bool test_dsp_static_chain()
+{
+    typedef StaticChain<Gain<float>,
+                        Biquad<float>,
+                        Biquad<float>,
+                        Oscillator<float> > ChainType;
+    ChainType chain;
+    Gain<float> gain;
+    Biquad<float> lowpass, peak;
+    Oscillator<float> oscillator;
+
+    gain.m_coeffs.setAmplitude( 0.5f, 0 );
+    lowpass.m_coeffs.calculateLowpass( 0, 96000.0, 2000.0, 0.7 );
+    peak.m_coeffs.calculatePeak( 0, 96000.0, 500.0, 1.0, 6.0 );
+    oscillator.m_coeffs.setAmplitude( 0.25f, 0 );
+    oscillator.m_state.setFrequency( 1.0 / 96000.0, 440.0, 0.0, 0 );
+
+    chain.get<0>() = gain;
+    chain.get<1>() = lowpass;
+    chain.get<2>() = peak;
+    chain.get<3>() = oscillator;
+    ob_log_info( title_fmt( "static_chain" ), chain );
+
+    std::vector<float> buf( 1000 );
+    for ( size_t i = 0; i < buf.size(); ++i )
+    {
+        buf[i] = float( ( i * 7919 ) % 101 ) / 50.0f - 1.0f;
+    }
+    std::vector<float> expected( buf );
+    for ( size_t i = 0; i < expected.size(); ++i )
+    {
+        float x = lowpass( gain( expected[i] ) );
+        expected[i] = oscillator( peak( x ) );
+    }
+
+    chain.processInPlace( buf.data(), buf.size() );
+    for ( size_t i = 0; i < buf.size(); ++i )
+    {
+        if ( std::abs( buf[i] - expected[i] ) > 1e-5f )
+        {
+            ob_log_error( "static chain mismatch at ", i );
+            return false;
+        }
+    }
+
+    // the response of the chain is the product of its plugins
+    std::complex<float> z = std::polar( 1.0f, 0.1f );
+    std::complex<float> response = chain.processZDomain( 0, z );
+    std::complex<float> product
+        = gain.m_coeffs.processZDomain( 0, z )
+          * lowpass.m_coeffs.processZDomain( 0, z )
+          * peak.m_coeffs.processZDomain( 0, z );
+    return std::abs( response - product ) < 1e-5f;
+}
+
+/// Process frames samples of 1.0 through chain and return the largest
+/// step between consecutive output samples
+template <typename ChainType>
+float test_dsp_dynamic_chain_steps( ChainType &chain,
+                                    std::vector<float> &buf,
+                                    float &previous )
+{
+    float largest = 0.0f;
+    std::fill( buf.begin(), buf.end(), 1.0f );
+    chain.processInPlace( buf.data(), buf.size() );
+    for ( size_t i = 0; i < buf.size(); ++i )
+    {
+        largest = std::max( largest, std::abs( buf[i] - previous ) );
+        previous = buf[i];
+    }
+    return largest;
+}
+
+bool test_dsp_dynamic_chain()
+{
+    Pools pools( "dynamic_chain", malloc, free );
+    pools.add( 256, 32 );
+    pools.add( 4096, 4 );
+
+    PluginChain<Biquad<float>, float, 4> reference;
+    DynamicChain<float> chain( pools, 8, 256, 64 );
+    for ( size_t i = 0; i < reference.size(); ++i )
+    {
+        reference[i].m_coeffs.calculatePeak(
+            0, 96000.0, 1000.0 * ( i + 1 ), 0.7, 3.0 );
+        chain.pushBack( reference[i] );
+    }
+
+    // silence while the nodes fade in leaves their state untouched
+    std::vector<float> buf( 1000, 0.0f );
+    chain.processInPlace( buf.data(), 64 );
+
+    std::vector<float> expected( buf.size() );
+    for ( size_t i = 0; i < buf.size(); ++i )
+    {
+        buf[i] = float( ( i * 7919 ) % 101 ) / 50.0f - 1.0f;
+    }
+    reference.process( buf.data(), expected.data(), buf.size() );
+    chain.processInPlace( buf.data(), buf.size() );
+    for ( size_t i = 0; i < buf.size(); ++i )
+    {
+        if ( std::abs( buf[i] - expected[i] ) > 1e-5f )
+        {
+            ob_log_error( "dynamic chain mismatch at ", i );
+            return false;
+        }
+    }
+    ob_log_info( title_fmt( "dynamic_chain" ), chain );
+
+    // inserting, bypassing and removing crossfade without steps
+    Gain<float> half;
+    half.m_coeffs.setAmplitude( 0.5f, 0 );
+    half.m_state.m_current_amplitude = 0.5f;
+
+    DynamicChain<float> dc( pools, 4, 256, 64 );
+    std::vector<float> ones( 256 );
+    float previous = 1.0f;
+    float largest = 0.0f;
+
+    dc.pushBack( half );
+    largest = std::max(
+        largest, test_dsp_dynamic_chain_steps( dc, ones, previous ) );
+    bool faded_in = previous == 0.5f;
+    dc.setBypass( 0, true );
+    largest = std::max(
+        largest, test_dsp_dynamic_chain_steps( dc, ones, previous ) );
+    bool bypassed = previous == 1.0f && dc.isBypassed( 0 );
+    dc.setBypass( 0, false );
+    test_dsp_dynamic_chain_steps( dc, ones, previous );
+    dc.remove( 0 );
+    largest = std::max(
+        largest, test_dsp_dynamic_chain_steps( dc, ones, previous ) );
+    bool removed = previous == 1.0f && dc.size() == 0;
+
+    ob_log_info( "largest step while changing the chain: ", largest );
+    if ( !faded_in || !bypassed || !removed || largest > 0.01f )
+    {
+        return false;
+    }
+
+    // compare the throughput with PluginChain at 64 frame blocks
+    size_t const frames = 1 << 16;
+    size_t const block = 64;
+    std::vector<float> audio( frames, 0.25f );
+    std::chrono::steady_clock::time_point start
+        = std::chrono::steady_clock::now();
+    for ( size_t pos = 0; pos < frames; pos += block )
+    {
+        reference.processInPlace( audio.data() + pos, block );
+    }
+    std::chrono::steady_clock::time_point middle
+        = std::chrono::steady_clock::now();
+    for ( size_t pos = 0; pos < frames; pos += block )
+    {
+        chain.processInPlace( audio.data() + pos, block );
+    }
+    std::chrono::steady_clock::time_point end
+        = std::chrono::steady_clock::now();
+
+    double static_time
+        = std::chrono::duration<double>( middle - start ).count();
+    double dynamic_time
+        = std::chrono::duration<double>( end - middle ).count();
+    ob_log_info( "4 biquads at 64 frames, PluginChain: ",
+                 static_time,
+                 " s, DynamicChain: ",
+                 dynamic_time,
+                 " s" );
+    return true;
+}
+
+/// Two values that must always be read as a pair
+struct TestAutomationPair
+{
+    double m_value;
+    double m_negated;
+};
+
+/// Publish 200000 pairs, letting the reader run now and then
+void test_dsp_automated_writer(
+    Atomic::TripleBuffer<TestAutomationPair> *pairs,
+    std::atomic<bool> *done )
+{
+    for ( int i = 1; i <= 200000; ++i )
+    {
+        pairs->back().m_value = i;
+        pairs->back().m_negated = -i;
+        pairs->publish();
+        if ( i % 1000 == 0 )
+        {
+            std::this_thread::yield();
+        }
+    }
+    *done = true;
+}
+
+bool test_dsp_automated()
+{
+    // a reader never sees a value while it is being written
+    Atomic::TripleBuffer<TestAutomationPair> pairs;
+    std::atomic<bool> done( false );
+    std::thread writer( test_dsp_automated_writer, &pairs, &done );
+    size_t updates = 0;
+    size_t torn = 0;
+    double last = 0;
+    bool backwards = false;
+    for ( ;; )
+    {
+        bool finished = done;
+        if ( pairs.update() )
+        {
+            ++updates;
+            TestAutomationPair const &p = pairs.front();
+            torn += p.m_value != -p.m_negated;
+            backwards |= p.m_value < last;
+            last = p.m_value;
+        }
+        else if ( finished )
+        {
+            break;
+        }
+    }
+    writer.join();
+    ob_log_info( "triple buffer: ",
+                 updates,
+                 " updates, ",
+                 torn,
+                 " torn, last ",
+                 last );
+    if ( torn || backwards || last != 200000 )
+    {
+        return false;
+    }
+
+    // a gain change ramps linearly across the next block
+    size_t const frames = 64;
+    Gain<float> gain;
+    gain.m_coeffs.setTimeConstant( 1.0, 1.0, 0 );
+    Automated<Gain<float> > automated( gain );
+    std::vector<float> ones( frames, 1.0f );
+    std::vector<float> out( frames );
+
+    Gain<float>::Coeffs loud( gain.m_coeffs );
+    loud.setAmplitude( 1.0f, 0 );
+    automated.setCoeffs( loud );
+    automated.process( ones.data(), out.data(), frames );
+    for ( size_t i = 0; i < frames; ++i )
+    {
+        float expected = float( i + 1 ) / float( frames );
+        if ( std::abs( out[i] - expected ) > 1e-5f )
+        {
+            ob_log_error( "gain ramp differs at ", i );
+            return false;
+        }
+    }
+
+    // a biquad ramps to its new coefficients and then keeps them
+    Biquad<float> reference;
+    reference.m_coeffs.calculateLowpass( 0, 48000.0, 1000.0, 0.7 );
+    Automated<Biquad<float> > eq( reference );
+    Biquad<float>::Coeffs bright;
+    bright.calculatePeak( 0, 48000.0, 5000.0, 1.0, 6.0 );
+    eq.setCoeffs( bright );
+
+    std::vector<float> audio( frames * 2 );
+    for ( size_t i = 0; i < audio.size(); ++i )
+    {
+        audio[i] = float( ( i * 7919 ) % 101 ) / 50.0f - 1.0f;
+    }
+    std::vector<float> expected( audio );
+    reference.processRamped(
+        expected.data(), expected.data(), frames, bright );
+    reference.processInPlace( expected.data() + frames, frames );
+    eq.processInPlace( audio.data(), frames );
+    eq.processInPlace( audio.data() + frames, frames );
+    for ( size_t i = 0; i < audio.size(); ++i )
+    {
+        if ( audio[i] != expected[i] )
+        {
+            ob_log_error( "automated biquad differs at ", i );
+            return false;
+        }
+    }
+    return eq.m_plugin.m_coeffs.m_a0 == bright.m_a0;
+}
+
+/// Sums the channel buffers of test_dsp_graph_scheduler into a bus
+class TestMixTask : public GraphTask
+{
+  public:
+    std::vector<std::vector<float> > const *m_channels;
+    std::vector<float> *m_bus;
+
+    virtual void run() override
+    {
+        std::fill( m_bus->begin(), m_bus->end(), 0.0f );
+        for ( size_t c = 0; c < m_channels->size(); ++c )
+        {
+            std::vector<float> const &channel = ( *m_channels )[c];
+            for ( size_t i = 0; i < m_bus->size(); ++i )
+            {
+                ( *m_bus )[i] += channel[i];
+            }
+        }
+    }
+};
+
+/// Run blocks of a 128 channel console, each channel an equalizer
+/// followed by a fader, and a mix bus after all of the faders
+bool test_dsp_graph_scheduler_run( size_t num_workers,
+                                   size_t blocks,
+                                   std::vector<float> &bus,
+                                   double &block_time )
+{
+    size_t const channels = 128;
+    size_t const frames = 256;
+    typedef PluginChain<Biquad<float>, float, 4> EqType;
+
+    std::vector<PluginTask<EqType> > eqs( channels );
+    std::vector<PluginTask<Gain<float> > > faders( channels );
+    std::vector<std::vector<float> > inputs( channels );
+    std::vector<std::vector<float> > outputs( channels );
+    TestMixTask mix;
+    bus.assign( frames, 0.0f );
+    mix.m_channels = &outputs;
+    mix.m_bus = &bus;
+
+    GraphScheduler scheduler( num_workers );
+    size_t mix_node = scheduler.addTask( &mix );
+    for ( size_t c = 0; c < channels; ++c )
+    {
+        inputs[c].resize( frames );
+        outputs[c].resize( frames );
+        for ( size_t i = 0; i < frames; ++i )
+        {
+            inputs[c][i] = float( ( i * 7919 + c * 104729 ) % 101 )
+                           / 50.0f - 1.0f;
+        }
+        for ( size_t i = 0; i < eqs[c].m_plugin.size(); ++i )
+        {
+            eqs[c].m_plugin[i].m_coeffs.calculatePeak(
+                0, 48000.0, 200.0 * ( i + 1 ) + c, 0.7, 3.0 );
+        }
+        float amplitude = 1.0f / float( c + 1 );
+        faders[c].m_plugin.m_coeffs.setAmplitude( amplitude, 0 );
+        faders[c].m_plugin.m_state.m_current_amplitude = amplitude;
+
+        eqs[c].setBuffers(
+            inputs[c].data(), outputs[c].data(), frames );
+        faders[c].setBuffers(
+            outputs[c].data(), outputs[c].data(), frames );
+
+        size_t eq_node = scheduler.addTask( &eqs[c] );
+        size_t fader_node = scheduler.addTask( &faders[c] );
+        scheduler.addEdge( eq_node, fader_node );
+        scheduler.addEdge( fader_node, mix_node );
+    }
+
+    scheduler.setDeadline( double( frames ) / 48000.0 );
+    std::chrono::steady_clock::time_point start
+        = std::chrono::steady_clock::now();
+    for ( size_t b = 0; b < blocks; ++b )
+    {
+        scheduler.run();
+    }
+    block_time = std::chrono::duration<double>(
+                     std::chrono::steady_clock::now() - start ).count()
+                 / double( blocks );
+
+    ob_log_info( num_workers,
+                 " workers: ",
+                 block_time,
+                 " s per block, critical path ",
+                 scheduler.criticalPathTime(),
+                 " s, work ",
+                 scheduler.workTime(),
+                 " s, ",
+                 scheduler.deadlineMisses(),
+                 " of ",
+                 blocks,
+                 " blocks missed the deadline" );
+
+    // the critical path is one channel's equalizer, its fader and the
+    // mix, and no block can be faster than it
+    std::vector<size_t> const &path = scheduler.criticalPath();
+    return path.size() == 3 && path.back() == mix_node
+           && scheduler.criticalPathTime() <= scheduler.blockTime()
+           && scheduler.criticalPathTime() <= scheduler.workTime();
+}
+
+bool test_dsp_graph_scheduler()
+{
+    size_t const workers
+        = std::max( std::thread::hardware_concurrency(), 2u );
+    std::vector<float> serial_bus, parallel_bus;
+    double serial_time = 0, parallel_time = 0;
+
+    if ( !test_dsp_graph_scheduler_run( 1, 50, serial_bus, serial_time )
+         || !test_dsp_graph_scheduler_run(
+                workers, 50, parallel_bus, parallel_time ) )
+    {
+        ob_log_error( "critical path is wrong" );
+        return false;
+    }
+
+    for ( size_t i = 0; i < serial_bus.size(); ++i )
+    {
+        if ( std::abs( serial_bus[i] - parallel_bus[i] ) > 1e-5f )
+        {
+            ob_log_error( "parallel mix differs at ", i );
+            return false;
+        }
+    }
+
+    ob_log_info( "speedup with ",
+                 workers,
+                 " workers: ",
+                 serial_time / parallel_time );
+    return true;
+}
+
 template <typename T, size_t N>
 bool test_dsp_oscillator_one()
 {
@@ -153,6 +2809,270 @@ bool test_dsp_oscillator()
     return true;
 }
 
+template <typename T>
+bool test_dsp_oscillator_block_one( char const *name )
+{
+    size_t const frames = 1000;
+    double const w = OBBLIGATO_TWO_PI * 1000.0 / 96000.0;
+    Oscillator<T> block;
+    block.m_state.setFrequency(
+        T( 1.0 / 96000.0 ), T( 1000.0 ), T( 0.7 ), 0 );
+    block.m_coeffs.setAmplitude( T( 0.5 ), 0 );
+    Oscillator<T> per_sample = block;
+
+    std::vector<T> out( frames );
+    block.process( out.data(), frames );
+
+    T peak = 0;
+    for ( size_t i = 0; i < frames; ++i )
+    {
+        T expected = per_sample( T( 0 ) );
+        if ( std::abs( expected - out[i] ) > 1e-4 )
+        {
+            ob_log_error( name, " oscillator mismatch at frame ", i );
+            return false;
+        }
+        peak = std::max( peak, T( std::abs( out[i] ) ) );
+    }
+
+    // the phase is honoured and the amplitude is the one asked for
+    if ( std::abs( out[0] + 0.5 * std::sin( w + 0.7 ) ) > 1e-5
+         || std::abs( peak - 0.5 ) > 1e-3 )
+    {
+        ob_log_error( name, " oscillator starts at ", out[0],
+                      " with peak ", peak );
+        return false;
+    }
+    return true;
+}
+
+bool test_dsp_oscillator_block()
+{
+    if ( !test_dsp_oscillator_block_one<float>( "float" )
+         || !test_dsp_oscillator_block_one<double>( "double" ) )
+    {
+        return false;
+    }
+
+    // a long run keeps its amplitude
+    Oscillator<float> osc;
+    osc.m_state.setFrequency( 1.0f / 96000.0f, 1234.5f, 0.0f, 0 );
+    osc.m_coeffs.setAmplitude( 1.0f, 0 );
+    Oscillator<float> per_sample = osc;
+    std::vector<float> buf( 4096 );
+
+    std::chrono::steady_clock::time_point start
+        = std::chrono::steady_clock::now();
+    for ( size_t i = 0; i < 2000 * buf.size(); ++i )
+    {
+        buf[i % buf.size()] = per_sample( 0.0f );
+    }
+    std::chrono::steady_clock::time_point middle
+        = std::chrono::steady_clock::now();
+    for ( size_t i = 0; i < 2000; ++i )
+    {
+        osc.process( buf.data(), buf.size() );
+    }
+    std::chrono::steady_clock::time_point end
+        = std::chrono::steady_clock::now();
+
+    double a = osc.m_state.m_a;
+    double z1 = osc.m_state.m_z1;
+    double z2 = osc.m_state.m_z2;
+    double energy = z1 * z1 + z2 * z2 - a * z1 * z2;
+    if ( std::abs( energy / ( 1.0 - 0.25 * a * a ) - 1.0 ) > 1e-4 )
+    {
+        ob_log_error( "oscillator amplitude drifted to ",
+                      std::sqrt( energy / ( 1.0 - 0.25 * a * a ) ) );
+        return false;
+    }
+
+    double per_sample_time
+        = std::chrono::duration<double>( middle - start ).count();
+    double block_time
+        = std::chrono::duration<double>( end - middle ).count();
+    ob_log_info( "mono oscillator per sample: ",
+                 per_sample_time,
+                 " s, process(): ",
+                 block_time,
+                 " s" );
+    return true;
+}
+
+/// The amplitude of harmonic h of one cycle of n points
+double test_dsp_harmonic( float const *cycle, size_t n, size_t h )
+{
+    double re = 0, im = 0;
+    for ( size_t i = 0; i < n; ++i )
+    {
+        double w = OBBLIGATO_TWO_PI * double( h * i % n ) / n;
+        re += cycle[i] * std::cos( w );
+        im += cycle[i] * std::sin( w );
+    }
+    return 2.0 * std::sqrt( re * re + im * im ) / n;
+}
+
+bool test_dsp_oscillator_bank()
+{
+    // polynomial sines against std::sin of the same float phases
+    size_t const voices = 37;
+    size_t const frames = 1000;
+    OscillatorBank<float> bank( voices );
+    for ( size_t v = 0; v < voices; ++v )
+    {
+        bank.setFrequency( v, 1.0 / 96000.0, 100.0 + v * 123.4 );
+        bank.setPhase( v, v * 0.3 );
+        bank.setAmplitude( v, 1.0f / ( v + 1 ) );
+    }
+    OscillatorBank<float> mixed = bank;
+
+    std::vector<std::vector<float> > out(
+        voices, std::vector<float>( frames ) );
+    std::vector<float *> ptrs( voices );
+    for ( size_t v = 0; v < voices; ++v )
+    {
+        ptrs[v] = out[v].data();
+    }
+    bank.process( ptrs.data(), frames );
+
+    std::vector<float> sum( frames, 0.0f );
+    for ( size_t v = 0; v < voices; ++v )
+    {
+        double cycles = v * 0.3 / OBBLIGATO_TWO_PI;
+        float p = float( cycles - std::floor( cycles ) );
+        float increment = mixed.getIncrement( v );
+        for ( size_t i = 0; i < frames; ++i )
+        {
+            double expected
+                = std::sin( OBBLIGATO_TWO_PI * p ) / ( v + 1 );
+            if ( std::abs( expected - out[v][i] ) > 1e-5 )
+            {
+                ob_log_error( "oscillator bank voice ", v,
+                              " mismatch at frame ", i );
+                return false;
+            }
+            sum[i] += out[v][i];
+            p += increment;
+            p = p >= 1.0f ? p - 1.0f : p;
+        }
+    }
+
+    std::vector<float> mix( frames, 0.0f );
+    mixed.processMix( mix.data(), frames );
+    for ( size_t i = 0; i < frames; ++i )
+    {
+        if ( std::abs( mix[i] - sum[i] ) > 1e-4 )
+        {
+            ob_log_error( "oscillator bank mix mismatch at frame ", i );
+            return false;
+        }
+    }
+
+    // every level of every table is band limited to its harmonics
+    OscillatorWaveform const waveforms[]
+        = {oscillator_sine, oscillator_saw, oscillator_square,
+           oscillator_triangle};
+    for ( size_t w = 0; w < 4; ++w )
+    {
+        OscillatorWavetable table( waveforms[w], 256 );
+        for ( size_t l = 0; l < table.levels(); ++l )
+        {
+            size_t top = table.harmonics( l );
+            for ( size_t h = top + 1; h < top + 4; ++h )
+            {
+                if ( test_dsp_harmonic( table.level( l ), 256, h )
+                     > 1e-5 )
+                {
+                    ob_log_error( "wavetable ", w, " level ", l,
+                                  " has harmonic ", h );
+                    return false;
+                }
+            }
+        }
+    }
+
+    // a saw reads the level whose harmonics stay below nyquist
+    OscillatorWavetable saw( oscillator_saw );
+    size_t level = saw.levelFor( 1.0 / 64.0 );
+    if ( saw.harmonics( level ) > 32
+         || ( level > 0 && saw.harmonics( level - 1 ) <= 32 ) )
+    {
+        ob_log_error( "wavetable level ", level, " for 1/64 cycle" );
+        return false;
+    }
+    double fundamental = test_dsp_harmonic( saw.level( 0 ), 2048, 1 );
+    if ( std::abs( fundamental - 2.0 / OBBLIGATO_PI ) > 1e-5 )
+    {
+        ob_log_error( "saw fundamental ", fundamental );
+        return false;
+    }
+
+    OscillatorBank<float> saws( 1, &saw );
+    saws.setFrequency( 0, 1.0 / 96000.0, 1500.0 );
+    saws.setAmplitude( 0, 0.5f );
+    std::vector<float> saw_out( 256 );
+    float *saw_ptr = saw_out.data();
+    saws.process( &saw_ptr, 256 );
+    for ( size_t i = 0; i < 256; ++i )
+    {
+        float expected = 0.5f * saw.level( level )[i * 32 % 2048];
+        if ( std::abs( saw_out[i] - expected ) > 1e-6 )
+        {
+            ob_log_error( "saw mismatch at frame ", i );
+            return false;
+        }
+    }
+
+    // compare the throughput of 256 partials from std::sin per sample
+    // and from the bank
+    size_t const partials = 256;
+    size_t const bench_frames = 4096;
+    OscillatorBank<float> additive( partials );
+    std::vector<double> phases( partials, 0.0 );
+    std::vector<double> increments( partials );
+    for ( size_t v = 0; v < partials; ++v )
+    {
+        additive.setFrequencyNote(
+            v, 1.0 / 96000.0, 3, int( v % 12 ), v * 0.1 );
+        additive.setAmplitude( v, 1.0f / partials );
+        increments[v] = additive.getIncrement( v );
+    }
+    std::vector<float> bench( bench_frames, 0.0f );
+
+    std::chrono::steady_clock::time_point start
+        = std::chrono::steady_clock::now();
+    for ( size_t i = 0; i < bench_frames; ++i )
+    {
+        float v = 0.0f;
+        for ( size_t p = 0; p < partials; ++p )
+        {
+            v += float( std::sin( OBBLIGATO_TWO_PI * phases[p] ) )
+                 * ( 1.0f / partials );
+            phases[p] += increments[p];
+            phases[p] -= phases[p] >= 1.0 ? 1.0 : 0.0;
+        }
+        bench[i] = v;
+    }
+    std::chrono::steady_clock::time_point middle
+        = std::chrono::steady_clock::now();
+    additive.processMix( bench.data(), bench_frames );
+    std::chrono::steady_clock::time_point end
+        = std::chrono::steady_clock::now();
+
+    volatile float sink = bench[bench_frames - 1];
+    (void)sink;
+    double sin_time
+        = std::chrono::duration<double>( middle - start ).count();
+    double bank_time
+        = std::chrono::duration<double>( end - middle ).count();
+    ob_log_info( "256 partials with std::sin: ",
+                 sin_time,
+                 " s, OscillatorBank: ",
+                 bank_time,
+                 " s" );
+    return true;
+}
+
 template <typename T, size_t N>
 bool test_dsp_gain_one()
 {
@@ -193,6 +3113,118 @@ bool test_dsp_gain_one()
     return true;
 }
 
+/// Compare Gain::process() in blocks of 256 with the per sample
+/// operator() while it ramps to amplitude and after it has converged.
+/// The per sample smoother stalls up to about an ulp per sample of
+/// time constant short of its target, so the tolerance is wide.
+template <typename T>
+bool test_dsp_gain_block_one( char const *name, double amplitude )
+{
+    typedef typename simd_flattened_type<T>::type item_type;
+    size_t const frames = 1 << 14;
+    Gain<T> per_sample, block;
+    for ( size_t i = 0; i < simd_flattened_size<T>::value; ++i )
+    {
+        per_sample.m_coeffs.setTimeConstant(
+            96000.0, 0.001 * ( i + 1 ), i );
+        per_sample.m_coeffs.setAmplitude( item_type( amplitude ), i );
+    }
+    block = per_sample;
+
+    std::vector<T> input( frames ), expected( frames );
+    std::vector<T> output( frames );
+    for ( size_t i = 0; i < frames; ++i )
+    {
+        for ( size_t c = 0; c < simd_flattened_size<T>::value; ++c )
+        {
+            item_type v = item_type( 0.5 - ( ( i + c ) % 7 ) * 0.1 );
+            set_flattened_item( input[i], v, c );
+        }
+        expected[i] = per_sample( input[i] );
+    }
+    for ( size_t i = 0; i < frames; i += 256 )
+    {
+        block.process( &input[i], &output[i], 256 );
+    }
+
+    for ( size_t i = 0; i < frames; ++i )
+    {
+        for ( size_t c = 0; c < simd_flattened_size<T>::value; ++c )
+        {
+            item_type a = get_flattened_item( expected[i], c );
+            item_type b = get_flattened_item( output[i], c );
+            if ( std::abs( a - b ) > 1e-4 )
+            {
+                ob_log_error( name, " gain ", amplitude,
+                              " mismatch at frame ", i );
+                return false;
+            }
+        }
+    }
+
+    // the end of the block is exactly the converged gain
+    item_type last_in = get_flattened_item( input[frames - 1], 0 );
+    item_type last_out = get_flattened_item( output[frames - 1], 0 );
+    if ( last_out != last_in * item_type( amplitude ) )
+    {
+        ob_log_error( name, " gain ", amplitude, " did not converge" );
+        return false;
+    }
+    return true;
+}
+
+bool test_dsp_gain_block()
+{
+    double const amplitudes[] = {0.5, 1.0, 0.0, -2.0};
+    for ( size_t i = 0; i < 4; ++i )
+    {
+        if ( !test_dsp_gain_block_one<float>( "float", amplitudes[i] )
+             || !test_dsp_gain_block_one<double>( "double",
+                                                  amplitudes[i] )
+             || !test_dsp_gain_block_one<vec4float>( "vec4float",
+                                                     amplitudes[i] ) )
+        {
+            return false;
+        }
+    }
+
+    // compare the throughput of a static gain per sample and in blocks
+    size_t const frames = 1 << 20;
+    Gain<float> per_sample;
+    per_sample.m_coeffs.setAmplitude( 0.5f, 0 );
+    per_sample.m_state.m_current_amplitude = 0.5f;
+    Gain<float> block = per_sample;
+    std::vector<float> buf( frames, 0.25f );
+
+    std::chrono::steady_clock::time_point start
+        = std::chrono::steady_clock::now();
+    for ( size_t i = 0; i < frames; ++i )
+    {
+        buf[i] = per_sample( buf[i] );
+    }
+    std::chrono::steady_clock::time_point middle
+        = std::chrono::steady_clock::now();
+    for ( size_t i = 0; i < frames; i += 256 )
+    {
+        block.processInPlace( &buf[i], 256 );
+    }
+    std::chrono::steady_clock::time_point end
+        = std::chrono::steady_clock::now();
+
+    volatile float sink = buf[frames - 1];
+    (void)sink;
+    double per_sample_time
+        = std::chrono::duration<double>( middle - start ).count();
+    double block_time
+        = std::chrono::duration<double>( end - middle ).count();
+    ob_log_info( "static gain per sample: ",
+                 per_sample_time,
+                 " s, process(): ",
+                 block_time,
+                 " s" );
+    return true;
+}
+
 bool test_dsp_gain()
 {
     ob_log_info( title_fmt( "gain float" ) );
@@ -201,14 +3233,36 @@ bool test_dsp_gain()
     test_dsp_gain_one<SIMD_Vector<float, 4>, 4>();
     // ob_log_info( title_fmt( "gain float x4 x 2" ) );
     // test_dsp_gain_one<SIMD_Vector<SIMD_Vector<float, 4>, 2>, 32>();
-    return true;
+    return test_dsp_gain_block();
 }
 
 bool test_dsp()
 {
 
     OB_RUN_TEST( test_dsp_biquad, "DSP" );
+    OB_RUN_TEST( test_dsp_biquad_response, "DSP" );
+    OB_RUN_TEST( test_dsp_frequency_response, "DSP" );
+    OB_RUN_TEST( test_dsp_biquad_snapshot, "DSP" );
+    OB_RUN_TEST( test_dsp_biquad_design, "DSP" );
+    OB_RUN_TEST( test_dsp_biquad_bank, "DSP" );
+    OB_RUN_TEST( test_dsp_biquad_lookahead, "DSP" );
+    OB_RUN_TEST( test_dsp_fft, "DSP" );
+    OB_RUN_TEST( test_dsp_fir, "DSP" );
+    OB_RUN_TEST( test_dsp_convolver, "DSP" );
+    OB_RUN_TEST( test_dsp_resampler, "DSP" );
+    OB_RUN_TEST( test_dsp_delay_line, "DSP" );
+    OB_RUN_TEST( test_dsp_noise, "DSP" );
+    OB_RUN_TEST( test_dsp_goertzel_bank, "DSP" );
+    OB_RUN_TEST( test_dsp_spectrum_analyzer, "DSP" );
+    OB_RUN_TEST( test_dsp_denormals, "DSP" );
+    OB_RUN_TEST( test_dsp_process, "DSP" );
+    OB_RUN_TEST( test_dsp_static_chain, "DSP" );
+    OB_RUN_TEST( test_dsp_dynamic_chain, "DSP" );
+    OB_RUN_TEST( test_dsp_graph_scheduler, "DSP" );
+    OB_RUN_TEST( test_dsp_automated, "DSP" );
     OB_RUN_TEST( test_dsp_oscillator, "DSP" );
+    OB_RUN_TEST( test_dsp_oscillator_block, "DSP" );
+    OB_RUN_TEST( test_dsp_oscillator_bank, "DSP" );
     OB_RUN_TEST( test_dsp_gain, "DSP" );
 
     return false;
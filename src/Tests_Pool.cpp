@@ -0,0 +1,91 @@
+/*
+ Copyright (c) 2013, J.D. Koftinoff Software, Ltd.
+ <jeffk@jdkoftinoff.com>
+ http://www.jdkoftinoff.com/
+ All rights reserved.
+
+ Permission to use, copy, modify, and/or distribute this software for
+ any
+ purpose with or without fee is hereby granted, provided that the above
+ copyright notice and this permission notice appear in all copies.
+
+ THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ WARRANTIES
+ WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "Obbligato/World.hpp"
+#include "Obbligato/Tests_Pool.hpp"
+#include <cstdlib>
+
+namespace Obbligato
+{
+namespace Tests
+{
+
+/// A low level allocation function that always fails
+static void *test_pool_fail( size_t ) { return 0; }
+
+bool test_pool()
+{
+    // a successful construction does not throw, and every element can
+    // be allocated once
+    size_t const count = 8;
+    Pool pool( count, 64, malloc, free );
+    void *elements[count];
+    for ( size_t i = 0; i < count; ++i )
+    {
+        elements[i] = pool.allocateElement();
+        if ( !elements[i] || !pool.isAddressInPool( elements[i] ) )
+        {
+            ob_log_error( "pool element ", i, " not allocated" );
+            return false;
+        }
+        for ( size_t j = 0; j < i; ++j )
+        {
+            if ( elements[j] == elements[i] )
+            {
+                ob_log_error( "pool element ", i, " allocated twice" );
+                return false;
+            }
+        }
+    }
+    if ( pool.allocateElement() != 0
+         || pool.getTotalAllocatedItems() != count )
+    {
+        ob_log_error( "pool allocated past its size" );
+        return false;
+    }
+
+    // a freed element is handed out again
+    pool.deallocateElement( elements[3] );
+    if ( pool.allocateElement() != elements[3] )
+    {
+        ob_log_error( "pool did not reuse a freed element" );
+        return false;
+    }
+
+    // a failed low level allocation throws
+    bool threw = false;
+    try
+    {
+        Pool failed( count, 64, test_pool_fail, free );
+    }
+    catch ( std::bad_alloc const & )
+    {
+        threw = true;
+    }
+    if ( !threw )
+    {
+        ob_log_error( "pool with no memory did not throw" );
+        return false;
+    }
+    return true;
+}
+}
+}
@@ -103,8 +103,468 @@ bool test_one_simd( T &r )
     return true;
 }
 
+template <typename T>
+bool test_simd_transpose_one()
+{
+    size_t const frame_counts[] = {0, 1, 3, 4, 5, 8, 16, 37};
+
+    for ( size_t channels = 1; channels <= 11; ++channels )
+    {
+        for ( size_t n = 0;
+              n < sizeof( frame_counts ) / sizeof( size_t );
+              ++n )
+        {
+            size_t frames = frame_counts[n];
+            std::vector<T> interleaved( channels * frames );
+            std::vector<T> result( channels * frames );
+            std::vector<std::vector<T> > planar( channels );
+            std::vector<T *> planar_ptrs( channels );
+
+            for ( size_t i = 0; i < interleaved.size(); ++i )
+            {
+                interleaved[i] = T( i + 1 );
+            }
+            for ( size_t c = 0; c < channels; ++c )
+            {
+                planar[c].resize( frames );
+                planar_ptrs[c] = planar[c].data();
+            }
+
+            deinterleave(
+                interleaved.data(), channels, frames, &planar_ptrs[0] );
+
+            for ( size_t c = 0; c < channels; ++c )
+            {
+                for ( size_t f = 0; f < frames; ++f )
+                {
+                    if ( planar[c][f] != interleaved[f * channels + c] )
+                    {
+                        ob_log_error( "deinterleave mismatch channels=",
+                                      channels,
+                                      " frames=",
+                                      frames );
+                        return false;
+                    }
+                }
+            }
+
+            interleave(
+                &planar_ptrs[0], channels, frames, result.data() );
+
+            if ( result != interleaved )
+            {
+                ob_log_error( "interleave mismatch channels=",
+                              channels,
+                              " frames=",
+                              frames );
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool test_simd_transpose()
+{
+    if ( !test_simd_transpose_one<float>()
+         || !test_simd_transpose_one<double>() )
+    {
+        return false;
+    }
+
+    audiochunk4channel frame_major, frame_major_result;
+    SIMD_Vector<SIMD_Vector<float, 16>, 4> channel_major;
+
+    for ( size_t f = 0; f < frame_major.size(); ++f )
+    {
+        for ( size_t c = 0; c < frame_major[f].size(); ++c )
+        {
+            frame_major[f][c] = float( c * 100 + f );
+        }
+    }
+
+    deinterleave( frame_major, channel_major );
+    ob_log_info( label_fmt( "channel 1" ), channel_major[1] );
+
+    for ( size_t c = 0; c < channel_major.size(); ++c )
+    {
+        for ( size_t f = 0; f < channel_major[c].size(); ++f )
+        {
+            if ( channel_major[c][f] != float( c * 100 + f ) )
+            {
+                return false;
+            }
+        }
+    }
+
+    interleave( channel_major, frame_major_result );
+
+    for ( size_t f = 0; f < frame_major.size(); ++f )
+    {
+        for ( size_t c = 0; c < frame_major[f].size(); ++c )
+        {
+            if ( frame_major_result[f][c] != frame_major[f][c] )
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+struct test_simd_for_each_scale
+{
+    template <typename SimdT>
+    SimdT operator()( SimdT const &v ) const
+    {
+        typedef typename SimdT::value_type value_type;
+        return v * value_type( 2 ) + value_type( 1 );
+    }
+};
+
+template <typename T>
+bool test_simd_for_each_one()
+{
+    size_t const sizes[] = {0, 1, 3, 4, 5, 8, 16, 37};
+    size_t const guard = 16;
+
+    for ( size_t n = 0; n < sizeof( sizes ) / sizeof( size_t ); ++n )
+    {
+        size_t count = sizes[n];
+        for ( size_t in_offset = 0; in_offset < 8; ++in_offset )
+        {
+            for ( size_t out_offset = 0; out_offset < 8; ++out_offset )
+            {
+                std::vector<T> in( count + guard );
+                std::vector<T> out( count + guard, T( -1 ) );
+
+                for ( size_t i = 0; i < in.size(); ++i )
+                {
+                    in[i] = T( i );
+                }
+
+                simd_for_each(
+                    make_span<T const>( &in[in_offset], count ),
+                    make_span<T>( &out[out_offset], count ),
+                    test_simd_for_each_scale() );
+
+                for ( size_t i = 0; i < out.size(); ++i )
+                {
+                    T expected = T( -1 );
+                    if ( i >= out_offset && i < out_offset + count )
+                    {
+                        expected = in[i - out_offset + in_offset] * T( 2 )
+                                   + T( 1 );
+                    }
+                    if ( out[i] != expected )
+                    {
+                        ob_log_error( "simd_for_each mismatch count=",
+                                      count,
+                                      " in_offset=",
+                                      in_offset,
+                                      " out_offset=",
+                                      out_offset );
+                        return false;
+                    }
+                }
+            }
+        }
+    }
+    return true;
+}
+
+bool test_simd_for_each()
+{
+    if ( !test_simd_for_each_one<float>()
+         || !test_simd_for_each_one<double>() )
+    {
+        return false;
+    }
+
+    vec4float a, b;
+    float items[5] = {1, 2, 3, 4, 5};
+    float result[5] = {0, 0, 0, 0, 0};
+
+    load_partial( a, items, 3 );
+    store_partial( a, result + 1, 3 );
+    if ( a[3] != 0.0f || result[0] != 0.0f || result[1] != 1.0f
+         || result[3] != 3.0f || result[4] != 0.0f )
+    {
+        return false;
+    }
+
+    loadu( a, items + 1 );
+    stream( a, b.data() );
+    stream_fence();
+    return b[0] == 2.0f && b[3] == 5.0f;
+}
+
+template <typename T, size_t N>
+bool test_simd_complex_one()
+{
+    typedef SIMD_Vector<std::complex<T>, N> complex_type;
+    typedef std::complex<T> value_type;
+    T const tolerance = T( 1e-4 );
+
+    complex_type a, b;
+    for ( size_t i = 0; i < N; ++i )
+    {
+        T angle = T( OBBLIGATO_TWO_PI * i / N - 3.0 );
+        a[i] = std::polar( T( 1.5 ), angle );
+        b[i] = value_type( T( i ) - T( 2 ), T( 0.5 ) + T( i ) );
+    }
+
+    complex_type sum = a + b;
+    complex_type product = a * b;
+    complex_type quotient = a / b;
+    complex_type mixed = T( 2 ) * a + T( 1 );
+    complex_type conjugate = conj( a );
+    SIMD_Vector<T, N> magnitude = abs( a );
+    SIMD_Vector<T, N> phase = arg( b );
+
+    for ( size_t i = 0; i < N; ++i )
+    {
+        value_type x = a.get( i );
+        value_type y = b.get( i );
+        if ( std::abs( sum.get( i ) - ( x + y ) ) > tolerance
+             || std::abs( product.get( i ) - ( x * y ) ) > tolerance
+             || std::abs( quotient.get( i ) - ( x / y ) ) > tolerance
+             || std::abs( mixed.get( i ) - ( T( 2 ) * x + T( 1 ) ) )
+                > tolerance
+             || std::abs( conjugate.get( i ) - std::conj( x ) )
+                > tolerance
+             || std::abs( magnitude[i] - std::abs( x ) ) > tolerance
+             || std::abs( phase[i] - std::arg( y ) ) > tolerance )
+        {
+            ob_log_error( "complex mismatch at item ", i );
+            return false;
+        }
+    }
+
+    // the phase of every quadrant and of both axes
+    for ( int re = -2; re <= 2; ++re )
+    {
+        for ( int im = -2; im <= 2; ++im )
+        {
+            value_type x( static_cast<T>( re ), static_cast<T>( im ) );
+            complex_type v( x );
+            T expected = std::arg( x );
+            if ( std::abs( arg( v )[0] - expected ) > tolerance )
+            {
+                ob_log_error( "arg mismatch re=", re, " im=", im );
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool test_simd_complex()
+{
+    typedef SIMD_Vector<std::complex<float>, 4> vec4complex;
+
+    vec4complex c{std::complex<float>( 1, 2 ),
+                  std::complex<float>( 3, 4 )};
+    ob_log_info( label_fmt( "vec4complex" ), c );
+
+    float re[4] = {1, 2, 3, 4};
+    float im[4] = {5, 6, 7, 8};
+    loadu( c, re, im );
+    if ( c.get( 3 ) != std::complex<float>( 4, 8 ) )
+    {
+        return false;
+    }
+
+    return test_simd_complex_one<float, 4>()
+           && test_simd_complex_one<float, 8>()
+           && test_simd_complex_one<double, 2>()
+           && test_simd_complex_one<double, 4>();
+}
+
+template <typename SimdT>
+bool test_simd_flatten_one()
+{
+    typedef typename simd_flattened_type<SimdT>::type flattened_type;
+    size_t const n = simd_flattened_size<SimdT>::value;
+    std::vector<flattened_type> items( n ), result( n );
+
+    for ( size_t i = 0; i < n; ++i )
+    {
+        items[i] = flattened_type( i + 1 );
+    }
+
+    SimdT v;
+    if ( unflatten_from( v, items.data() ) != items.data() + n )
+    {
+        return false;
+    }
+    for ( size_t i = 0; i < n; ++i )
+    {
+        if ( get_flattened_item( v, i ) != items[i] )
+        {
+            ob_log_error( "unflatten_from mismatch at item ", i );
+            return false;
+        }
+    }
+
+    flatten_to( v, result.data() );
+    return result == items;
+}
+
+bool test_simd_flatten()
+{
+    if ( !test_simd_flatten_one<vec4float>()
+         || !test_simd_flatten_one<audiochunk4channel>()
+         || !test_simd_flatten_one<SIMD_Vector<vec2double, 3> >()
+         || !test_simd_flatten_one<SIMD_Vector<float, 3> >()
+         || !test_simd_flatten_one<
+                SIMD_Vector<std::complex<float>, 4> >() )
+    {
+        return false;
+    }
+
+    // a padded inner vector must not be copied with memcpy
+    typedef SIMD_Vector<SIMD_Vector<float, 3>, 4> padded_type;
+    if ( simd_is_packed<padded_type>::value
+         || !test_simd_flatten_one<padded_type>() )
+    {
+        return false;
+    }
+
+    audiochunk4channel chunk;
+    float samples[16];
+    zero( chunk );
+    for ( size_t f = 0; f < 16; ++f )
+    {
+        samples[f] = float( f + 1 );
+    }
+    insert_channel( chunk, 2, samples );
+    for ( size_t f = 0; f < 16; ++f )
+    {
+        if ( chunk[f][2] != float( f + 1 ) || chunk[f][1] != 0.0f )
+        {
+            return false;
+        }
+    }
+
+    float extracted[16];
+    extract_channel( chunk, 2, extracted );
+    return std::equal( samples, samples + 16, extracted );
+}
+
+template <typename SimdT>
+bool test_simd_operators_one()
+{
+    typedef typename SimdT::value_type value_type;
+    size_t const n = SimdT::vector_size;
+    value_type const s = value_type( 0.75 );
+    SimdT a, b;
+
+    for ( size_t i = 0; i < n; ++i )
+    {
+        a[i] = value_type( i ) * value_type( 1.5 ) - value_type( 4 );
+        b[i] = value_type( n - i ) * value_type( 0.5 )
+               + value_type( 1 );
+    }
+
+    SimdT r[16];
+    r[0] = a + b;
+    r[1] = a - b;
+    r[2] = a * b;
+    r[3] = a / b;
+    r[4] = a + s;
+    r[5] = a - s;
+    r[6] = a * s;
+    r[7] = a / s;
+    r[8] = a;
+    r[8] += b;
+    r[9] = a;
+    r[9] -= b;
+    r[10] = a;
+    r[10] *= b;
+    r[11] = a;
+    r[11] /= b;
+    r[12] = a;
+    r[12] += s;
+    r[13] = a;
+    r[13] -= s;
+    r[14] = a;
+    r[14] *= s;
+    r[15] = a;
+    r[15] /= s;
+
+    for ( size_t i = 0; i < n; ++i )
+    {
+        value_type const x = a[i];
+        value_type const y = b[i];
+        value_type const e[16] = {x + y, x - y, x * y, x / y,
+                                  x + s, x - s, x * s, x / s,
+                                  x + y, x - y, x * y, x / y,
+                                  x + s, x - s, x * s, x / s};
+        for ( size_t k = 0; k < 16; ++k )
+        {
+            if ( r[k][i] != e[k] )
+            {
+                ob_log_error( "operator ", k, " mismatch at lane ", i );
+                return false;
+            }
+        }
+    }
+
+    // every other lane of c equals a, so the comparisons see ties
+    SimdT c;
+    for ( size_t i = 0; i < n; ++i )
+    {
+        c[i] = ( i & 1 ) ? a[i] : b[i];
+    }
+
+    SimdT m[7];
+    m[0] = abs( a );
+    m[1] = equal_to( a, c );
+    m[2] = not_equal_to( a, c );
+    m[3] = less( a, c );
+    m[4] = less_equal( a, c );
+    m[5] = greater( a, c );
+    m[6] = greater_equal( a, c );
+
+    for ( size_t i = 0; i < n; ++i )
+    {
+        value_type const x = a[i];
+        value_type const y = c[i];
+        value_type const e[7] = {abs( x ),
+                                 equal_to( x, y ),
+                                 not_equal_to( x, y ),
+                                 less( x, y ),
+                                 less_equal( x, y ),
+                                 greater( x, y ),
+                                 greater_equal( x, y )};
+        for ( size_t k = 0; k < 7; ++k )
+        {
+            if ( m[k][i] != e[k] )
+            {
+                ob_log_error( "compare ", k, " mismatch at lane ", i );
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool test_simd_operators()
+{
+    return test_simd_operators_one<vec4float>()
+           && test_simd_operators_one<vec8float>()
+           && test_simd_operators_one<vec2double>()
+           && test_simd_operators_one<vec4double>();
+}
+
 bool test_simd()
 {
+    OB_RUN_TEST( test_simd_transpose, "SIMD" );
+    OB_RUN_TEST( test_simd_for_each, "SIMD" );
+    OB_RUN_TEST( test_simd_complex, "SIMD" );
+    OB_RUN_TEST( test_simd_flatten, "SIMD" );
+    OB_RUN_TEST( test_simd_operators, "SIMD" );
 
     double d = 99;
     test_one_simd( d );
@@ -28,6 +28,7 @@
 #include "Obbligato/Tests_IOStream.hpp"
 #include "Obbligato/Tests_LexicalCast.hpp"
 #include "Obbligato/Tests_Logger.hpp"
+#include "Obbligato/Tests_Pool.hpp"
 #include "Obbligato/Tests_SIMD.hpp"
 #include "Obbligato/Tests_Time.hpp"
 #include "Obbligato/Tests_DSP.hpp"
@@ -45,6 +46,7 @@ int main( int, char const **argv )
     OB_RUN_TEST( test_iostream, "IOStream" );
     OB_RUN_TEST( test_lexicalcast, "LexicalCast" );
     OB_RUN_TEST( test_logger, "Logger" );
+    OB_RUN_TEST( test_pool, "Pool" );
 #if __cplusplus >= 201103L
     OB_RUN_TEST( test_simd, "SIMD" );
     OB_RUN_TEST( test_dsp, "DSP" );